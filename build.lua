@@ -13,5 +13,20 @@ demo 'd-gfx' {
           'cli',
           'util-string'
       }
+   },
+   app '-tex-bench' {
+      icon 'icon/bengine.ico',
+      src 'src-tex-bench/*.cpp',
+      src 'src-tex/tex_*.cpp',
+      define 'GLM_ENABLE_EXPERIMENTAL',
+      link_project {
+          'gfx-tex',
+          'gfx',
+          'platform',
+          'core-id',
+          'util-fs',
+          'cli',
+          'util-string'
+      }
    }
 }
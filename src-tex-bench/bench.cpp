@@ -0,0 +1,6 @@
+#include "bench_suite.hpp"
+
+int main(int argc, char** argv) {
+   BenchSuite suite(argc, argv);
+   return suite();
+}
@@ -0,0 +1,565 @@
+#include "bench_suite.hpp"
+#include "../src-tex/tex_demo.hpp"
+#include "../src-tex/tex_blit.hpp"
+#include "../src-tex/tex_float_pack.hpp"
+#include <be/core/logging.hpp>
+#include <be/core/version.hpp>
+#include <be/core/stack_trace.hpp>
+#include <be/gfx/version.hpp>
+#include <be/gfx/tex/image_format_gl.hpp>
+#include <be/cli/cli.hpp>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+using namespace be;
+using namespace be::gfx;
+using namespace be::gfx::tex;
+
+namespace {
+
+// Every format accepted by d-gfx-tex --format.
+const char* const all_formats[] = {
+   "R8",            "R16",      "R8_SNORM",      "R16_SNORM",
+   "R8UI",          "R16UI",    "R32UI",         "R8I",
+   "R16I",          "R32I",     "R16F",          "R32F",
+   "RG8",           "RG16",     "RG8_SNORM",     "RG16_SNORM",
+   "RG8UI",         "RG16UI",   "RG32UI",        "RG8I",
+   "RG16I",         "RG32I",    "RG16F",         "RG32F",
+   "SRGB8",         "RGB8",     "RGB16",         "R3_G3_B2",
+   "RGB4",          "RGB5",     "RGB8_SNORM",
+   "RGB16_SNORM",   "RGB8UI",   "RGB16UI",       "RGB32UI",
+   "RGB8I",         "RGB16I",   "RGB32I",        "R11F_G11F_B10F",
+   "RGB16F",        "RGB32F",   "RGB9_E5",       "RGBA16",
+   "RGBA4",         "RGB5_A1",  "RGB10_A2",      "RGBA8_SNORM",
+   "RGBA16_SNORM",  "RGBA8UI",  "RGBA16UI",      "RGBA32UI",
+   "RGB10_A2UI",    "RGBA8I",   "RGBA16I",       "RGBA32I",
+   "RGBA16F",       "RGBA32F",  "SRGB8_ALPHA8",  "RGBA8"
+};
+
+const char* const all_demos[] = {
+   "whitenoise", "rgbnoise", "gradient", "sinc", "cosdst2", "pinwheel", "pinwheel-r",
+   "expr:sinc", "expr:cosdst2"
+};
+
+// --expr versions of hand-written demos, run as "expr:<demo>".
+const char* const expr_demos[][2] = {
+   { "sinc", "0.5 * (1 + sin(r / effect_scale) / (r / effect_scale))" },
+   { "cosdst2", "0.5 * (1 + cos(r^2 / effect_scale))" }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// The arguments that select bench's demo.
+std::vector<S> demo_args(const S& demo) {
+   const S prefix = "expr:";
+   if (demo.compare(0, prefix.size(), prefix) == 0) {
+      for (auto& expr : expr_demos) {
+         if (demo.substr(prefix.size()) == expr[0]) {
+            return { "--expr", expr[1] };
+         }
+      }
+   }
+   return { demo };
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<S> split_list(const S& value) {
+   std::vector<S> items;
+   std::istringstream iss(value);
+   S item;
+   while (std::getline(iss, item, ',')) {
+      if (!item.empty()) {
+         items.push_back(item);
+      }
+   }
+   return items;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+S dim_string(ivec2 dim) {
+   std::ostringstream oss;
+   oss << dim.x << 'x' << dim.y;
+   return oss.str();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+S result_key(const BenchCase& bench) {
+   return bench.demo + '|' + bench.format + '|' + dim_string(bench.dim);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void summarize(std::vector<F64> run_ms, BenchResult& result) {
+   result.runs = U32(run_ms.size());
+   if (run_ms.empty()) {
+      return;
+   }
+
+   std::sort(run_ms.begin(), run_ms.end());
+   std::size_t n = run_ms.size();
+   result.median_ms = n % 2 ? run_ms[n / 2] : 0.5 * (run_ms[n / 2 - 1] + run_ms[n / 2]);
+   result.min_ms = run_ms.front();
+   result.max_ms = run_ms.back();
+
+   F64 total = 0;
+   for (F64 ms : run_ms) {
+      total += ms;
+   }
+   result.mean_ms = total / F64(n);
+
+   F64 variance = 0;
+   for (F64 ms : run_ms) {
+      variance += (ms - result.mean_ms) * (ms - result.mean_ms);
+   }
+   result.stddev_ms = n > 1 ? std::sqrt(variance / F64(n - 1)) : 0.0;
+
+   F64 pixels = F64(result.bench.dim.x) * F64(result.bench.dim.y);
+   result.mpixels_per_second = result.median_ms > 0 ? pixels / (result.median_ms * 1000.0) : 0.0;
+   result.ok = true;
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+BenchSuite::BenchSuite(int argc, char** argv) {
+   default_log().verbosity_mask(v::info_or_worse);
+   try {
+      using namespace cli;
+      using namespace color;
+      using namespace ct;
+      Processor proc;
+
+      bool show_version = false;
+      bool show_help = false;
+      bool verbose = false;
+      S help_query;
+
+      demos_.assign(std::begin(all_demos), std::end(all_demos));
+      formats_.assign(std::begin(all_formats), std::end(all_formats));
+      dims_ = { ivec2(256, 256), ivec2(1024, 1024) };
+
+      proc
+         (prologue(Table() << header << "be::gfx::tex Benchmark Suite").query())
+         (synopsis(Cell() << fg_dark_gray << "[ " << fg_cyan << "OPTIONS" << fg_dark_gray << " ]"))
+
+         (param({ }, { "demos" }, "LIST", [this](const S& value) {
+               demos_ = split_list(value);
+               return true;
+            }).desc("Comma-separated demos to run.  expr:sinc and expr:cosdst2 run --expr equivalents of those demos.  Defaults to every generator."))
+         (param({ }, { "formats" }, "LIST", [this](const S& value) {
+               formats_ = split_list(value);
+               return true;
+            }).desc(Cell() << "Comma-separated formats, as accepted by " << fg_yellow << "--format" << reset << ".  Defaults to every format."))
+         (param({ }, { "sizes" }, "LIST", [this](const S& value) {
+               dims_.clear();
+               for (auto& item : split_list(value)) {
+                  std::istringstream iss(item);
+                  ivec2 dim;
+                  char x = 0;
+                  iss >> dim.x >> x >> dim.y;
+                  if (!iss || x != 'x' || dim.x <= 0 || dim.y <= 0) {
+                     throw RecoverableError(std::make_error_code(std::errc::invalid_argument));
+                  }
+                  dims_.push_back(dim);
+               }
+               return true;
+            }).desc("Comma-separated WxH sizes.  Defaults to 256x256,1024x1024."))
+
+         (numeric_param({ "n" }, { "frames" }, "N", frames_).desc("Sets the number of timed frames per run."))
+         (numeric_param({ }, { "warmup" }, "N", warmup_).desc("Sets the number of untimed frames generated before each run."))
+         (numeric_param({ "r" }, { "repeats" }, "N", repeats_).desc("Sets the number of runs per case.  Results summarize the median frame time of each run."))
+         (numeric_param({ "j" }, { "threads" }, "N", threads_).desc("Sets the number of threads used by generators.  0 uses one thread per hardware thread."))
+         (flag({ }, { "no-blit" }, skip_blits_).desc("Skips the blit kernel benchmarks."))
+         (flag({ }, { "no-packing" }, skip_packing_).desc("Skips the float packing kernel benchmarks."))
+
+         (param({ }, { "file" }, "PATH", [&](const S& value) {
+               file_ = value;
+            }).desc("Also times converting this image into every format with the view demo."))
+
+         (param({ "o" }, { "out" }, "PATH", [this](const S& value) {
+               out_file_ = value;
+            }).desc(Cell() << "Writes results as CSV, suitable for " << fg_yellow << "--baseline" << reset << "."))
+         (param({ }, { "baseline" }, "PATH", [this](const S& value) {
+               baseline_file_ = value;
+            }).desc(Cell() << "Compares median frame times against a CSV written by " << fg_yellow << "--out" << reset << " and flags regressions."))
+         (numeric_param({ }, { "threshold" }, "PERCENT", threshold_).desc("Sets how much slower than the baseline a case must be to count as a regression."))
+
+         (end_of_options())
+
+         (verbosity_param({ "v" }, { "verbosity" }, "LEVEL", default_log().verbosity_mask()))
+
+         (flag({ "V" }, { "version" }, show_version).desc("Prints version information to standard output."))
+
+         (param({ "?" }, { "help" }, "OPTION", [&](const S& value) {
+               show_help = true;
+               help_query = value;
+            }).default_value(S())
+               .allow_options_as_values(true)
+               .desc(Cell() << "Outputs this help message.  For more verbose help, use " << fg_yellow << "--help")
+               .extra(Cell() << nl << "If " << fg_cyan << "OPTION" << reset
+                             << " is provided, the options list will be filtered to show only options that contain that string."))
+
+         (flag({ }, { "help" }, verbose).ignore_values(true))
+
+         (exit_code(0, "There were no errors or regressions."))
+         (exit_code(1, "An unknown error occurred, or a case failed to run."))
+         (exit_code(2, "There was a problem parsing the command line arguments."))
+         (exit_code(3, "At least one case regressed against the baseline."))
+         ;
+
+      proc.process(argc, argv);
+
+      if (show_version) {
+         proc
+            (prologue(BE_CORE_VERSION_STRING).query())
+            (prologue(BE_GFX_VERSION_STRING).query())
+            (license(BE_LICENSE).query())
+            (license(BE_COPYRIGHT).query())
+            ;
+      }
+
+      if (show_help) {
+         proc.describe(std::cout, verbose, help_query);
+      } else if (show_version) {
+         proc.describe(std::cout, verbose, ids::cli_describe_section_prologue);
+         proc.describe(std::cout, verbose, ids::cli_describe_section_license);
+      }
+
+      if (show_help || show_version) {
+         status_ = -1;
+      }
+
+   } catch (const cli::OptionError& e) {
+      status_ = 2;
+      be_error() << S(e.what())
+         & attr(ids::log_attr_index) << e.raw_position()
+         & attr(ids::log_attr_argument) << S(e.argument())
+         & attr(ids::log_attr_option) << S(e.option())
+         | default_log();
+   } catch (const cli::ArgumentError& e) {
+      status_ = 2;
+      be_error() << S(e.what())
+         & attr(ids::log_attr_index) << e.raw_position()
+         & attr(ids::log_attr_argument) << S(e.argument())
+         | default_log();
+   } catch (const FatalTrace& e) {
+      status_ = 2;
+      be_error() << "Fatal error while parsing command line!"
+         & attr(ids::log_attr_message) << S(e.what())
+         & attr(ids::log_attr_trace) << StackTrace(e.trace())
+         | default_log();
+   } catch (const std::exception& e) {
+      status_ = 2;
+      be_error() << "Unexpected exception parsing command line!"
+         & attr(ids::log_attr_message) << S(e.what())
+         | default_log();
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int BenchSuite::operator()() {
+   if (status_ < 0) {
+      return 0;
+   } else if (status_ != 0) {
+      return status_;
+   }
+
+   try {
+      std::vector<BenchResult> results;
+      for (auto& bench : cases_()) {
+         results.push_back(run_demo_(bench));
+      }
+      if (!skip_blits_) {
+         for (ivec2 dim : dims_) {
+            run_blits_(dim, results);
+         }
+      }
+      if (!skip_packing_) {
+         run_packing_(results);
+      }
+
+      for (auto& result : results) {
+         if (!result.ok) {
+            status_ = std::max(status_, (I8)1);
+            be_warn() << "Benchmark failed"
+               & attr("Demo") << result.bench.demo
+               & attr("Format") << result.bench.format
+               & attr("Size") << dim_string(result.bench.dim)
+               | default_log();
+            continue;
+         }
+         be_info() << "Benchmark"
+            & attr("Demo") << result.bench.demo
+            & attr("Format") << result.bench.format
+            & attr("Size") << dim_string(result.bench.dim)
+            & attr("Runs") << result.runs
+            & attr("Median (ms)") << result.median_ms
+            & attr("Mean (ms)") << result.mean_ms
+            & attr("Std Dev (ms)") << result.stddev_ms
+            & attr("Min (ms)") << result.min_ms
+            & attr("Max (ms)") << result.max_ms
+            & attr("P99 (ms)") << result.p99_ms
+            & attr("Mpixel/s") << result.mpixels_per_second
+            | default_log();
+      }
+
+      if (!out_file_.empty()) {
+         write_results_(results);
+      }
+      if (!baseline_file_.empty() && compare_baseline_(results) > 0) {
+         status_ = std::max(status_, (I8)3);
+      }
+   } catch (const FatalTrace& e) {
+      status_ = std::max(status_, (I8)1);
+      be_error() << "Unexpected fatal error!"
+         & attr(ids::log_attr_message) << S(e.what())
+         & attr(ids::log_attr_trace) << StackTrace(e.trace())
+         | default_log();
+   } catch (const std::exception& e) {
+      status_ = std::max(status_, (I8)1);
+      be_error() << "Unexpected exception!"
+         & attr(ids::log_attr_message) << S(e.what())
+         | default_log();
+   }
+
+   return status_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<BenchCase> BenchSuite::cases_() const {
+   std::vector<BenchCase> cases;
+   for (auto& demo : demos_) {
+      for (auto& format : formats_) {
+         for (ivec2 dim : dims_) {
+            cases.push_back(BenchCase { demo, format, dim });
+         }
+      }
+   }
+   if (!file_.empty()) {
+      // the image decides the size
+      for (auto& format : formats_) {
+         cases.push_back(BenchCase { "view", format, ivec2(0) });
+      }
+   }
+   return cases;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Each run is a fresh headless TexDemo, so state like LUTs and the texture
+// pool doesn't carry over between runs.  The view demo only converts once
+// per run, so its conversion time is used instead of the frame time.
+BenchResult BenchSuite::run_demo_(const BenchCase& bench) {
+   BenchResult result;
+   result.bench = bench;
+
+   std::vector<S> args = {
+      "d-gfx-tex-bench", "--headless", "--seed", "1",
+      "-n", std::to_string(frames_), "--warmup", std::to_string(warmup_),
+      "-f", bench.format, "-j", std::to_string(threads_)
+   };
+   std::vector<S> demo = demo_args(bench.demo);
+   args.insert(args.begin() + 1, demo.begin(), demo.end());
+   if (bench.demo == "view") {
+      args.insert(args.end(), { "--file", file_ });
+   } else {
+      args.insert(args.end(), { "-w", std::to_string(bench.dim.x), "-h", std::to_string(bench.dim.y) });
+   }
+
+   Phase phase = bench.demo == "view" ? Phase::convert : Phase::generate;
+   U32 mask = default_log().verbosity_mask();
+   std::vector<F64> run_ms;
+   for (U32 run = 0; run < repeats_; ++run) {
+      std::vector<char*> argv;
+      for (auto& arg : args) {
+         argv.push_back(&arg[0]);
+      }
+
+      TexDemo demo(int(argv.size()), argv.data());
+      default_log().verbosity_mask(v::warning_or_worse); // TexDemo resets it; per-run summaries are noise here
+      int status = demo();
+      default_log().verbosity_mask(mask);
+      if (status != 0) {
+         return result;
+      }
+
+      PhaseSummary summary = demo.stats().summary(phase);
+      if (summary.count == 0) {
+         return result;
+      }
+      run_ms.push_back(summary.p50 * 1000.0);
+      result.p99_ms = std::max(result.p99_ms, summary.p99 * 1000.0);
+      result.bench.dim = demo.dim();
+
+      be_verbose() << "Benchmark run"
+         & attr("Demo") << bench.demo
+         & attr("Format") << bench.format
+         & attr("Run") << run
+         & attr("Median (ms)") << summary.p50 * 1000.0
+         | default_log();
+   }
+
+   summarize(std::move(run_ms), result);
+   return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void BenchSuite::run_blits_(ivec2 dim, std::vector<BenchResult>& results) {
+   std::map<S, std::vector<F64>> run_ms;
+   std::vector<BenchCase> cases;
+   F64 pixels = F64(dim.x) * F64(dim.y);
+   for (U32 run = 0; run < repeats_; ++run) {
+      for (auto& blit : benchmark_blits(dim, std::max(frames_, 1u))) {
+         BenchCase bench;
+         bench.demo = S("blit:") + blit.kernel;
+         bench.format = S(gl::enum_name(to_gl_format(blit.src).internal_format)) + '>' + gl::enum_name(to_gl_format(blit.dest).internal_format);
+         bench.dim = dim;
+         std::vector<F64>& times = run_ms[result_key(bench)];
+         if (times.empty()) {
+            cases.push_back(bench);
+         }
+         times.push_back(blit.mpixels_per_second > 0 ? pixels / (blit.mpixels_per_second * 1000.0) : 0.0);
+      }
+   }
+
+   for (auto& bench : cases) {
+      BenchResult result;
+      result.bench = bench;
+      summarize(run_ms[result_key(bench)], result);
+      result.p99_ms = result.max_ms;
+      results.push_back(result);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// One row per kernel and SIMD level; the width is the number of values
+// converted, so the throughput column reads as Mvalues/s.
+void BenchSuite::run_packing_(std::vector<BenchResult>& results) {
+   const std::size_t samples = 1 << 20;
+   std::map<S, std::vector<F64>> run_ms;
+   std::vector<BenchCase> cases;
+   for (U32 run = 0; run < repeats_; ++run) {
+      for (auto& check : check_float_packing(samples)) {
+         BenchCase bench;
+         bench.demo = S("float:") + check.kernel;
+         bench.format = simd_level_name(check.level);
+         bench.dim = ivec2(I32(samples), 1);
+         std::vector<F64>& times = run_ms[result_key(bench)];
+         if (times.empty()) {
+            cases.push_back(bench);
+         }
+         times.push_back(check.mvalues_per_second > 0 ? F64(samples) / (check.mvalues_per_second * 1000.0) : 0.0);
+         if (check.mismatches > 0) {
+            be_warn() << "Float packing mismatch"
+               & attr("Kernel") << check.kernel
+               & attr("SIMD") << simd_level_name(check.level)
+               & attr("Mismatches") << check.mismatches
+               | default_log();
+         }
+      }
+   }
+
+   for (auto& bench : cases) {
+      BenchResult result;
+      result.bench = bench;
+      summarize(run_ms[result_key(bench)], result);
+      result.p99_ms = result.max_ms;
+      results.push_back(result);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void BenchSuite::write_results_(const std::vector<BenchResult>& results) const {
+   std::ofstream os(out_file_.string(), std::ios::trunc);
+   os << "demo,format,width,height,runs,median_ms,mean_ms,stddev_ms,min_ms,max_ms,p99_ms,mpixels_per_second\n";
+   for (auto& result : results) {
+      if (!result.ok) {
+         continue;
+      }
+      os << result.bench.demo << ',' << result.bench.format << ','
+         << result.bench.dim.x << ',' << result.bench.dim.y << ','
+         << result.runs << ',' << result.median_ms << ',' << result.mean_ms << ','
+         << result.stddev_ms << ',' << result.min_ms << ',' << result.max_ms << ','
+         << result.p99_ms << ',' << result.mpixels_per_second << '\n';
+   }
+   if (!os) {
+      throw fs::filesystem_error("Failed to write benchmark results", out_file_, std::make_error_code(std::errc::io_error));
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// A case regresses if its median is more than threshold_ percent above the
+// baseline median and the difference is also larger than the baseline's
+// run-to-run noise.
+U32 BenchSuite::compare_baseline_(const std::vector<BenchResult>& results) const {
+   std::ifstream is(baseline_file_.string());
+   if (!is) {
+      throw fs::filesystem_error("Failed to read benchmark baseline", baseline_file_, std::make_error_code(std::errc::no_such_file_or_directory));
+   }
+
+   std::map<S, BenchResult> baseline;
+   S line;
+   std::getline(is, line); // header
+   while (std::getline(is, line)) {
+      std::vector<S> fields = split_list(line);
+      if (fields.size() < 12) {
+         continue;
+      }
+      BenchResult result;
+      result.bench.demo = fields[0];
+      result.bench.format = fields[1];
+      result.bench.dim = ivec2(std::stoi(fields[2]), std::stoi(fields[3]));
+      result.median_ms = std::stod(fields[5]);
+      result.stddev_ms = std::stod(fields[7]);
+      result.ok = true;
+      baseline[result_key(result.bench)] = result;
+   }
+
+   U32 regressions = 0;
+   U32 improvements = 0;
+   U32 compared = 0;
+   for (auto& result : results) {
+      auto it = baseline.find(result_key(result.bench));
+      if (!result.ok || it == baseline.end() || it->second.median_ms <= 0) {
+         continue;
+      }
+      ++compared;
+
+      const BenchResult& base = it->second;
+      F64 change = (result.median_ms - base.median_ms) / base.median_ms * 100.0;
+      F64 noise = 2.0 * std::max(base.stddev_ms, result.stddev_ms);
+      if (std::abs(result.median_ms - base.median_ms) <= noise) {
+         continue;
+      }
+
+      if (change > threshold_) {
+         ++regressions;
+         be_warn() << "Regression"
+            & attr("Demo") << result.bench.demo
+            & attr("Format") << result.bench.format
+            & attr("Size") << dim_string(result.bench.dim)
+            & attr("Baseline (ms)") << base.median_ms
+            & attr("Median (ms)") << result.median_ms
+            & attr("Change (%)") << change
+            | default_log();
+      } else if (change < -threshold_) {
+         ++improvements;
+         be_verbose() << "Improvement"
+            & attr("Demo") << result.bench.demo
+            & attr("Format") << result.bench.format
+            & attr("Size") << dim_string(result.bench.dim)
+            & attr("Baseline (ms)") << base.median_ms
+            & attr("Median (ms)") << result.median_ms
+            & attr("Change (%)") << change
+            | default_log();
+      }
+   }
+
+   be_info() << "Baseline comparison complete"
+      & attr("Compared") << compared
+      & attr("Regressions") << regressions
+      & attr("Improvements") << improvements
+      & attr("Threshold (%)") << threshold_
+      | default_log();
+
+   return regressions;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#ifndef BENCH_SUITE_HPP_
+#define BENCH_SUITE_HPP_
+
+#include <be/core/lifecycle.hpp>
+#include <be/core/glm.hpp>
+#include <be/core/filesystem.hpp>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+struct BenchCase {
+   be::S demo;
+   be::S format;
+   be::ivec2 dim;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Timings are per frame, summarized across repeated runs: each run
+// contributes its median frame time.
+struct BenchResult {
+   BenchCase bench;
+   bool ok = false;
+   be::U32 runs = 0;
+   be::F64 median_ms = 0;
+   be::F64 mean_ms = 0;
+   be::F64 stddev_ms = 0;
+   be::F64 min_ms = 0;
+   be::F64 max_ms = 0;
+   be::F64 p99_ms = 0; // worst single-run p99
+   be::F64 mpixels_per_second = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Runs every generator headless across formats and sizes, plus the blit
+// kernels and (given --file) the view conversion, and optionally compares
+// against a CSV written by an earlier run.
+class BenchSuite final {
+public:
+   BenchSuite(int argc, char** argv);
+   int operator()();
+
+private:
+   std::vector<BenchCase> cases_() const;
+   BenchResult run_demo_(const BenchCase& bench);
+   void run_blits_(be::ivec2 dim, std::vector<BenchResult>& results);
+   void run_packing_(std::vector<BenchResult>& results);
+   void write_results_(const std::vector<BenchResult>& results) const;
+   be::U32 compare_baseline_(const std::vector<BenchResult>& results) const;
+
+   be::CoreInitLifecycle init_;
+   be::CoreLifecycle core_;
+
+   be::I8 status_ = 0;
+
+   std::vector<be::S> demos_;
+   std::vector<be::S> formats_;
+   std::vector<be::ivec2> dims_;
+   be::U32 frames_ = 20;
+   be::U32 warmup_ = 3;
+   be::U32 repeats_ = 5;
+   be::U32 threads_ = 0;
+   bool skip_blits_ = false;
+   bool skip_packing_ = false;
+   be::S file_;
+   be::Path out_file_;
+   be::Path baseline_file_;
+   be::F64 threshold_ = 10.0; // percent
+};
+
+#endif
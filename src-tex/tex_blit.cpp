@@ -0,0 +1,323 @@
+#include "tex_blit.hpp"
+#include "tex_pixel_writer.hpp"
+#include "tex_float_pack.hpp"
+#include <be/core/time.hpp>
+#include <be/gfx/tex/image_format_gl.hpp>
+#include <be/gfx/tex/make_texture.hpp>
+#include <be/gfx/tex/pixel_access_norm.hpp>
+#include <be/gfx/tex/blit_pixels.hpp>
+#include <be/gfx/bgl.hpp>
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEX_BLIT_SSE2
+#endif
+
+using namespace be;
+using namespace be::gfx::gl;
+using namespace be::gfx::tex;
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+void rgb8_to_rgba8(const UC* src, UC* dest, std::size_t width) {
+   for (std::size_t i = 0; i < width; ++i) {
+      dest[0] = src[0];
+      dest[1] = src[1];
+      dest[2] = src[2];
+      dest[3] = 255;
+      src += 3;
+      dest += 4;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void rgba8_to_rgb8(const UC* src, UC* dest, std::size_t width) {
+   for (std::size_t i = 0; i < width; ++i) {
+      dest[0] = src[0];
+      dest[1] = src[1];
+      dest[2] = src[2];
+      src += 4;
+      dest += 3;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// RGBA8 <-> BGRA8; swapping bytes 0 and 2 is its own inverse.
+void swap_red_blue8(const UC* src, UC* dest, std::size_t width) {
+   std::size_t i = 0;
+#ifdef TEX_BLIT_SSE2
+   const __m128i green_alpha = _mm_set1_epi32(I32(0xff00ff00));
+   const __m128i low_byte = _mm_set1_epi32(0xff);
+   for (; i + 4 <= width; i += 4) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+      __m128i red_blue = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 16), low_byte),
+                                      _mm_slli_epi32(_mm_and_si128(v, low_byte), 16));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 4), _mm_or_si128(_mm_and_si128(v, green_alpha), red_blue));
+   }
+#endif
+   for (; i < width; ++i) {
+      UC r = src[i * 4 + 0];
+      dest[i * 4 + 0] = src[i * 4 + 2];
+      dest[i * 4 + 1] = src[i * 4 + 1];
+      dest[i * 4 + 2] = r;
+      dest[i * 4 + 3] = src[i * 4 + 3];
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// For formats that only differ in their colorspace tag.
+void copy_rgba8(const UC* src, UC* dest, std::size_t width) {
+   std::memcpy(dest, src, width * 4);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void rgba8_to_rgba32f(const UC* src, UC* dest, std::size_t width) {
+   F32* out = reinterpret_cast<F32*>(dest);
+   std::size_t i = 0;
+#ifdef TEX_BLIT_SSE2
+   const __m128 scale = _mm_set1_ps(1.f / 255.f);
+   const __m128i zero = _mm_setzero_si128();
+   for (; i + 4 <= width; i += 4) {
+      __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+      __m128i lo16 = _mm_unpacklo_epi8(bytes, zero);
+      __m128i hi16 = _mm_unpackhi_epi8(bytes, zero);
+      _mm_storeu_ps(out + i * 4 + 0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo16, zero)), scale));
+      _mm_storeu_ps(out + i * 4 + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo16, zero)), scale));
+      _mm_storeu_ps(out + i * 4 + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi16, zero)), scale));
+      _mm_storeu_ps(out + i * 4 + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi16, zero)), scale));
+   }
+#endif
+   for (std::size_t c = i * 4, n = width * 4; c < n; ++c) {
+      out[c] = F32(src[c]) * (1.f / 255.f);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void rgba32f_to_rgba8(const UC* src, UC* dest, std::size_t width) {
+   const F32* in = reinterpret_cast<const F32*>(src);
+   std::size_t i = 0;
+#ifdef TEX_BLIT_SSE2
+   const __m128 scale = _mm_set1_ps(255.f);
+   const __m128 half = _mm_set1_ps(0.5f);
+   const __m128 zero = _mm_setzero_ps();
+   const __m128 one = _mm_set1_ps(1.f);
+   for (; i + 4 <= width; i += 4) {
+      __m128i v[4];
+      for (int p = 0; p < 4; ++p) {
+         // same rounding as pack_unorm8(); max before min also maps NaN to 0
+         __m128 x = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i * 4 + p * 4), zero), one);
+         v[p] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(x, scale), half));
+      }
+      __m128i lo = _mm_packs_epi32(v[0], v[1]);
+      __m128i hi = _mm_packs_epi32(v[2], v[3]);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 4), _mm_packus_epi16(lo, hi));
+   }
+#endif
+   for (std::size_t c = i * 4, n = width * 4; c < n; ++c) {
+      dest[c] = pack_unorm8(in[c]);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void rgba32f_to_rgba16f(const UC* src, UC* dest, std::size_t width) {
+   pack_half(reinterpret_cast<const F32*>(src), reinterpret_cast<U16*>(dest), width * 4);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void rgba16f_to_rgba32f(const UC* src, UC* dest, std::size_t width) {
+   unpack_half(reinterpret_cast<const U16*>(src), reinterpret_cast<F32*>(dest), width * 4);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void rgba32f_to_r11g11b10f(const UC* src, UC* dest, std::size_t width) {
+   pack_r11g11b10f(reinterpret_cast<const vec4*>(src), reinterpret_cast<U32*>(dest), width);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void r11g11b10f_to_rgba32f(const UC* src, UC* dest, std::size_t width) {
+   unpack_r11g11b10f(reinterpret_cast<const U32*>(src), reinterpret_cast<vec4*>(dest), width);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void rgba32f_to_rgb9e5(const UC* src, UC* dest, std::size_t width) {
+   pack_rgb9e5(reinterpret_cast<const vec4*>(src), reinterpret_cast<U32*>(dest), width);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void rgb9e5_to_rgba32f(const UC* src, UC* dest, std::size_t width) {
+   unpack_rgb9e5(reinterpret_cast<const U32*>(src), reinterpret_cast<vec4*>(dest), width);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<BlitKernel> make_blit_kernels() {
+   ImageFormat rgb8 = canonical_format(GL_RGB8);
+   ImageFormat rgba8 = canonical_format(GL_RGBA8);
+   ImageFormat bgra8 = rgba8;
+   bgra8.swizzles(ImageFormat::swizzles_type(U8(Swizzle::blue), U8(Swizzle::green), U8(Swizzle::red), U8(Swizzle::alpha)));
+   ImageFormat srgb8 = canonical_format(GL_SRGB8);
+   ImageFormat srgb8_alpha8 = canonical_format(GL_SRGB8_ALPHA8);
+   ImageFormat rgba32f = canonical_format(GL_RGBA32F);
+   ImageFormat rgba16f = canonical_format(GL_RGBA16F);
+   ImageFormat r11g11b10f = canonical_format(GL_R11F_G11F_B10F);
+   ImageFormat rgb9e5 = canonical_format(GL_RGB9_E5);
+
+   std::vector<BlitKernel> kernels {
+      { "RGB8 -> RGBA8", rgb8, rgba8, rgb8_to_rgba8 },
+      { "RGBA8 -> RGB8", rgba8, rgb8, rgba8_to_rgb8 },
+      { "SRGB8 -> SRGB8_ALPHA8", srgb8, srgb8_alpha8, rgb8_to_rgba8 },
+      { "SRGB8_ALPHA8 -> SRGB8", srgb8_alpha8, srgb8, rgba8_to_rgb8 },
+      { "BGRA8 -> RGBA8", bgra8, rgba8, swap_red_blue8 },
+      { "RGBA8 -> BGRA8", rgba8, bgra8, swap_red_blue8 },
+      { "RGBA8 -> SRGB8_ALPHA8", rgba8, srgb8_alpha8, copy_rgba8 },
+      { "SRGB8_ALPHA8 -> RGBA8", srgb8_alpha8, rgba8, copy_rgba8 },
+      { "RGBA8 -> RGBA32F", rgba8, rgba32f, rgba8_to_rgba32f },
+      { "RGBA32F -> RGBA8", rgba32f, rgba8, rgba32f_to_rgba8 },
+   };
+
+   // the float packers must agree with put/get_pixel_norm to replace blit_pixels
+   if (float_pack_verified(rgba16f)) {
+      kernels.push_back({ "RGBA32F -> RGBA16F", rgba32f, rgba16f, rgba32f_to_rgba16f });
+      kernels.push_back({ "RGBA16F -> RGBA32F", rgba16f, rgba32f, rgba16f_to_rgba32f });
+   }
+   if (float_pack_verified(r11g11b10f)) {
+      kernels.push_back({ "RGBA32F -> R11F_G11F_B10F", rgba32f, r11g11b10f, rgba32f_to_r11g11b10f });
+      kernels.push_back({ "R11F_G11F_B10F -> RGBA32F", r11g11b10f, rgba32f, r11g11b10f_to_rgba32f });
+   }
+   if (float_pack_verified(rgb9e5)) {
+      kernels.push_back({ "RGBA32F -> RGB9_E5", rgba32f, rgb9e5, rgba32f_to_rgb9e5 });
+      kernels.push_back({ "RGB9_E5 -> RGBA32F", rgb9e5, rgba32f, rgb9e5_to_rgba32f });
+   }
+
+   return kernels;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void fill_random(ImageView& view, std::mt19937& rng) {
+   std::uniform_real_distribution<F32> dist(0.f, 1.f);
+   auto put = put_pixel_norm_func<ivec2>(view);
+   ivec2 dim = ivec2(view.dim());
+   for (ivec2 pc(0); pc.y < dim.y; ++pc.y) {
+      for (pc.x = 0; pc.x < dim.x; ++pc.x) {
+         put(view, pc, vec4(dist(rng), dist(rng), dist(rng), dist(rng)));
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+F32 max_abs_difference(const ImageView& a, const ImageView& b) {
+   auto get_a = get_pixel_norm_func<ivec2>(a);
+   auto get_b = get_pixel_norm_func<ivec2>(b);
+   ivec2 dim = ivec2(a.dim());
+   F32 result = 0.f;
+   for (ivec2 pc(0); pc.y < dim.y; ++pc.y) {
+      for (pc.x = 0; pc.x < dim.x; ++pc.x) {
+         vec4 d = glm::abs(get_a(a, pc) - get_b(b, pc));
+         result = std::max(result, std::max(std::max(d.x, d.y), std::max(d.z, d.w)));
+      }
+   }
+   return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename F>
+F64 time_mpixels_per_second(ivec2 dim, U32 repeats, F func) {
+   func(); // warm up caches and page in the destination
+   TU start = ts_now();
+   for (U32 i = 0; i < repeats; ++i) {
+      func();
+   }
+   F64 seconds = tu_to_seconds(ts_now() - start);
+   return seconds > 0 ? F64(dim.x) * F64(dim.y) * repeats / seconds / 1000000.0 : 0.0;
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+const std::vector<BlitKernel>& blit_kernels() {
+   static const std::vector<BlitKernel> kernels = make_blit_kernels();
+   return kernels;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const BlitKernel* find_blit_kernel(const ImageFormat& src, const ImageFormat& dest) {
+   for (auto& kernel : blit_kernels()) {
+      if (kernel.src == src && kernel.dest == dest) {
+         return &kernel;
+      }
+   }
+   return nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const char* blit_image(const ImageView& src, ImageView& dest) {
+   ivec3 dim = glm::min(src.dim(), dest.dim());
+   const BlitKernel* kernel = nullptr;
+   bool copy = src.format() == dest.format();
+   if (!copy) {
+      kernel = find_blit_kernel(src.format(), dest.format());
+      if (!kernel) {
+         blit_pixels(src, dest);
+         return "generic";
+      }
+   }
+
+   // spans count block rows and planes; kernels only exist for 1x1x1 blocks
+   ivec3 block_dim = ivec3(src.format().block_dim());
+   ivec3 blocks = (dim + block_dim - 1) / block_dim;
+   std::size_t row_bytes = std::size_t(blocks.x) * src.format().block_size();
+   for (I32 z = 0; z < blocks.z; ++z) {
+      const UC* src_plane = src.data() + std::size_t(z) * src.plane_span();
+      UC* dest_plane = dest.data() + std::size_t(z) * dest.plane_span();
+      for (I32 y = 0; y < blocks.y; ++y) {
+         const UC* src_row = src_plane + std::size_t(y) * src.line_span();
+         UC* dest_row = dest_plane + std::size_t(y) * dest.line_span();
+         if (copy) {
+            std::memcpy(dest_row, src_row, row_bytes);
+         } else {
+            kernel->row(src_row, dest_row, std::size_t(dim.x));
+         }
+      }
+   }
+
+   return copy ? "memcpy" : kernel->name;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<BlitBenchmark> benchmark_blits(ivec2 dim, U32 repeats) {
+   std::vector<BlitBenchmark> results;
+   std::mt19937 rng(1234);
+   repeats = std::max(repeats, 1u);
+
+   ImageFormat rgba8 = canonical_format(GL_RGBA8);
+   std::vector<BlitKernel> pairs = blit_kernels();
+   pairs.insert(pairs.begin(), BlitKernel { "memcpy", rgba8, rgba8, nullptr });
+
+   for (auto& pair : pairs) {
+      Texture src = make_planar_texture(pair.src, dim, 1);
+      Texture fast = make_planar_texture(pair.dest, dim, 1);
+      Texture generic = make_planar_texture(pair.dest, dim, 1);
+      ImageView src_view = src.view.image(0, 0, 0);
+      ImageView fast_view = fast.view.image(0, 0, 0);
+      ImageView generic_view = generic.view.image(0, 0, 0);
+      fill_random(src_view, rng);
+
+      BlitBenchmark result;
+      result.kernel = pair.name;
+      result.src = pair.src;
+      result.dest = pair.dest;
+      result.mpixels_per_second = time_mpixels_per_second(dim, repeats, [&]() {
+         blit_image(src_view, fast_view);
+      });
+      result.generic_mpixels_per_second = time_mpixels_per_second(dim, repeats, [&]() {
+         blit_pixels(src_view, generic_view);
+      });
+      result.max_abs_error = max_abs_difference(fast_view, generic_view);
+      results.push_back(result);
+   }
+
+   return results;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#ifndef TEX_BLIT_HPP_
+#define TEX_BLIT_HPP_
+
+#include <be/core/glm.hpp>
+#include <be/gfx/tex/image_view.hpp>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// Converts one row of width pixels.
+using BlitRowFunc = void(*)(const be::UC* src, be::UC* dest, std::size_t width);
+
+///////////////////////////////////////////////////////////////////////////////
+struct BlitKernel {
+   const char* name;
+   be::gfx::tex::ImageFormat src;
+   be::gfx::tex::ImageFormat dest;
+   BlitRowFunc row;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Registered kernels for specific (source, destination) format pairs.
+// Identical formats are always handled by copying rows and aren't listed.
+// Pairs that only differ in colorspace copy bytes as is, the same as
+// blit_pixels, which doesn't convert between colorspaces either.
+const std::vector<BlitKernel>& blit_kernels();
+const BlitKernel* find_blit_kernel(const be::gfx::tex::ImageFormat& src, const be::gfx::tex::ImageFormat& dest);
+
+///////////////////////////////////////////////////////////////////////////////
+// Same result as be::gfx::tex::blit_pixels over the overlapping region, but
+// uses a row copy or a registered kernel when one applies.  Returns the name
+// of the path taken ("memcpy", a kernel name, or "generic").
+const char* blit_image(const be::gfx::tex::ImageView& src, be::gfx::tex::ImageView& dest);
+
+///////////////////////////////////////////////////////////////////////////////
+struct BlitBenchmark {
+   const char* kernel;
+   be::gfx::tex::ImageFormat src;
+   be::gfx::tex::ImageFormat dest;
+   be::F64 mpixels_per_second;
+   be::F64 generic_mpixels_per_second;
+   be::F32 max_abs_error; // normalized, against blit_pixels
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Times every registered kernel plus a same-format copy against
+// blit_pixels on random images of the given size.
+std::vector<BlitBenchmark> benchmark_blits(be::ivec2 dim, be::U32 repeats);
+
+#endif
@@ -0,0 +1,553 @@
+#include "tex_block_encoder.hpp"
+#include "tex_channel_ops.hpp"
+#include "tex_pixel_writer.hpp"
+#include <be/gfx/tex/pixel_access_norm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEX_BLOCK_SSE2
+#endif
+
+using namespace be;
+using namespace be::gfx::gl;
+using namespace be::gfx::tex;
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+// Gathers 4x4 blocks as 64 bytes of RGBA8, clamping to the image edges.
+class BlockReader final {
+public:
+   explicit BlockReader(const ImageView& image)
+      : image_(image),
+        dim_(ivec2(image.dim())),
+        get_(get_pixel_norm_func<ivec2>(image)) {
+      ChannelLayout layout;
+      if (channel_layout(image.format(), layout) && layout.type == ChannelType::unorm8 && layout.channels >= 3) {
+         channels_ = layout.channels;
+      }
+   }
+
+   void operator()(ivec2 block, U8* px) const {
+      for (I32 y = 0; y < 4; ++y) {
+         I32 sy = std::min(block.y * 4 + y, dim_.y - 1);
+         for (I32 x = 0; x < 4; ++x) {
+            I32 sx = std::min(block.x * 4 + x, dim_.x - 1);
+            U8* out = px + (y * 4 + x) * 4;
+            if (channels_ > 0) {
+               const UC* in = image_.data() + std::size_t(sy) * image_.line_span() + std::size_t(sx) * channels_;
+               out[0] = in[0];
+               out[1] = in[1];
+               out[2] = in[2];
+               out[3] = channels_ == 4 ? in[3] : 255;
+            } else {
+               vec4 v = get_(image_, ivec2(sx, sy));
+               for (int c = 0; c < 4; ++c) {
+                  out[c] = pack_unorm8(v[c]);
+               }
+            }
+         }
+      }
+   }
+
+private:
+   const ImageView& image_;
+   ivec2 dim_;
+   decltype(get_pixel_norm_func<ivec2>(std::declval<const ImageView&>())) get_;
+   U32 channels_ = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+U16 pack_565(const F32 c[3]) {
+   U32 r = U32(glm::clamp(c[0], 0.f, 255.f) * (31.f / 255.f) + 0.5f);
+   U32 g = U32(glm::clamp(c[1], 0.f, 255.f) * (63.f / 255.f) + 0.5f);
+   U32 b = U32(glm::clamp(c[2], 0.f, 255.f) * (31.f / 255.f) + 0.5f);
+   return U16((r << 11) | (g << 5) | b);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void unpack_565(U16 v, I32 out[3]) {
+   I32 r = (v >> 11) & 31;
+   I32 g = (v >> 5) & 63;
+   I32 b = v & 31;
+   out[0] = (r << 3) | (r >> 2);
+   out[1] = (g << 2) | (g >> 4);
+   out[2] = (b << 3) | (b >> 2);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Palette in BC1 index order; four_color is always true for BC3.
+void color_palette(U16 c0, U16 c1, bool four_color, I32 palette[4][3]) {
+   unpack_565(c0, palette[0]);
+   unpack_565(c1, palette[1]);
+   for (int c = 0; c < 3; ++c) {
+      if (four_color) {
+         palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+         palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+      } else {
+         palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+         palette[3][c] = 0;
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Picks the nearest palette entry (RGB squared error) for each pixel and
+// returns the total error.
+U32 select_color_indices(const U8* px, const I32 palette[4][3], U8 indices[16]) {
+#ifdef TEX_BLOCK_SSE2
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+   __m128i pal[4];
+   for (int k = 0; k < 4; ++k) {
+      pal[k] = _mm_setr_epi16(I16(palette[k][0]), I16(palette[k][1]), I16(palette[k][2]), 0,
+                              I16(palette[k][0]), I16(palette[k][1]), I16(palette[k][2]), 0);
+   }
+
+   __m128i total = zero;
+   for (int group = 0; group < 4; ++group) {
+      __m128i bytes = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(px + group * 16)), rgb_mask);
+      __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+      __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+
+      __m128i best = zero;
+      __m128i best_index = zero;
+      for (int k = 0; k < 4; ++k) {
+         __m128i dlo = _mm_sub_epi16(lo, pal[k]);
+         __m128i dhi = _mm_sub_epi16(hi, pal[k]);
+         // (r^2 + g^2, b^2) for each pair of pixels
+         __m128 mlo = _mm_castsi128_ps(_mm_madd_epi16(dlo, dlo));
+         __m128 mhi = _mm_castsi128_ps(_mm_madd_epi16(dhi, dhi));
+         __m128i d = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(mlo, mhi, _MM_SHUFFLE(2, 0, 2, 0))),
+                                   _mm_castps_si128(_mm_shuffle_ps(mlo, mhi, _MM_SHUFFLE(3, 1, 3, 1))));
+         if (k == 0) {
+            best = d;
+         } else {
+            __m128i less = _mm_cmplt_epi32(d, best);
+            best = _mm_or_si128(_mm_and_si128(less, d), _mm_andnot_si128(less, best));
+            best_index = _mm_or_si128(_mm_and_si128(less, _mm_set1_epi32(k)), _mm_andnot_si128(less, best_index));
+         }
+      }
+
+      total = _mm_add_epi32(total, best);
+      alignas(16) I32 index[4];
+      _mm_store_si128(reinterpret_cast<__m128i*>(index), best_index);
+      for (int i = 0; i < 4; ++i) {
+         indices[group * 4 + i] = U8(index[i]);
+      }
+   }
+
+   alignas(16) U32 sums[4];
+   _mm_store_si128(reinterpret_cast<__m128i*>(sums), total);
+   return sums[0] + sums[1] + sums[2] + sums[3];
+#else
+   U32 total = 0;
+   for (int i = 0; i < 16; ++i) {
+      U32 best = std::numeric_limits<U32>::max();
+      for (int k = 0; k < 4; ++k) {
+         U32 d = 0;
+         for (int c = 0; c < 3; ++c) {
+            I32 diff = I32(px[i * 4 + c]) - palette[k][c];
+            d += U32(diff * diff);
+         }
+         if (d < best) {
+            best = d;
+            indices[i] = U8(k);
+         }
+      }
+      total += best;
+   }
+   return total;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+struct ColorBlock {
+   U16 c0;
+   U16 c1;
+   U8 indices[16];
+   U32 error;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Quantizes both endpoints, orders them for four-color mode and selects
+// indices.
+ColorBlock fit_color_block(const U8* px, const F32 e0[3], const F32 e1[3]) {
+   ColorBlock block;
+   block.c0 = pack_565(e0);
+   block.c1 = pack_565(e1);
+   if (block.c0 < block.c1) {
+      std::swap(block.c0, block.c1);
+   }
+
+   I32 palette[4][3];
+   color_palette(block.c0, block.c1, true, palette);
+   if (block.c0 == block.c1) {
+      // three-color mode in BC1, where only index 0 is safe
+      std::fill(std::begin(block.indices), std::end(block.indices), U8(0));
+      block.error = 0;
+      for (int i = 0; i < 16; ++i) {
+         for (int c = 0; c < 3; ++c) {
+            I32 diff = I32(px[i * 4 + c]) - palette[0][c];
+            block.error += U32(diff * diff);
+         }
+      }
+   } else {
+      block.error = select_color_indices(px, palette, block.indices);
+   }
+   return block;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void bounding_box_endpoints(const U8* px, F32 e0[3], F32 e1[3]) {
+   for (int c = 0; c < 3; ++c) {
+      U8 lo = 255;
+      U8 hi = 0;
+      for (int i = 0; i < 16; ++i) {
+         lo = std::min(lo, px[i * 4 + c]);
+         hi = std::max(hi, px[i * 4 + c]);
+      }
+      // inset slightly so the interpolated entries land on the data
+      F32 inset = F32(hi - lo) / 16.f;
+      e0[c] = F32(hi) - inset;
+      e1[c] = F32(lo) + inset;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void principal_axis_endpoints(const U8* px, F32 e0[3], F32 e1[3]) {
+   F32 mean[3] = { 0.f, 0.f, 0.f };
+   for (int i = 0; i < 16; ++i) {
+      for (int c = 0; c < 3; ++c) {
+         mean[c] += F32(px[i * 4 + c]);
+      }
+   }
+   for (int c = 0; c < 3; ++c) {
+      mean[c] /= 16.f;
+   }
+
+   F32 cov[6] = { 0.f, 0.f, 0.f, 0.f, 0.f, 0.f }; // rr rg rb gg gb bb
+   for (int i = 0; i < 16; ++i) {
+      F32 r = F32(px[i * 4 + 0]) - mean[0];
+      F32 g = F32(px[i * 4 + 1]) - mean[1];
+      F32 b = F32(px[i * 4 + 2]) - mean[2];
+      cov[0] += r * r;
+      cov[1] += r * g;
+      cov[2] += r * b;
+      cov[3] += g * g;
+      cov[4] += g * b;
+      cov[5] += b * b;
+   }
+
+   // power iteration, starting from the bounding box diagonal
+   F32 lo[3];
+   F32 hi[3];
+   bounding_box_endpoints(px, hi, lo);
+   F32 axis[3] = { hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2] };
+   for (int iteration = 0; iteration < 8; ++iteration) {
+      F32 next[3] = {
+         cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+         cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+         cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]
+      };
+      F32 scale = std::max(std::abs(next[0]), std::max(std::abs(next[1]), std::abs(next[2])));
+      if (scale < 1e-6f) {
+         break;
+      }
+      for (int c = 0; c < 3; ++c) {
+         axis[c] = next[c] / scale;
+      }
+   }
+
+   F32 length2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+   if (length2 < 1e-12f) {
+      for (int c = 0; c < 3; ++c) {
+         e0[c] = e1[c] = mean[c];
+      }
+      return;
+   }
+
+   F32 tmin = std::numeric_limits<F32>::max();
+   F32 tmax = -std::numeric_limits<F32>::max();
+   for (int i = 0; i < 16; ++i) {
+      F32 t = 0.f;
+      for (int c = 0; c < 3; ++c) {
+         t += (F32(px[i * 4 + c]) - mean[c]) * axis[c];
+      }
+      tmin = std::min(tmin, t);
+      tmax = std::max(tmax, t);
+   }
+
+   F32 inset = (tmax - tmin) / 16.f;
+   tmin = (tmin + inset) / length2;
+   tmax = (tmax - inset) / length2;
+   for (int c = 0; c < 3; ++c) {
+      e0[c] = mean[c] + axis[c] * tmax;
+      e1[c] = mean[c] + axis[c] * tmin;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Solves for the endpoints that minimize the error for the current indices.
+bool refine_endpoints(const U8* px, const ColorBlock& block, F32 e0[3], F32 e1[3]) {
+   static const F32 weights[4] = { 1.f, 0.f, 2.f / 3.f, 1.f / 3.f };
+   F32 aa = 0.f;
+   F32 bb = 0.f;
+   F32 ab = 0.f;
+   F32 ax[3] = { 0.f, 0.f, 0.f };
+   F32 bx[3] = { 0.f, 0.f, 0.f };
+   for (int i = 0; i < 16; ++i) {
+      F32 a = weights[block.indices[i]];
+      F32 b = 1.f - a;
+      aa += a * a;
+      bb += b * b;
+      ab += a * b;
+      for (int c = 0; c < 3; ++c) {
+         ax[c] += a * F32(px[i * 4 + c]);
+         bx[c] += b * F32(px[i * 4 + c]);
+      }
+   }
+
+   F32 det = aa * bb - ab * ab;
+   if (std::abs(det) < 1e-6f) {
+      return false;
+   }
+   for (int c = 0; c < 3; ++c) {
+      e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+      e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+   }
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void write_u16(UC* dest, U16 v) {
+   dest[0] = UC(v & 0xFF);
+   dest[1] = UC(v >> 8);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void encode_color_block(const U8* px, BlockQuality quality, UC* dest) {
+   F32 e0[3];
+   F32 e1[3];
+   if (quality == BlockQuality::fast) {
+      bounding_box_endpoints(px, e0, e1);
+   } else {
+      principal_axis_endpoints(px, e0, e1);
+   }
+
+   ColorBlock block = fit_color_block(px, e0, e1);
+   if (quality == BlockQuality::high) {
+      for (int iteration = 0; iteration < 2 && block.error > 0; ++iteration) {
+         if (!refine_endpoints(px, block, e0, e1)) {
+            break;
+         }
+         ColorBlock refined = fit_color_block(px, e0, e1);
+         if (refined.error >= block.error) {
+            break;
+         }
+         block = refined;
+      }
+   }
+
+   U32 bits = 0;
+   for (int i = 0; i < 16; ++i) {
+      bits |= U32(block.indices[i]) << (i * 2);
+   }
+   write_u16(dest, block.c0);
+   write_u16(dest + 2, block.c1);
+   write_u16(dest + 4, U16(bits & 0xFFFF));
+   write_u16(dest + 6, U16(bits >> 16));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void alpha_palette(U8 a0, U8 a1, I32 palette[8]) {
+   palette[0] = a0;
+   palette[1] = a1;
+   if (a0 > a1) {
+      for (int i = 1; i < 7; ++i) {
+         palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+      }
+   } else {
+      for (int i = 1; i < 5; ++i) {
+         palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+      }
+      palette[6] = 0;
+      palette[7] = 255;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void encode_alpha_block(const U8* px, UC* dest) {
+   U8 a0 = 0;
+   U8 a1 = 255;
+   for (int i = 0; i < 16; ++i) {
+      a0 = std::max(a0, px[i * 4 + 3]);
+      a1 = std::min(a1, px[i * 4 + 3]);
+   }
+
+   U64 bits = 0;
+   if (a0 != a1) {
+      I32 palette[8];
+      alpha_palette(a0, a1, palette);
+      for (int i = 0; i < 16; ++i) {
+         I32 a = px[i * 4 + 3];
+         U64 index = 0;
+         I32 best = 256;
+         for (int k = 0; k < 8; ++k) {
+            I32 d = std::abs(a - palette[k]);
+            if (d < best) {
+               best = d;
+               index = U64(k);
+            }
+         }
+         bits |= index << (i * 3);
+      }
+   }
+
+   dest[0] = a0;
+   dest[1] = a1;
+   for (int i = 0; i < 6; ++i) {
+      dest[2 + i] = UC((bits >> (i * 8)) & 0xFF);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U16 read_u16(const UC* src) {
+   return U16(src[0] | (src[1] << 8));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void decode_block(BlockCodec codec, const UC* src, U8* px) {
+   if (codec == BlockCodec::bc3) {
+      I32 palette[8];
+      alpha_palette(src[0], src[1], palette);
+      U64 bits = 0;
+      for (int i = 0; i < 6; ++i) {
+         bits |= U64(src[2 + i]) << (i * 8);
+      }
+      for (int i = 0; i < 16; ++i) {
+         px[i * 4 + 3] = U8(palette[(bits >> (i * 3)) & 7]);
+      }
+      src += 8;
+   } else {
+      for (int i = 0; i < 16; ++i) {
+         px[i * 4 + 3] = 255;
+      }
+   }
+
+   U16 c0 = read_u16(src);
+   U16 c1 = read_u16(src + 2);
+   U32 bits = U32(read_u16(src + 4)) | (U32(read_u16(src + 6)) << 16);
+   I32 palette[4][3];
+   color_palette(c0, c1, codec == BlockCodec::bc3 || c0 > c1, palette);
+   for (int i = 0; i < 16; ++i) {
+      const I32* color = palette[(bits >> (i * 2)) & 3];
+      for (int c = 0; c < 3; ++c) {
+         px[i * 4 + c] = U8(color[c]);
+      }
+   }
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+const char* block_codec_name(BlockCodec codec) {
+   switch (codec) {
+      case BlockCodec::bc1: return "BC1";
+      case BlockCodec::bc3: return "BC3";
+      default:              return "?";
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const char* block_quality_name(BlockQuality quality) {
+   switch (quality) {
+      case BlockQuality::fast:   return "fast";
+      case BlockQuality::normal: return "normal";
+      case BlockQuality::high:   return "high";
+      default:                   return "?";
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t block_bytes(BlockCodec codec) {
+   return codec == BlockCodec::bc3 ? 16 : 8;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+GLenum CompressedImage::gl_format() const {
+   if (codec == BlockCodec::bc3) {
+      return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+   }
+   return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void encode_blocks(TileScheduler& scheduler, const ImageView& image, BlockCodec codec, BlockQuality quality, CompressedImage& out) {
+   ivec2 dim = ivec2(image.dim());
+   ivec2 blocks = ivec2((dim.x + 3) / 4, (dim.y + 3) / 4);
+   std::size_t bytes = block_bytes(codec);
+
+   out.codec = codec;
+   out.dim = dim;
+   out.srgb = image.format().colorspace() == Colorspace::srgb;
+   out.data.resize(std::size_t(blocks.x) * std::size_t(blocks.y) * bytes);
+
+   BlockReader reader(image);
+   scheduler.run(blocks, choose_tile_dim(blocks, 64), [&](const Tile& tile) {
+      alignas(16) U8 px[64];
+      for (I32 by = tile.offset.y; by < tile.offset.y + tile.dim.y; ++by) {
+         UC* dest = out.data.data() + (std::size_t(by) * std::size_t(blocks.x) + std::size_t(tile.offset.x)) * bytes;
+         for (I32 bx = tile.offset.x; bx < tile.offset.x + tile.dim.x; ++bx) {
+            reader(ivec2(bx, by), px);
+            if (codec == BlockCodec::bc3) {
+               encode_alpha_block(px, dest);
+               encode_color_block(px, quality, dest + 8);
+            } else {
+               encode_color_block(px, quality, dest);
+            }
+            dest += bytes;
+         }
+      }
+   });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+F64 block_psnr(const ImageView& image, const CompressedImage& compressed) {
+   ivec2 dim = ivec2(image.dim());
+   ivec2 blocks = ivec2((dim.x + 3) / 4, (dim.y + 3) / 4);
+   std::size_t bytes = block_bytes(compressed.codec);
+   int channels = compressed.codec == BlockCodec::bc3 ? 4 : 3;
+   if (compressed.dim != dim || compressed.data.size() < std::size_t(blocks.x) * std::size_t(blocks.y) * bytes) {
+      return 0.0;
+   }
+
+   BlockReader reader(image);
+   U8 original[64];
+   U8 decoded[64];
+   F64 total = 0.0;
+   F64 samples = 0.0;
+   for (I32 by = 0; by < blocks.y; ++by) {
+      for (I32 bx = 0; bx < blocks.x; ++bx) {
+         reader(ivec2(bx, by), original);
+         decode_block(compressed.codec, compressed.data.data() + (std::size_t(by) * std::size_t(blocks.x) + std::size_t(bx)) * bytes, decoded);
+         for (I32 y = 0; y < 4 && by * 4 + y < dim.y; ++y) {
+            for (I32 x = 0; x < 4 && bx * 4 + x < dim.x; ++x) {
+               for (int c = 0; c < channels; ++c) {
+                  F64 diff = F64(original[(y * 4 + x) * 4 + c]) - F64(decoded[(y * 4 + x) * 4 + c]);
+                  total += diff * diff;
+               }
+               samples += channels;
+            }
+         }
+      }
+   }
+
+   if (total <= 0.0 || samples <= 0.0) {
+      return std::numeric_limits<F64>::infinity();
+   }
+   return 10.0 * std::log10(255.0 * 255.0 / (total / samples));
+}
@@ -0,0 +1,54 @@
+#pragma once
+#ifndef TEX_BLOCK_ENCODER_HPP_
+#define TEX_BLOCK_ENCODER_HPP_
+
+#include "tex_tile_scheduler.hpp"
+#include <be/core/glm.hpp>
+#include <be/gfx/tex/image_view.hpp>
+#include <be/gfx/bgl.hpp>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+enum class BlockCodec {
+   bc1, // RGB, 8 bytes per 4x4 block; alpha is dropped
+   bc3  // RGBA, 16 bytes per 4x4 block
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// fast: bounding box endpoints.  normal: endpoints along the principal axis
+// of each block's colors.  high: normal, then least-squares refinement of
+// the endpoints for the chosen indices.
+enum class BlockQuality {
+   fast,
+   normal,
+   high
+};
+
+///////////////////////////////////////////////////////////////////////////////
+const char* block_codec_name(BlockCodec codec);
+const char* block_quality_name(BlockQuality quality);
+std::size_t block_bytes(BlockCodec codec);
+
+///////////////////////////////////////////////////////////////////////////////
+struct CompressedImage {
+   BlockCodec codec = BlockCodec::bc1;
+   be::ivec2 dim;
+   bool srgb = false;
+   std::vector<be::UC> data;
+
+   be::gfx::gl::GLenum gl_format() const;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Encodes any format with normalized pixel access; RGB8/RGBA8 and their
+// sRGB variants are read directly.  Values are encoded as stored, so sRGB
+// sources produce sRGB compressed formats.  Edge blocks repeat the last
+// row/column.  Blocks are spread across the scheduler's threads.
+void encode_blocks(TileScheduler& scheduler, const be::gfx::tex::ImageView& image, BlockCodec codec, BlockQuality quality, CompressedImage& out);
+
+///////////////////////////////////////////////////////////////////////////////
+// Decodes compressed and compares it with image over the RGB channels (and
+// alpha for BC3).  Returns infinity for a lossless result.
+be::F64 block_psnr(const be::gfx::tex::ImageView& image, const CompressedImage& compressed);
+
+#endif
@@ -0,0 +1,438 @@
+#include "tex_channel_ops.hpp"
+#include "tex_float_pack.hpp"
+#include <be/gfx/tex/image_format_gl.hpp>
+#include <be/gfx/tex/convert_colorspace_static.hpp>
+#include <be/gfx/bgl.hpp>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using namespace be;
+using namespace be::gfx::gl;
+using namespace be::gfx::tex;
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+struct LayoutEntry {
+   ImageFormat format;
+   ChannelLayout layout;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<LayoutEntry> make_layouts() {
+   struct Desc {
+      GLenum internal_format;
+      ChannelType type;
+      U8 channels;
+   };
+
+   const Desc descs[] = {
+      { GL_R8,       ChannelType::unorm8,  1 }, { GL_RG8,      ChannelType::unorm8,  2 },
+      { GL_RGB8,     ChannelType::unorm8,  3 }, { GL_RGBA8,    ChannelType::unorm8,  4 },
+      { GL_SRGB8,    ChannelType::unorm8,  3 }, { GL_SRGB8_ALPHA8, ChannelType::unorm8, 4 },
+      { GL_R16,      ChannelType::unorm16, 1 }, { GL_RG16,     ChannelType::unorm16, 2 },
+      { GL_RGB16,    ChannelType::unorm16, 3 }, { GL_RGBA16,   ChannelType::unorm16, 4 },
+      { GL_R16F,     ChannelType::float16, 1 }, { GL_RG16F,    ChannelType::float16, 2 },
+      { GL_RGB16F,   ChannelType::float16, 3 }, { GL_RGBA16F,  ChannelType::float16, 4 },
+      { GL_R32F,     ChannelType::float32, 1 }, { GL_RG32F,    ChannelType::float32, 2 },
+      { GL_RGB32F,   ChannelType::float32, 3 }, { GL_RGBA32F,  ChannelType::float32, 4 },
+   };
+
+   std::vector<LayoutEntry> layouts;
+   for (auto& desc : descs) {
+      layouts.push_back(LayoutEntry { canonical_format(desc.internal_format), ChannelLayout { desc.type, desc.channels } });
+   }
+   return layouts;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename F>
+void visit_rows(const ImageView& view, F func) {
+   ivec3 dim = view.dim();
+   for (I32 z = 0; z < dim.z; ++z) {
+      UC* plane = view.data() + std::size_t(z) * view.plane_span();
+      for (I32 y = 0; y < dim.y; ++y) {
+         func(plane + std::size_t(y) * view.line_span(), std::size_t(dim.x));
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Channel count is a template parameter so the inner loops have a constant
+// stride and vectorize.
+template <typename T, U32 C>
+void fill_rows(const ImageView& view, U32 channel, T value) {
+   visit_rows(view, [=](UC* row, std::size_t width) {
+      T* p = reinterpret_cast<T*>(row) + channel;
+      for (std::size_t i = 0; i < width; ++i) {
+         p[i * C] = value;
+      }
+   });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+void fill_rows(const ImageView& view, U32 channels, U32 channel, T value) {
+   switch (channels) {
+      case 1: fill_rows<T, 1>(view, channel, value); break;
+      case 2: fill_rows<T, 2>(view, channel, value); break;
+      case 3: fill_rows<T, 3>(view, channel, value); break;
+      default: fill_rows<T, 4>(view, channel, value); break;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename T, U32 C>
+void swizzle_rows(const ImageView& view, std::array<U8, 4> order) {
+   visit_rows(view, [=](UC* row, std::size_t width) {
+      T* p = reinterpret_cast<T*>(row);
+      for (std::size_t i = 0; i < width; ++i) {
+         T in[C];
+         for (U32 c = 0; c < C; ++c) {
+            in[c] = p[c];
+         }
+         for (U32 c = 0; c < C; ++c) {
+            p[c] = in[order[c]];
+         }
+         p += C;
+      }
+   });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+void swizzle_rows(const ImageView& view, U32 channels, std::array<U8, 4> order) {
+   switch (channels) {
+      case 2: swizzle_rows<T, 2>(view, order); break;
+      case 3: swizzle_rows<T, 3>(view, order); break;
+      case 4: swizzle_rows<T, 4>(view, order); break;
+      default: break;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// c * a / max, rounded to nearest, for 8 and 16 bit unorm channels.
+template <typename T>
+T unorm_mul(U32 c, U32 a) {
+   constexpr U32 max = U32(T(~T(0)));
+   return T((c * a + max / 2) / max);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <>
+U8 unorm_mul<U8>(U32 c, U32 a) {
+   U32 x = c * a + 128;
+   return U8((x + (x >> 8)) >> 8);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+T unorm_div(U32 c, U32 a) {
+   constexpr U32 max = U32(T(~T(0)));
+   if (a == 0) {
+      return 0;
+   }
+   return T(std::min<U64>(max, (U64(c) * max + a / 2) / a));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+void premultiply_unorm(const ImageView& view) {
+   visit_rows(view, [](UC* row, std::size_t width) {
+      T* p = reinterpret_cast<T*>(row);
+      for (std::size_t i = 0; i < width; ++i, p += 4) {
+         U32 a = p[3];
+         p[0] = unorm_mul<T>(p[0], a);
+         p[1] = unorm_mul<T>(p[1], a);
+         p[2] = unorm_mul<T>(p[2], a);
+      }
+   });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+void unpremultiply_unorm(const ImageView& view) {
+   visit_rows(view, [](UC* row, std::size_t width) {
+      T* p = reinterpret_cast<T*>(row);
+      for (std::size_t i = 0; i < width; ++i, p += 4) {
+         U32 a = p[3];
+         p[0] = unorm_div<T>(p[0], a);
+         p[1] = unorm_div<T>(p[1], a);
+         p[2] = unorm_div<T>(p[2], a);
+      }
+   });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+struct Srgb8Tables {
+   F32 linear[256];
+   // linear values halfway between adjacent codes (in encoded space), so
+   // encoding rounds to the nearest code
+   F32 thresholds[255];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+const Srgb8Tables& srgb8_tables() {
+   static const Srgb8Tables tables = []() {
+      Srgb8Tables t;
+      for (U32 c = 0; c < 256; ++c) {
+         F32 v = F32(c) / 255.f;
+         t.linear[c] = convert_colorspace<Colorspace::srgb, Colorspace::bt709_linear_rgb>(vec4(v, v, v, 1.f)).r;
+      }
+      for (U32 c = 0; c < 255; ++c) {
+         F32 v = (F32(c) + 0.5f) / 255.f;
+         t.thresholds[c] = convert_colorspace<Colorspace::srgb, Colorspace::bt709_linear_rgb>(vec4(v, v, v, 1.f)).r;
+      }
+      return t;
+   }();
+   return tables;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// sRGB channels are multiplied in linear light.  Both results only depend on
+// the encoded channel and alpha bytes, so they're tabulated per (alpha, c).
+struct SrgbAlphaTables {
+   std::vector<U8> premultiply;   // [a * 256 + c]
+   std::vector<U8> unpremultiply; // [a * 256 + c]
+};
+
+///////////////////////////////////////////////////////////////////////////////
+const SrgbAlphaTables& srgb_alpha_tables() {
+   static const SrgbAlphaTables tables = []() {
+      const F32* linear = srgb8_tables().linear;
+
+      SrgbAlphaTables t;
+      t.premultiply.resize(256 * 256);
+      t.unpremultiply.resize(256 * 256);
+      for (U32 a = 0; a < 256; ++a) {
+         F32 alpha = F32(a) / 255.f;
+         for (U32 c = 0; c < 256; ++c) {
+            t.premultiply[a * 256 + c] = linear_to_srgb8(linear[c] * alpha);
+            t.unpremultiply[a * 256 + c] = a == 0 ? U8(0) : linear_to_srgb8(std::min(1.f, linear[c] / alpha));
+         }
+      }
+      return t;
+   }();
+   return tables;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void apply_srgb_alpha_table(const ImageView& view, const std::vector<U8>& table) {
+   const U8* t = table.data();
+   visit_rows(view, [=](UC* row, std::size_t width) {
+      UC* p = row;
+      for (std::size_t i = 0; i < width; ++i, p += 4) {
+         const U8* lut = t + std::size_t(p[3]) * 256;
+         p[0] = lut[p[0]];
+         p[1] = lut[p[1]];
+         p[2] = lut[p[2]];
+      }
+   });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Unpacks each row to floats and packs it back with the bulk half packers.
+template <typename F>
+void visit_half_rows(const ImageView& view, F func) {
+   std::vector<F32> values;
+   visit_rows(view, [&](UC* row, std::size_t width) {
+      U16* p = reinterpret_cast<U16*>(row);
+      values.resize(width * 4);
+      unpack_half(p, values.data(), values.size());
+      func(values.data(), width);
+      pack_half(values.data(), p, values.size());
+   });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void premultiply_floats(F32* p, std::size_t width) {
+   for (std::size_t i = 0; i < width; ++i, p += 4) {
+      p[0] *= p[3];
+      p[1] *= p[3];
+      p[2] *= p[3];
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void unpremultiply_floats(F32* p, std::size_t width) {
+   for (std::size_t i = 0; i < width; ++i, p += 4) {
+      F32 scale = p[3] != 0.f ? 1.f / p[3] : 0.f;
+      p[0] *= scale;
+      p[1] *= scale;
+      p[2] *= scale;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool find_layout(const ImageView& view, ChannelLayout& layout) {
+   return view.data() != nullptr && channel_layout(view.format(), layout);
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+bool channel_layout(const ImageFormat& format, ChannelLayout& layout) {
+   static const std::vector<LayoutEntry> layouts = make_layouts();
+   for (auto& entry : layouts) {
+      if (entry.format == format) {
+         layout = entry.layout;
+         return true;
+      }
+   }
+   return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool fill_channel(ImageView& view, U32 channel, F32 value) {
+   ChannelLayout layout;
+   if (!find_layout(view, layout) || channel >= layout.channels) {
+      return false;
+   }
+
+   value = layout.type == ChannelType::float16 || layout.type == ChannelType::float32 ? value : glm::clamp(value, 0.f, 1.f);
+   switch (layout.type) {
+      case ChannelType::unorm8:
+         if (layout.channels == 4 && channel == 3) {
+            // whole pixels at a time; the same OR works regardless of endianness
+            U32 mask;
+            UC bytes[4] = { 0, 0, 0, U8(value * 255.f + 0.5f) };
+            std::memcpy(&mask, bytes, sizeof(mask));
+            UC keep_bytes[4] = { 0xFF, 0xFF, 0xFF, 0 };
+            U32 keep;
+            std::memcpy(&keep, keep_bytes, sizeof(keep));
+            visit_rows(view, [=](UC* row, std::size_t width) {
+               U32* p = reinterpret_cast<U32*>(row);
+               for (std::size_t i = 0; i < width; ++i) {
+                  p[i] = (p[i] & keep) | mask;
+               }
+            });
+         } else {
+            fill_rows<U8>(view, layout.channels, channel, U8(value * 255.f + 0.5f));
+         }
+         break;
+      case ChannelType::unorm16:
+         fill_rows<U16>(view, layout.channels, channel, U16(value * 65535.f + 0.5f));
+         break;
+      case ChannelType::float16:
+         fill_rows<U16>(view, layout.channels, channel, U16(glm::packHalf1x16(value)));
+         break;
+      case ChannelType::float32:
+         fill_rows<F32>(view, layout.channels, channel, value);
+         break;
+   }
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool copy_channel(const ImageView& src, U32 src_channel, ImageView& dest, U32 dest_channel) {
+   ChannelLayout src_layout;
+   ChannelLayout dest_layout;
+   if (!find_layout(src, src_layout) || !find_layout(dest, dest_layout) ||
+       src_layout.type != dest_layout.type ||
+       src_channel >= src_layout.channels || dest_channel >= dest_layout.channels) {
+      return false;
+   }
+
+   std::size_t bytes = src_layout.type == ChannelType::unorm8 ? 1 : src_layout.type == ChannelType::float32 ? 4 : 2;
+   std::size_t src_stride = bytes * src_layout.channels;
+   std::size_t dest_stride = bytes * dest_layout.channels;
+   ivec3 dim = glm::min(src.dim(), dest.dim());
+   for (I32 z = 0; z < dim.z; ++z) {
+      for (I32 y = 0; y < dim.y; ++y) {
+         const UC* s = src.data() + std::size_t(z) * src.plane_span() + std::size_t(y) * src.line_span() + bytes * src_channel;
+         UC* d = dest.data() + std::size_t(z) * dest.plane_span() + std::size_t(y) * dest.line_span() + bytes * dest_channel;
+         for (I32 x = 0; x < dim.x; ++x) {
+            std::memcpy(d, s, bytes);
+            s += src_stride;
+            d += dest_stride;
+         }
+      }
+   }
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool swizzle_channels(ImageView& view, std::array<U8, 4> order) {
+   ChannelLayout layout;
+   if (!find_layout(view, layout)) {
+      return false;
+   }
+   for (U32 c = 0; c < layout.channels; ++c) {
+      if (order[c] >= layout.channels) {
+         return false;
+      }
+   }
+
+   switch (layout.type) {
+      case ChannelType::unorm8:  swizzle_rows<U8>(view, layout.channels, order); break;
+      case ChannelType::unorm16:
+      case ChannelType::float16: swizzle_rows<U16>(view, layout.channels, order); break;
+      case ChannelType::float32: swizzle_rows<U32>(view, layout.channels, order); break;
+   }
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool premultiply_alpha(ImageView& view) {
+   ChannelLayout layout;
+   if (!find_layout(view, layout) || layout.channels != 4) {
+      return false;
+   }
+
+   switch (layout.type) {
+      case ChannelType::unorm8:
+         if (view.format().colorspace() == Colorspace::srgb) {
+            apply_srgb_alpha_table(view, srgb_alpha_tables().premultiply);
+         } else {
+            premultiply_unorm<U8>(view);
+         }
+         return true;
+      case ChannelType::unorm16: premultiply_unorm<U16>(view); return true;
+      case ChannelType::float16: visit_half_rows(view, premultiply_floats); return true;
+      case ChannelType::float32:
+         visit_rows(view, [](UC* row, std::size_t width) {
+            premultiply_floats(reinterpret_cast<F32*>(row), width);
+         });
+         return true;
+   }
+   return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool unpremultiply_alpha(ImageView& view) {
+   ChannelLayout layout;
+   if (!find_layout(view, layout) || layout.channels != 4) {
+      return false;
+   }
+
+   switch (layout.type) {
+      case ChannelType::unorm8:
+         if (view.format().colorspace() == Colorspace::srgb) {
+            apply_srgb_alpha_table(view, srgb_alpha_tables().unpremultiply);
+         } else {
+            unpremultiply_unorm<U8>(view);
+         }
+         return true;
+      case ChannelType::unorm16: unpremultiply_unorm<U16>(view); return true;
+      case ChannelType::float16: visit_half_rows(view, unpremultiply_floats); return true;
+      case ChannelType::float32:
+         visit_rows(view, [](UC* row, std::size_t width) {
+            unpremultiply_floats(reinterpret_cast<F32*>(row), width);
+         });
+         return true;
+   }
+   return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+F32 srgb8_to_linear(U8 c) {
+   return srgb8_tables().linear[c];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U8 linear_to_srgb8(F32 v) {
+   const F32* thresholds = srgb8_tables().thresholds;
+   return U8(std::upper_bound(thresholds, thresholds + 255, v) - thresholds);
+}
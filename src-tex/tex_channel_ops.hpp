@@ -0,0 +1,51 @@
+#pragma once
+#ifndef TEX_CHANNEL_OPS_HPP_
+#define TEX_CHANNEL_OPS_HPP_
+
+#include <be/core/glm.hpp>
+#include <be/gfx/tex/image_view.hpp>
+#include <array>
+
+///////////////////////////////////////////////////////////////////////////////
+enum class ChannelType : be::U8 {
+   unorm8,
+   unorm16,
+   float16,
+   float32
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Describes formats whose pixels are 1-4 equally sized, byte-aligned
+// channels in RGBA order.  Packed formats (RGB10_A2, RGB9_E5, ...) and
+// integer formats aren't covered.
+struct ChannelLayout {
+   ChannelType type;
+   be::U8 channels;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+bool channel_layout(const be::gfx::tex::ImageFormat& format, ChannelLayout& layout);
+
+///////////////////////////////////////////////////////////////////////////////
+// Whole-image channel operations.  Each returns false without touching the
+// image if its format has no ChannelLayout (or the channel doesn't exist), so
+// callers can fall back to per-pixel access.  value is normalized.
+bool fill_channel(be::gfx::tex::ImageView& view, be::U32 channel, be::F32 value);
+bool copy_channel(const be::gfx::tex::ImageView& src, be::U32 src_channel, be::gfx::tex::ImageView& dest, be::U32 dest_channel);
+
+// Channel c of each output pixel takes channel order[c] of the input.
+// Entries past the format's channel count are ignored.
+bool swizzle_channels(be::gfx::tex::ImageView& view, std::array<be::U8, 4> order);
+
+// Require 4 channels.  sRGB color channels are converted to linear, scaled,
+// and re-encoded; alpha is always linear.
+bool premultiply_alpha(be::gfx::tex::ImageView& view);
+bool unpremultiply_alpha(be::gfx::tex::ImageView& view);
+
+///////////////////////////////////////////////////////////////////////////////
+// 8-bit sRGB codes to and from linear values in [0, 1], via lookup tables.
+// Encoding rounds to the nearest code.
+be::F32 srgb8_to_linear(be::U8 c);
+be::U8 linear_to_srgb8(be::F32 v);
+
+#endif
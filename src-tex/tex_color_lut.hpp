@@ -0,0 +1,123 @@
+#pragma once
+#ifndef TEX_COLOR_LUT_HPP_
+#define TEX_COLOR_LUT_HPP_
+
+#include <be/core/glm.hpp>
+#include <be/gfx/tex/convert_colorspace_static.hpp>
+#include <glm/common.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// Samples a function of one variable at size + 1 evenly spaced points in
+// [0, 1] and interpolates linearly between them.  If wrap is set, inputs are
+// taken modulo 1 (e.g. hue); otherwise they are clamped.
+class ColorLut1D final {
+public:
+   template <typename F>
+   void build(std::size_t size, bool wrap, F func) {
+      size_ = std::max(size, std::size_t(1));
+      wrap_ = wrap;
+      entries_.resize(size_ + 1);
+      for (std::size_t i = 0; i <= size_; ++i) {
+         entries_[i] = func(be::F32(i) / be::F32(size_));
+      }
+      if (wrap_) {
+         entries_[size_] = entries_[0];
+      }
+   }
+
+   std::size_t size() const {
+      return size_;
+   }
+
+   be::vec4 operator()(be::F32 t) const {
+      t = wrap_ ? t - std::floor(t) : glm::clamp(t, 0.f, 1.f);
+      be::F32 x = t * be::F32(size_);
+      std::size_t i = std::min(std::size_t(x), size_ - 1);
+      return glm::mix(entries_[i], entries_[i + 1], x - be::F32(i));
+   }
+
+private:
+   std::size_t size_ = 0;
+   bool wrap_ = false;
+   std::vector<be::vec4> entries_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Samples a function of three variables on a (size + 1)^3 lattice over
+// [0, 1]^3 and interpolates trilinearly.  Inputs are clamped.
+class ColorLut3D final {
+public:
+   template <typename F>
+   void build(std::size_t size, F func) {
+      size_ = std::max(size, std::size_t(1));
+      std::size_t n = size_ + 1;
+      entries_.resize(n * n * n);
+      for (std::size_t z = 0; z < n; ++z) {
+         for (std::size_t y = 0; y < n; ++y) {
+            for (std::size_t x = 0; x < n; ++x) {
+               be::vec3 c = be::vec3(be::F32(x), be::F32(y), be::F32(z)) / be::F32(size_);
+               entries_[(z * n + y) * n + x] = func(c);
+            }
+         }
+      }
+   }
+
+   std::size_t size() const {
+      return size_;
+   }
+
+   be::vec4 operator()(be::vec3 c) const {
+      std::size_t n = size_ + 1;
+      be::vec3 p = glm::clamp(c, 0.f, 1.f) * be::F32(size_);
+      std::size_t i[3];
+      be::vec3 f;
+      for (int axis = 0; axis < 3; ++axis) {
+         i[axis] = std::min(std::size_t(p[axis]), size_ - 1);
+         f[axis] = p[axis] - be::F32(i[axis]);
+      }
+
+      const be::vec4* base = entries_.data() + (i[2] * n + i[1]) * n + i[0];
+      const std::size_t dy = n;
+      const std::size_t dz = n * n;
+      be::vec4 c00 = glm::mix(base[0], base[1], f.x);
+      be::vec4 c10 = glm::mix(base[dy], base[dy + 1], f.x);
+      be::vec4 c01 = glm::mix(base[dz], base[dz + 1], f.x);
+      be::vec4 c11 = glm::mix(base[dz + dy], base[dz + dy + 1], f.x);
+      return glm::mix(glm::mix(c00, c10, f.y), glm::mix(c01, c11, f.y), f.z);
+   }
+
+private:
+   std::size_t size_ = 0;
+   std::vector<be::vec4> entries_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Tabulates convert_colorspace along one channel, holding the others at the
+// values in fixed.
+template <be::gfx::tex::Colorspace From, be::gfx::tex::Colorspace To>
+ColorLut1D make_colorspace_lut_1d(std::size_t size, be::vec4 fixed, int channel, bool wrap) {
+   ColorLut1D lut;
+   lut.build(size, wrap, [=](be::F32 t) {
+      be::vec4 color = fixed;
+      color[channel] = t;
+      return be::gfx::tex::convert_colorspace<From, To>(color);
+   });
+   return lut;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Tabulates convert_colorspace over the first three channels with a fixed
+// alpha.
+template <be::gfx::tex::Colorspace From, be::gfx::tex::Colorspace To>
+ColorLut3D make_colorspace_lut_3d(std::size_t size, be::F32 alpha = 1.f) {
+   ColorLut3D lut;
+   lut.build(size, [=](be::vec3 c) {
+      return be::gfx::tex::convert_colorspace<From, To>(be::vec4(c, alpha));
+   });
+   return lut;
+}
+
+#endif
@@ -1,4 +1,10 @@
 #include "tex_demo.hpp"
+#include "tex_pixel_writer.hpp"
+#include "tex_fast_math.hpp"
+#include "tex_float_pack.hpp"
+#include "tex_mapped_file.hpp"
+#include "tex_blit.hpp"
+#include "tex_frame_pipeline.hpp"
 #include <be/core/logging.hpp>
 #include <be/core/version.hpp>
 #include <be/core/stack_trace.hpp>
@@ -11,21 +17,43 @@
 #include <be/gfx/tex/visit_texture.hpp>
 #include <be/gfx/tex/convert_colorspace_static.hpp>
 #include <be/gfx/tex/image_format_gl.hpp>
-#include <be/gfx/tex/texture_reader.hpp>
 #include <be/gfx/tex/blit_pixels.hpp>
-#include <be/gfx/tex/log_texture_info.hpp>
 #include <be/cli/cli.hpp>
 #include <be/gfx/bgl.hpp>
 #include <glm/gtx/norm.hpp>
 #include <glm/common.hpp>
+#include <algorithm>
+#include <cctype>
 #include <sstream>
 #include <string>
+#include <vector>
 
 using namespace be;
 using namespace be::gfx;
 using namespace be::gfx::gl;
 using namespace be::gfx::tex;
 
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+// Extensions of the files TextureReader can decode (or map_image can map).
+bool is_image_file(const Path& path) {
+   static const char* const extensions[] = {
+      ".betx", ".ktx", ".dds", ".png", ".jpg", ".jpeg", ".bmp", ".tga",
+      ".gif", ".psd", ".hdr", ".pic", ".pnm", ".ppm", ".pgm"
+   };
+   S ext = path.extension().string();
+   std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+   for (const char* e : extensions) {
+      if (ext == e) {
+         return true;
+      }
+   }
+   return false;
+}
+
+} // ::()
+
 ///////////////////////////////////////////////////////////////////////////////
 TexDemo::TexDemo(int argc, char** argv) {
    default_log().verbosity_mask(v::info_or_worse);
@@ -56,6 +84,7 @@ TexDemo::TexDemo(int argc, char** argv) {
                           << row << "pinwheel" << cell << "Draws a texture where each pixel's hue is determined by its angle around the center.  Use " << fg_yellow << "--effect-scale" << reset << " to change the frequency of color change."
                           << row << "pinwheel-r" << cell << "Like pinwheel, but discards the blue/green channels and uses red instead."
                           << row << "view" << cell << "Attempt to load the image file specified by " << fg_yellow<< "--file" << reset << " and display it."
+                          << row << "tiles" << cell << "Displays the image file specified by " << fg_yellow << "--file" << reset << " from an on-disk mip pyramid, loading only the visible tiles.  The pyramid is built on first use.  Arrow keys pan, + and - zoom."
          ))
 
          (any(
@@ -63,25 +92,20 @@ TexDemo::TexDemo(int argc, char** argv) {
                S demo = arg;
                std::transform(demo.begin(), demo.end(), demo.begin(), [](char c) { return (char)tolower(c); });
                if (demo == "ub") {
+                  generator_inputs_ = input_dim;
                   generator_ = []() { };
                } else if (demo == "whitenoise") {
+                  generator_inputs_ = input_rng | input_dim;
                   generator_ = [this]() {
-                     auto put = put_pixel_norm_func<ivec2>(tex_.view.image());
-                     visit_texture_pixels<ivec2>(tex_.view, [=](ImageView& view, ivec2 pc) {
-                        F32 val = fdist_(rnd_);
-                        vec4 pixel_norm = vec4(val);
-                        put(view, pc, pixel_norm);
-                     });
+                     generate_noise_(1);
                   };
                } else if (demo == "rgbnoise") {
+                  generator_inputs_ = input_rng | input_dim;
                   generator_ = [this]() {
-                     auto put = put_pixel_norm_func<ivec2>(tex_.view.image());
-                     visit_texture_pixels<ivec2>(tex_.view, [=](ImageView& view, ivec2 pc) {
-                        vec4 pixel_norm = vec4(fdist_(rnd_), fdist_(rnd_), fdist_(rnd_), 1.f);
-                        put(view, pc, pixel_norm);
-                     });
+                     generate_noise_(3);
                   };
                } else if (demo == "gradient") {
+                  generator_inputs_ = input_time | input_rng | input_dim;
                   setup_ = [this]() {
                      for (int i = 0; i < 8; ++i) {
                         data_[i] = vec4(fdist_(rnd_), fdist_(rnd_), fdist_(rnd_), 1.f);
@@ -103,97 +127,129 @@ TexDemo::TexDemo(int argc, char** argv) {
                      vec4 b = glm::mix(data_[1], data_[5], f);
                      vec4 c = glm::mix(data_[2], data_[6], f);
                      vec4 d = glm::mix(data_[3], data_[7], f);
-                     auto put = put_pixel_norm_func<ivec2>(tex_.view.image());
-                     visit_texture_pixels<ivec2>(tex_.view, [=](ImageView& view, ivec2 pc) {
-                        vec4 ab = glm::mix(a, b, (pc.x + 0.5f) / view.dim().x);
-                        vec4 cd = glm::mix(c, d, (pc.x + 0.5f) / view.dim().x);
-                        vec4 pixel_norm = glm::mix(ab, cd, (pc.y + 0.5f) / view.dim().y);
-                        put(view, pc, pixel_norm);
+                     generate_rows_parallel(*scheduler_, tex_.image(), !generic_writers_, [=](const ImageRow& row, vec4* out) {
+                        vec2 dim = vec2(row.view->dim());
+                        F32 fy = (row.y + 0.5f) / dim.y;
+                        for (I32 x = row.x_begin; x < row.x_end; ++x) {
+                           F32 fx = (x + 0.5f) / dim.x;
+                           vec4 ab = glm::mix(a, b, fx);
+                           vec4 cd = glm::mix(c, d, fx);
+                           *out++ = glm::mix(ab, cd, fy);
+                        }
                      });
                   };
                } else if (demo == "sinc") {
+                  generator_inputs_ = input_effect_scale | input_dim;
                   generator_ = [this]() {
-                     auto put = put_pixel_norm_func<ivec2>(tex_.view.image());
-                     visit_texture_pixels<ivec2>(tex_.view, [=](ImageView& view, ivec2 pc) {
-                        vec2 center = vec2(view.dim()) / 2.f;
-                        vec2 pixel_center = vec2(pc) + 0.5f;
-                        vec2 offset = pixel_center - center;
-                        F32 dst = glm::length(offset);
-                        F32 val = 0.5f * (1.f + sinf(dst / effect_scale_) / (dst / effect_scale_));
-                        vec4 pixel_norm = vec4(val);
-                        put(view, pc, pixel_norm);
+                     ImageView image = tex_.image();
+                     radial_.prepare(*scheduler_, ivec2(image.dim()), RadialField::plane_distance);
+                     generate_rows_parallel(*scheduler_, image, !generic_writers_, [=](const ImageRow& row, vec4* out) {
+                        std::size_t n = std::size_t(row.width());
+                        const F32* dst = radial_.distance(row.y) + row.x_begin;
+                        F32* arg = row_scratch(0, n);
+                        F32* sin_arg = row_scratch(1, n);
+                        for (std::size_t i = 0; i < n; ++i) {
+                           arg[i] = dst[i] / effect_scale_;
+                        }
+                        fast_sin(arg, sin_arg, n);
+                        for (std::size_t i = 0; i < n; ++i) {
+                           out[i] = vec4(0.5f * (1.f + sin_arg[i] / arg[i]));
+                        }
                      });
                   };
                } else if (demo == "cosdst2") {
+                  generator_inputs_ = input_effect_scale | input_dim;
                   generator_ = [this]() {
-                     auto put = put_pixel_norm_func<ivec2>(tex_.view.image());
-                     visit_texture_pixels<ivec2>(tex_.view, [=](ImageView& view, ivec2 pc) {
-                        vec2 center = vec2(view.dim()) / 2.f;
-                        vec2 pixel_center = vec2(pc) + 0.5f;
-                        vec2 offset = pixel_center - center;
-                        F32 dst2 = glm::length2(offset);
-                        F32 val = 0.5f * (1.f + cosf(dst2 / effect_scale_));
-                        vec4 pixel_norm = vec4(val);
-                        put(view, pc, pixel_norm);
+                     ImageView image = tex_.image();
+                     radial_.prepare(*scheduler_, ivec2(image.dim()), RadialField::plane_distance2);
+                     generate_rows_parallel(*scheduler_, image, !generic_writers_, [=](const ImageRow& row, vec4* out) {
+                        std::size_t n = std::size_t(row.width());
+                        const F32* dst2 = radial_.distance2(row.y) + row.x_begin;
+                        F32* arg = row_scratch(0, n);
+                        F32* cos_arg = row_scratch(1, n);
+                        for (std::size_t i = 0; i < n; ++i) {
+                           arg[i] = dst2[i] / effect_scale_;
+                        }
+                        fast_cos(arg, cos_arg, n);
+                        for (std::size_t i = 0; i < n; ++i) {
+                           out[i] = vec4(0.5f * (1.f + cos_arg[i]));
+                        }
                      });
                   };
-               } else if (demo == "pinwheel") {
-                  generator_ = [this]() {
-                     auto put = put_pixel_norm_func<ivec2>(tex_.view.image());
-                     visit_texture_pixels<ivec2>(tex_.view, [=](ImageView& view, ivec2 pc) {
-                        vec2 center = vec2(view.dim()) / 2.f;
-                        vec2 pixel_center = vec2(pc) + 0.5f;
-                        vec2 offset = pixel_center - center;
-                        F32 angle = atan2f(offset.y, offset.x) + glm::pi<F32>();
-                        vec4 pixel_norm = convert_colorspace<Colorspace::bt709_linear_hsl, Colorspace::srgb>(
-                           vec4((angle * effect_scale_ + 2.f * (sin_time_ + 1.f)) / (glm::pi<F32>() * 2.f), 0.5f, 0.5f, 1.f));
-                        put(view, pc, pixel_norm);
-                     });
+               } else if (demo == "pinwheel" || demo == "pinwheel-r") {
+                  bool red_only = demo == "pinwheel-r";
+                  period_ = 1.0; // only depends on sin_time_
+                  generator_inputs_ = input_time | input_effect_scale | input_dim;
+                  setup_ = [this]() {
+                     if (lut_size_ > 0) {
+                        hue_lut_ = make_colorspace_lut_1d<Colorspace::bt709_linear_hsl, Colorspace::srgb>(lut_size_, vec4(0.f, 0.5f, 0.5f, 1.f), 0, true);
+                     }
                   };
-               } else if (demo == "pinwheel-r") {
-                  generator_ = [this]() {
-                     auto put = put_pixel_norm_func<ivec2>(tex_.view.image());
-                     visit_texture_pixels<ivec2>(tex_.view, [=](ImageView& view, ivec2 pc) {
-                        vec2 center = vec2(view.dim()) / 2.f;
-                        vec2 pixel_center = vec2(pc) + 0.5f;
-                        vec2 offset = pixel_center - center;
-                        F32 angle = atan2f(offset.y, offset.x) + glm::pi<F32>();
-                        vec4 pixel_norm = convert_colorspace<Colorspace::bt709_linear_hsl, Colorspace::srgb>(
-                           vec4((angle * effect_scale_ + 2.f * (sin_time_ + 1.f)) / (glm::pi<F32>() * 2.f), 0.5f, 0.5f, 1.f));
-                        pixel_norm = vec4(pixel_norm.r);
-                        put(view, pc, pixel_norm);
+                  generator_ = [this, red_only]() {
+                     ImageView image = tex_.image();
+                     radial_.prepare(*scheduler_, ivec2(image.dim()), RadialField::plane_angle);
+                     F32 phase = 2.f * (sin_time_ + 1.f);
+                     generate_rows_parallel(*scheduler_, image, !generic_writers_, [=](const ImageRow& row, vec4* out) {
+                        std::size_t n = std::size_t(row.width());
+                        const F32* angle = radial_.angle(row.y) + row.x_begin;
+                        F32* hue = row_scratch(0, n);
+                        for (std::size_t i = 0; i < n; ++i) {
+                           hue[i] = (angle[i] * effect_scale_ + phase) / (glm::pi<F32>() * 2.f);
+                        }
+                        if (lut_size_ > 0) {
+                           for (std::size_t i = 0; i < n; ++i) {
+                              out[i] = hue_lut_(hue[i]);
+                           }
+                        } else {
+                           for (std::size_t i = 0; i < n; ++i) {
+                              out[i] = convert_colorspace<Colorspace::bt709_linear_hsl, Colorspace::srgb>(vec4(hue[i], 0.5f, 0.5f, 1.f));
+                           }
+                        }
+                        if (red_only) {
+                           for (std::size_t i = 0; i < n; ++i) {
+                              out[i] = vec4(out[i].r);
+                           }
+                        }
                      });
                   };
-               } else if (demo == "view") {
-                  generator_ = [this]() {
-                     TextureReader reader;
-                     reader.read(file_);
-                     Texture tex = reader.texture();
-                     gfx::tex::log_texture_info(tex.view, file_.string());
-                     //tex_ = std::move(tex);
-                     dim_ = tex.view.dim(0);
-                     tex_ = make_planar_texture(format_, dim_, 1);
-                     auto dest = tex_.view.image(0,0,0);
-                     be::gfx::tex::blit_pixels(tex.view.image(0, 0, 0), dest);
+               } else if (demo == "view" || demo == "view-na") {
+                  fixed_size_ = true;
+                  generator_inputs_ = input_file;
+                  bool opaque = demo == "view-na";
+                  image_cache_.pool(&pool_);
+                  setup_ = [this, opaque]() {
+                     if (files_.size() > 1) {
+                        prefetcher_ = std::make_unique<ImagePrefetcher>(files_, prefetch_depth_, decode_threads_, opaque, &stats_);
+                        prefetcher_->prefetch(slide_);
+                     }
+                  };
+                  generator_ = [this, opaque]() {
+                     if (prefetcher_ && slide_ != shown_slide_) {
+                        show_slide_(opaque);
+                     }
+                     // Shown straight from the cache; a mapped file that already
+                     // has format_ is uploaded without any copy.
+                     image_cache_.refresh(file_, opaque);
+                     U64 generation = image_cache_.generation();
+                     TU start = ts_now();
+                     view_image_ = &image_cache_.image(format_);
+                     if (image_cache_.generation() != generation) {
+                        stats_.record(Phase::convert, tu_to_seconds(ts_now() - start));
+                     }
+                     dim_ = ivec2(view_image_->dim());
+                  };
+               } else if (demo == "tiles") {
+                  generator_inputs_ = input_dim;
+                  setup_ = [this]() {
+                     open_tiles_();
                   };
-               } else if (demo == "view-na") {
                   generator_ = [this]() {
-                     TextureReader reader;
-                     reader.read(file_);
-                     Texture tex = reader.texture();
-                     be::gfx::tex::visit_texture_pixels<ivec2>(tex.view, [](be::gfx::tex::ImageView& v, ivec2 pc) {
-                        RGBA p = be::gfx::tex::get_block<RGBA>(v, pc);
-                        p.a = 255;
-                        be::gfx::tex::put_block(v, pc, p);
-                     });
-                     dim_ = tex.view.dim(0);
-                     tex_ = make_planar_texture(format_, dim_, 1);
-                     auto dest = tex_.view.image(0,0,0);
-                     be::gfx::tex::blit_pixels(tex.view.image(0, 0, 0), dest);
+                     generate_tiles_();
                   };
                } else {
                   return false;
                }
+               demo_ = demo;
                return true;
             }))
 
@@ -309,16 +365,206 @@ TexDemo::TexDemo(int argc, char** argv) {
             }).desc("Set OpenGL internal format."))
 
           (param({ }, { "file" }, "PATH", [&](const S& value) {
-               file_ = value;
-            }).desc("Specifies the path to an image file for demos that require an input image."))
+               Path path = value;
+               if (fs::is_directory(path)) {
+                  std::vector<Path> paths;
+                  for (auto& entry : fs::directory_iterator(path)) {
+                     Path file = entry.path();
+                     S name = file.filename().string();
+                     if (fs::is_regular_file(entry.status()) && !name.empty() && name[0] != '.' && is_image_file(file)) {
+                        paths.push_back(file);
+                     }
+                  }
+                  if (paths.empty()) {
+                     throw RecoverableError(std::make_error_code(std::errc::no_such_file_or_directory));
+                  }
+                  std::sort(paths.begin(), paths.end());
+                  files_.insert(files_.end(), paths.begin(), paths.end());
+               } else {
+                  files_.push_back(path);
+               }
+               file_ = files_.front();
+            }).desc(Cell() << "Specifies the path to an image file for demos that require an input image.  May be repeated, or name a directory, to show a slideshow with the " << fg_cyan << "view" << reset << " demo; see " << fg_yellow << "--prefetch" << reset << "."))
+         (numeric_param({ }, { "prefetch" }, "N", prefetch_depth_).desc("Sets how many of the following slideshow images are decoded ahead on background threads."))
+         (numeric_param({ }, { "decode-threads" }, "N", decode_threads_).desc(Cell() << "Sets the number of threads decoding slideshow images.  0 uses one per image prefetched, up to one per hardware thread."))
+         (numeric_param({ }, { "slide-seconds" }, "S", slide_seconds_).desc(Cell() << "Sets how long each slideshow image is shown with " << fg_yellow << "--animate" << reset << ".  Otherwise the arrow keys and space change images, and " << fg_yellow << "--headless" << reset << " runs show one image per frame."))
+
+         (param({ }, { "expr" }, "EXPR", [this](const S& value) {
+               S error;
+               if (!expr_.compile(value, error)) {
+                  be_error() << "Invalid expression"
+                     & attr("Expression") << value
+                     & attr("Error") << error
+                     | default_log();
+                  throw RecoverableError(std::make_error_code(std::errc::invalid_argument));
+               }
+               demo_ = "expr";
+               generator_inputs_ = input_dim;
+               if (expr_.uses(ExprInput::t)) {
+                  generator_inputs_ |= input_time;
+               }
+               if (expr_.uses(ExprInput::effect_scale)) {
+                  generator_inputs_ |= input_effect_scale;
+               }
+               generator_ = [this]() {
+                  generate_expr_();
+               };
+            }).desc(Cell() << "Used instead of a demo name; draws one expression (gray), three (RGB) or four (RGBA), separated by commas.  Expressions may use "
+                           << fg_cyan << "x" << reset << ", " << fg_cyan << "y" << reset << ", " << fg_cyan << "r" << reset << ", " << fg_cyan << "theta" << reset << ", "
+                           << fg_cyan << "t" << reset << ", " << fg_cyan << "effect_scale" << reset << ", " << fg_cyan << "pi" << reset << ", + - * / ^, and "
+                           << "sin, cos, sqrt, atan2, abs, floor, fract, exp, log, min, max, pow and clamp."))
+
+         (param({ }, { "pyramid" }, "PATH", [this](const S& value) {
+               pyramid_file_ = value;
+            }).desc(Cell() << "Sets where the " << fg_cyan << "tiles" << reset << " demo stores its mip pyramid.  Defaults to the " << fg_yellow << "--file" << reset << " path with " << fg_cyan << ".pyramid" << reset << " appended."))
+         (param({ }, { "tile-size" }, "N", [this](const S& value) {
+               std::istringstream iss(value);
+               I32 size = 0;
+               iss >> size;
+               if (!iss || size < 16 || size > 4096 || (size & (size - 1)) != 0) {
+                  throw RecoverableError(std::make_error_code(std::errc::invalid_argument));
+               }
+               tile_size_ = size;
+            }).desc("Sets the edge length of mip pyramid tiles; a power of two from 16 to 4096.  Changing it rebuilds the pyramid."))
+         (numeric_param({ }, { "tile-cache-mb" }, "MB", tile_cache_mb_).desc("Sets the memory cap for tiles cached by the tiles demo.  Least recently used tiles are evicted first."))
+         (numeric_param({ }, { "zoom" }, "X", zoom_).desc("Sets the number of texture pixels per image pixel for the tiles demo.  0 fits the whole image."))
+         (param({ }, { "pan" }, "X,Y", [this](const S& value) {
+               std::istringstream iss(value);
+               char comma = 0;
+               iss >> pan_.x >> comma >> pan_.y;
+               if (!iss || comma != ',') {
+                  throw RecoverableError(std::make_error_code(std::errc::invalid_argument));
+               }
+               pan_set_ = true;
+            }).desc("Sets the image pixel shown at the center of the tiles demo.  Defaults to the center of the image."))
+         (param({ }, { "query-tile" }, "LEVEL,X,Y", [this](const S& value) {
+               std::istringstream iss(value);
+               U32 level = 0;
+               ivec2 tile;
+               char c1 = 0;
+               char c2 = 0;
+               iss >> level >> c1 >> tile.x >> c2 >> tile.y;
+               if (!iss || c1 != ',' || c2 != ',' || tile.x < 0 || tile.y < 0) {
+                  throw RecoverableError(std::make_error_code(std::errc::invalid_argument));
+               }
+               tile_queries_.emplace_back(level, tile);
+            }).desc(Cell() << "With " << fg_yellow << "--headless" << reset << " and the " << fg_cyan << "tiles" << reset << " demo, reads a tile through the tile cache and reports whether it was cached and a checksum of its contents.  May be repeated."))
 
          (numeric_param({ "e" }, { "effect-scale" }, "X", effect_scale_).desc("Set the scale for effects (exact meaning depends on demo)."))
 
+         (numeric_param({ }, { "lut-size" }, "N", lut_size_).desc("Sets the number of entries in colorspace lookup tables.  0 disables lookup tables and converts every pixel directly."))
+
          (numeric_param({ "t" }, { "time-scale" }, "X", time_scale_).desc("Sets the time scale.  Higher numbers mean faster."))
 
          (flag({ }, { "linear" }, linear_scaling_).desc("Use linear scaling instead of nearest-neighbor."))
          (flag({ "a" }, { "animate" }, animate_).desc("Enables animation."))
 
+         (param({ }, { "seed" }, "SEED", [this](const S& value) {
+               std::istringstream iss(value);
+               iss >> seed_;
+               fixed_seed_ = true;
+               return true;
+            }).desc("Sets the random seed.  Noise output for a given seed does not depend on the number of threads."))
+
+         (numeric_param({ "j" }, { "threads" }, "N", threads_).desc("Sets the number of threads used by generators.  0 uses one thread per hardware thread."))
+
+         (flag({ }, { "generic-writer" }, generic_writers_).desc("Always use the generic normalized pixel writer, even for formats that have a specialized writer."))
+
+         (param({ }, { "simd" }, "LEVEL", [this](const S& value) {
+               util::KeywordParser<SimdLevel> parser(SimdLevel::avx2);
+               parser
+                  (SimdLevel::scalar, "scalar", "SCALAR")
+                  (SimdLevel::sse41, "sse4.1", "SSE4.1")
+                  (SimdLevel::avx2, "avx2", "AVX2")
+                  ;
+
+               std::error_code ec;
+               set_simd_level(parser.parse(value, ec));
+               if (ec) {
+                  throw RecoverableError(ec);
+               }
+            }).desc(Cell() << "Limits the instruction set used by math kernels to " << fg_cyan << "scalar" << reset << ", " << fg_cyan << "sse4.1" << reset << ", or " << fg_cyan << "avx2" << reset << "."))
+
+         (flag({ }, { "check-math" }, check_math_).desc("Compares the math kernels against the C library for accuracy and throughput, then exits."))
+         (flag({ }, { "check-packing" }, check_packing_).desc("Compares the half, 11/11/10 and 9/9/9/5 float packers against glm for exactness and throughput, then exits."))
+         (flag({ }, { "bench-blit" }, bench_blit_).desc("Compares the format conversion kernels against the generic blit for accuracy and throughput, then exits."))
+
+         (flag({ }, { "headless" }, headless_).desc("Runs the demo without creating a window or OpenGL context and reports generator timing."))
+         (numeric_param({ "n" }, { "frames" }, "N", frames_).desc(Cell() << "Sets the number of frames to generate when using " << fg_yellow << "--headless" << reset << "."))
+         (numeric_param({ }, { "warmup" }, "N", warmup_).desc(Cell() << "Generates N extra frames with " << fg_yellow << "--headless" << reset << " before timing starts.  They aren't included in timing or stats."))
+         (param({ }, { "dump" }, "PATH", [this](const S& value) {
+               dump_file_ = value;
+            }).desc(Cell() << "Writes the raw pixel data of every frame generated with " << fg_yellow << "--headless" << reset << " to a file."))
+
+         (numeric_param({ }, { "resize-preview" }, "N", resize_preview_).desc("While the window is being resized, renders previews at 1/N resolution and only renders at full resolution once resizing stops.  1 disables previews."))
+         (param({ }, { "resize-sequence" }, "SIZES", [this](const S& value) {
+               // WxH[@MS],... with entries 5 ms apart unless a time is given
+               resize_sequence_.clear();
+               std::istringstream iss(value);
+               S entry;
+               F64 t = 0;
+               while (std::getline(iss, entry, ',')) {
+                  std::istringstream entry_stream(entry);
+                  ivec2 dim;
+                  char x = 0;
+                  char at = 0;
+                  entry_stream >> dim.x >> x >> dim.y;
+                  if (!entry_stream || x != 'x' || dim.x <= 0 || dim.y <= 0) {
+                     throw RecoverableError(std::make_error_code(std::errc::invalid_argument));
+                  }
+                  F64 ms;
+                  if (entry_stream >> at >> ms && at == '@') {
+                     t = ms / 1000.0;
+                  } else if (!resize_sequence_.empty()) {
+                     t += 0.005;
+                  }
+                  resize_sequence_.emplace_back(t, dim);
+               }
+               return true;
+            }).desc(Cell() << "Replays a sequence of window resizes with " << fg_yellow << "--headless" << reset << " and reports how many renders were needed."))
+
+         (numeric_param({ }, { "cache-mb" }, "MB", cache_mb_).desc("For periodic animations, pre-renders the animation into a cache of at most MB megabytes and plays it back instead of generating every frame.  If the cache won't fit, frames are generated live.  0 disables the cache."))
+         (numeric_param({ }, { "cache-phases" }, "N", cache_phases_).desc(Cell() << "Sets the number of frames per period stored by " << fg_yellow << "--cache-mb" << reset << "."))
+
+         (param({ }, { "stats" }, "PATH", [this](const S& value) {
+               stats_file_ = value;
+            }).desc("Writes latency percentiles for each phase (setup, decode, generate, convert, upload, swap) to a JSON file at exit, or CSV if PATH ends in .csv."))
+
+         (param({ }, { "compress" }, "CODEC", [this](const S& value) {
+               util::KeywordParser<BlockCodec> parser(BlockCodec::bc1);
+               parser
+                  (BlockCodec::bc1, "bc1", "BC1")
+                  (BlockCodec::bc3, "bc3", "BC3")
+                  ;
+
+               std::error_code ec;
+               block_codec_ = parser.parse(value, ec);
+               if (ec) {
+                  throw RecoverableError(ec);
+               }
+               compress_enabled_ = true;
+            }).desc(Cell() << "Encodes each frame to " << fg_cyan << "bc1" << reset << " (RGB, 8:1 from RGBA8) or " << fg_cyan << "bc3" << reset << " (RGBA, 4:1) on the CPU and uploads the compressed blocks.  With " << fg_yellow << "--headless" << reset << ", reports encode throughput and PSNR."))
+         (param({ }, { "compress-quality" }, "LEVEL", [this](const S& value) {
+               util::KeywordParser<BlockQuality> parser(BlockQuality::normal);
+               parser
+                  (BlockQuality::fast, "fast", "FAST")
+                  (BlockQuality::normal, "normal", "NORMAL")
+                  (BlockQuality::high, "high", "HIGH")
+                  ;
+
+               std::error_code ec;
+               block_quality_ = parser.parse(value, ec);
+               if (ec) {
+                  throw RecoverableError(ec);
+               }
+            }).desc(Cell() << "Trades encode speed for quality with " << fg_yellow << "--compress" << reset << ": " << fg_cyan << "fast" << reset << ", " << fg_cyan << "normal" << reset << ", or " << fg_cyan << "high" << reset << "."))
+
+         (numeric_param({ }, { "target-ms" }, "MS", target_ms_).desc(Cell() << "With " << fg_yellow << "--animate" << reset << " or " << fg_yellow << "--headless" << reset << ", lowers the texture resolution while generating a frame takes longer than MS milliseconds, and raises it again once there is room.  The window size doesn't change; combine with " << fg_yellow << "--linear" << reset << " for smoother scaling.  Disables " << fg_yellow << "--pipeline" << reset << "."))
+         (numeric_param({ }, { "min-scale" }, "X", min_scale_).desc(Cell() << "Sets the lowest resolution " << fg_yellow << "--target-ms" << reset << " may use, as a fraction of the full resolution."))
+         (numeric_param({ }, { "simulate-ms-per-mpixel" }, "MS", simulated_ms_per_mpixel_).desc(Cell() << "Drives " << fg_yellow << "--target-ms" << reset << " with simulated frame times of MS milliseconds per megapixel instead of measured ones, for reproducible " << fg_yellow << "--headless" << reset << " runs."))
+
+         (numeric_param({ }, { "pipeline" }, "N", pipeline_depth_).desc("Generates animated frames on a worker thread into a ring of N textures while earlier frames are uploaded.  0 generates frames on the render thread."))
+
          (end_of_options())
 
          (verbosity_param({ "v" }, { "verbosity" }, "LEVEL", default_log().verbosity_mask()))
@@ -343,7 +589,7 @@ TexDemo::TexDemo(int argc, char** argv) {
 
       proc.process(argc, argv);
 
-      if (!show_help && !show_version && !generator_) {
+      if (!show_help && !show_version && !check_math_ && !check_packing_ && !bench_blit_ && !generator_) {
          show_help = true;
          show_version = true;
          status_ = 1;
@@ -399,7 +645,23 @@ int TexDemo::operator()() {
    }
 
    try {
-      run_();
+      scheduler_ = std::make_unique<TileScheduler>(threads_);
+      if (check_math_) {
+         run_math_check_();
+      } else if (check_packing_) {
+         run_packing_check_();
+      } else if (bench_blit_) {
+         run_blit_benchmark_();
+      } else if (headless_ && !tile_queries_.empty()) {
+         run_tile_queries_();
+      } else if (headless_ && !resize_sequence_.empty()) {
+         run_resize_sequence_();
+      } else if (headless_) {
+         run_headless_();
+      } else {
+         run_();
+      }
+      write_stats_();
    } catch (const FatalTrace& e) {
       status_ = std::max(status_, (I8)1);
       be_error() << "Unexpected fatal error!"
@@ -434,6 +696,16 @@ int TexDemo::operator()() {
    return status_;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+const PhaseStats& TexDemo::stats() const {
+   return stats_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ivec2 TexDemo::dim() const {
+   return dim_;
+}
+
 namespace {
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -454,6 +726,7 @@ void GLAPIENTRY check_errors(GLenum source, GLenum type, GLuint id, GLenum sever
 void TexDemo::run_() {
    glfwWindowHint(GLFW_RESIZABLE, resizable_ ? 1 : 0);
    GLFWwindow* wnd = glfwCreateWindow((int)(dim_.x * scale_), (int)(dim_.y * scale_), "be::gfx::tex Demo", nullptr, nullptr);
+   wnd_ = wnd;
    glfwMakeContextCurrent(wnd);
    glfwSwapInterval(1);
    glfwSetWindowUserPointer(wnd, this);
@@ -468,29 +741,33 @@ void TexDemo::run_() {
       //#bgl unchecked
    }
 
-   tex_ = make_planar_texture(format_, dim_, 1);
-   rnd_.seed(perf_now());
+   tex_ = pool_.acquire(format_, dim_);
+   reseed_();
 
    glClearColor(0.0, 0.0, 0.0, 0.0);
 
-   glGenTextures(1, &tex_id_);
-   glBindTexture(GL_TEXTURE_2D, tex_id_);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, linear_scaling_ ? GL_LINEAR : GL_NEAREST);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, linear_scaling_ ? GL_LINEAR : GL_NEAREST);
+   tex_id_ = make_gl_texture_();
    glPixelStorei(GL_UNPACK_ALIGNMENT, 8);
 
    if (setup_) {
+      PhaseTimer timer(stats_, Phase::setup);
       setup_();
    }
 
    if (generator_) {
-      generator_();
+      generate_(true);
    }
 
    upload_();
 
+   if (animate_) {
+      start_resolution_control_();
+      update_cache_();
+      start_pipeline_();
+   }
+
+   resizer_ = ResizeCoalescer(dim_, resize_preview_);
+
    glfwSetWindowSizeCallback(wnd, [](GLFWwindow* wnd, int w, int h) {
       TexDemo& demo = *static_cast<TexDemo*>(glfwGetWindowUserPointer(wnd));
       ivec2 new_size((int)round(w / demo.scale_), (int)round(h / demo.scale_));
@@ -503,36 +780,64 @@ void TexDemo::run_() {
       }
       glViewport(0, 0, new_wnd_size.x, new_wnd_size.y);
 
-      if (new_size != demo.dim_ && new_size.x * new_size.y > 0) {
-         demo.dim_ = new_size;
-         demo.tex_ = make_planar_texture(demo.format_, demo.dim_, 1);
-         if (demo.generator_) {
-            demo.generator_();
-         }
-         demo.upload_();
+      // rendering is left to the main loop, which only sees the latest size
+      if (new_size.x * new_size.y > 0 && !demo.fixed_size_) {
+         demo.resizer_.resize(new_size, tu_to_seconds(ts_now()));
          glfwPostEmptyEvent();
       }
    });
 
+   glfwSetKeyCallback(wnd, [](GLFWwindow* wnd, int key, int, int action, int) {
+      TexDemo& demo = *static_cast<TexDemo*>(glfwGetWindowUserPointer(wnd));
+      if (action != GLFW_RELEASE && !demo.navigate_tiles_(key)) {
+         demo.navigate_slides_(key);
+      }
+   });
+
    glEnable(GL_TEXTURE_2D);
    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 
    while (!glfwWindowShouldClose(wnd)) {
       if (animate_) {
          glfwPollEvents();
+      } else if (resizer_.pending()) {
+         glfwWaitEventsTimeout(resizer_.timeout(tu_to_seconds(ts_now())));
       } else {
          glfwWaitEvents();
       }
 
+      ResizeCoalescer::Step step = resizer_.poll(tu_to_seconds(ts_now()));
+      if (resolution_ && step.action == ResizeCoalescer::Action::full) {
+         resolution_->full_dim(step.dim);
+         regenerate_(resolution_->dim());
+      } else if (step.action != ResizeCoalescer::Action::none) {
+         regenerate_(step.dim);
+      }
+      if (animate_) {
+         update_cache_();
+      }
+
       glClear(GL_COLOR_BUFFER_BIT);
 
-      if (animate_ && generator_) {
-         last_ = now_;
-         now_ = ts_now();
-         time_ += tu_to_seconds(now_ - last_) / time_scale_;
-         sin_time_ = (F32)sin(time_ * 2.0 * glm::pi<F64>());
-         generator_();
-         upload_();
+      if (!cache_ids_.empty()) {
+         tick_();
+         glBindTexture(GL_TEXTURE_2D, cache_ids_[FrameCache::index(time_ / period_, U32(cache_ids_.size()))]);
+      } else if (pipeline_) {
+         // if the next frame isn't ready yet, keep showing the last one
+         pipeline_->consume([this](const ImageView& image, U64) {
+            take_pipeline_seconds_(true);
+            upload_(image);
+         }, false);
+      } else if (animate_ && generator_) {
+         tick_();
+         TU start = ts_now();
+         if (generate_(false)) {
+            F64 seconds = tu_to_seconds(ts_now() - start);
+            upload_();
+            if (resolution_) {
+               adapt_resolution_(seconds);
+            }
+         }
       }
 
       glBegin(GL_QUADS);
@@ -543,18 +848,953 @@ void TexDemo::run_() {
       glTexCoord2fv(glm::value_ptr(glm::vec2(0.0f, 1.f))); glVertex2f(-1.f, -1.f);
       glEnd();
 
-      glfwSwapBuffers(wnd);
+      {
+         PhaseTimer timer(stats_, Phase::swap);
+         glfwSwapBuffers(wnd);
+      }
+   }
+
+   stop_pipeline_();
+   clear_cache_();
+
+   if (animate_) {
+      be_info() << "Animation stopped"
+         & attr("Generated Frames") << generated_frames_
+         & attr("Skipped Frames") << skipped_frames_
+         | default_log();
    }
 
+   log_resolution_();
+   log_tile_cache_();
+   log_prefetch_();
+
    glDeleteTextures(1, &tex_id_);
    glfwDestroyWindow(wnd);
+   wnd_ = nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::run_headless_() {
+   tex_ = pool_.acquire(format_, dim_);
+   reseed_();
+
+   if (setup_) {
+      PhaseTimer timer(stats_, Phase::setup);
+      setup_();
+   }
+
+   F64 total_seconds = 0;
+   F64 min_seconds = 0;
+   F64 max_seconds = 0;
+   F64 total_pixels = 0;
+   F64 total_bytes = 0;
+
+   FrameConsumer sink = dump_file_.empty() ? null_frame_consumer() : raw_file_frame_consumer(dump_file_);
+   F64 psnr = 0;
+   if (compress_enabled_) {
+      sink = [this, sink, &psnr](const ImageView& image, U64 index) {
+         sink(image, index);
+         compress_(image);
+         if (encoded_frames_ == 1) {
+            psnr = block_psnr(image, compressed_);
+         }
+      };
+   }
+
+   now_ = ts_now();
+   start_resolution_control_();
+   update_cache_();
+   start_pipeline_();
+   for (U32 frame = 0; frame < warmup_ + frames_; ++frame) {
+      // warmup frames are neither dumped nor compressed
+      bool warming_up = frame < warmup_;
+      ivec2 dim(0);
+      std::size_t bytes = 0;
+      TU start;
+      if (frame_cache_.baked()) {
+         tick_();
+         start = ts_now();
+         const ImageView& image = frame_cache_.frame(frame_cache_.index(time_ / period_));
+         if (!warming_up) {
+            sink(image, frame - warmup_);
+         }
+         dim = ivec2(image.dim());
+         bytes = image.size();
+      } else if (pipeline_) {
+         // frame time is the interval between finished frames
+         start = ts_now();
+         pipeline_->consume([&](const ImageView& image, U64) {
+            take_pipeline_seconds_(!warming_up);
+            if (!warming_up) {
+               sink(image, frame - warmup_);
+            }
+            dim = ivec2(image.dim());
+            bytes = image.size();
+         }, true);
+      } else {
+         // headless runs measure the generator, so unchanged inputs don't
+         // skip frames here; only the windowed loop skips them
+         tick_();
+         start = ts_now();
+         generate_(true);
+         F64 generate_seconds = tu_to_seconds(ts_now() - start);
+         ImageView image = frame_image_();
+         if (!warming_up) {
+            sink(image, frame - warmup_);
+         }
+         dim = ivec2(image.dim());
+         bytes = image.size();
+         if (resolution_) {
+            adapt_resolution_(generate_seconds);
+         }
+      }
+      F64 seconds = tu_to_seconds(ts_now() - start);
+
+      if (warming_up) {
+         if (frame + 1 == warmup_) {
+            stats_.clear(Phase::generate);
+         }
+         continue;
+      }
+
+      total_seconds += seconds;
+      total_pixels += F64(dim.x) * F64(dim.y);
+      total_bytes += F64(bytes);
+      min_seconds = frame == warmup_ ? seconds : std::min(min_seconds, seconds);
+      max_seconds = std::max(max_seconds, seconds);
+
+      be_verbose() << "Generated frame"
+         & attr("Frame") << frame
+         & attr("Time (ms)") << seconds * 1000.0
+         | default_log();
+   }
+
+   stop_pipeline_();
+
+   ivec2 dim = ivec2(frame_image_().dim());
+   F64 mean_seconds = frames_ > 0 ? total_seconds / frames_ : 0.0;
+   F64 mpixels_per_second = total_seconds > 0 ? total_pixels / total_seconds / 1000000.0 : 0.0;
+   F64 mbytes_per_second = total_seconds > 0 ? total_bytes / total_seconds / 1000000.0 : 0.0;
+
+   be_info() << "Headless run complete"
+      & attr("Demo") << demo_
+      & attr("Format") << enum_name(to_gl_format(format_).internal_format)
+      & attr("SIMD") << simd_level_name(simd_level())
+      & attr("Pixel Writer") << pixel_writer_name(generic_writers_ ? PixelWriterKind::generic : pixel_writer_kind(format_))
+      & attr("Width") << dim.x
+      & attr("Height") << dim.y
+      & attr("Frames") << frames_
+      & attr("Mean Frame Time (ms)") << mean_seconds * 1000.0
+      & attr("Min Frame Time (ms)") << min_seconds * 1000.0
+      & attr("Max Frame Time (ms)") << max_seconds * 1000.0
+      & attr("Threads") << scheduler_->threads()
+      & attr("Tile Steals") << scheduler_->steals()
+      & attr("Mpixel/s") << mpixels_per_second
+      & attr("Mpixel/s per Thread") << mpixels_per_second / scheduler_->threads()
+      & attr("MB/s") << mbytes_per_second
+      & attr("Peak RSS (MB)") << F64(peak_resident_bytes()) / (1024.0 * 1024.0)
+      & attr("Generated Frames") << generated_frames_
+      & attr("Skipped Frames") << skipped_frames_
+      & attr("Cached Phases") << frame_cache_.phases()
+      & attr("Frame Cache (MB)") << F64(frame_cache_.bytes()) / (1024.0 * 1024.0)
+      | default_log();
+
+   if (compress_enabled_ && encoded_frames_ > 0) {
+      F64 pixels = F64(compressed_.dim.x) * F64(compressed_.dim.y);
+      be_info() << "Block compression"
+         & attr("Codec") << block_codec_name(block_codec_)
+         & attr("Quality") << block_quality_name(block_quality_)
+         & attr("Internal Format") << enum_name(compressed_.gl_format())
+         & attr("Frames") << encoded_frames_
+         & attr("Mean Encode Time (ms)") << encode_seconds_ / F64(encoded_frames_) * 1000.0
+         & attr("Encode Mpixel/s") << (encode_seconds_ > 0 ? pixels * F64(encoded_frames_) / encode_seconds_ / 1000000.0 : 0.0)
+         & attr("Compressed Size (KB)") << F64(compressed_.data.size()) / 1024.0
+         & attr("Ratio") << (compressed_.data.empty() ? 0.0 : F64(frame_image_().size()) / F64(compressed_.data.size()))
+         & attr("PSNR (dB)") << psnr
+         | default_log();
+   }
+
+   log_resolution_();
+   log_tile_cache_();
+   log_prefetch_();
+   clear_cache_();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::run_resize_sequence_() {
+   tex_ = pool_.acquire(format_, dim_);
+   reseed_();
+
+   if (setup_) {
+      PhaseTimer timer(stats_, Phase::setup);
+      setup_();
+   }
+   if (generator_) {
+      generate_(true);
+   }
+
+   // events arrive at their scripted times and the loop polls once per
+   // 60 Hz frame, as the windowed loop would
+   const F64 frame_seconds = 1.0 / 60.0;
+   resizer_ = ResizeCoalescer(dim_, resize_preview_);
+   F64 now = 0;
+   F64 render_seconds = 0;
+   F64 max_render_seconds = 0;
+   std::size_t next = 0;
+   U64 distinct_sizes = 0;
+   ivec2 last_size = dim_;
+
+   while (next < resize_sequence_.size() || resizer_.pending()) {
+      for (; next < resize_sequence_.size() && resize_sequence_[next].first <= now; ++next) {
+         ivec2 size = resize_sequence_[next].second;
+         if (size != last_size) {
+            ++distinct_sizes;
+            last_size = size;
+         }
+         if (!fixed_size_) {
+            resizer_.resize(size, resize_sequence_[next].first);
+         }
+      }
+
+      ResizeCoalescer::Step step = resizer_.poll(now);
+      if (step.action != ResizeCoalescer::Action::none) {
+         TU start = ts_now();
+         regenerate_(step.dim);
+         F64 seconds = tu_to_seconds(ts_now() - start);
+         render_seconds += seconds;
+         max_render_seconds = std::max(max_render_seconds, seconds);
+
+         be_verbose() << "Resize render"
+            & attr("Time (s)") << now
+            & attr("Full") << (step.action == ResizeCoalescer::Action::full)
+            & attr("Width") << step.dim.x
+            & attr("Height") << step.dim.y
+            & attr("Render Time (ms)") << seconds * 1000.0
+            | default_log();
+      }
+
+      now += frame_seconds;
+   }
+
+   be_info() << "Resize sequence complete"
+      & attr("Demo") << demo_
+      & attr("Events") << resizer_.events()
+      & attr("Distinct Sizes") << distinct_sizes
+      & attr("Previews") << resizer_.previews()
+      & attr("Full Renders") << resizer_.full_renders()
+      & attr("Total Render Time (ms)") << render_seconds * 1000.0
+      & attr("Max Render Time (ms)") << max_render_seconds * 1000.0
+      & attr("Final Width") << dim_.x
+      & attr("Final Height") << dim_.y
+      | default_log();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::regenerate_(ivec2 dim) {
+   // the worker shares tex_ and the generator state
+   bool pipelined = pipeline_ && pipeline_->running();
+   if (pipelined) {
+      pipeline_->stop();
+   }
+
+   resize_texture_(dim);
+   if (generator_) {
+      generate_(true);
+   }
+   if (!headless_) {
+      upload_();
+   }
+
+   if (pipelined) {
+      pipeline_->start(format_, dim_);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The next generate_() renders at the new size.
+void TexDemo::resize_texture_(ivec2 dim) {
+   clear_cache_();
+   dim_ = dim;
+   radial_.invalidate();
+   pool_.release(std::move(tex_));
+   tex_ = pool_.acquire(format_, dim_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::start_resolution_control_() {
+   if (target_ms_ > 0.f && generator_ && !fixed_size_) {
+      resolution_ = std::make_unique<ResolutionController>(dim_, F64(target_ms_) / 1000.0, min_scale_);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// With --simulate-ms-per-mpixel, the measured time is replaced by one
+// proportional to the pixel count and the clock only advances by simulated
+// frame times, so runs are reproducible.
+void TexDemo::adapt_resolution_(F64 seconds) {
+   F64 now;
+   if (simulated_ms_per_mpixel_ > 0.f) {
+      seconds = F64(simulated_ms_per_mpixel_) * F64(dim_.x) * F64(dim_.y) / 1e9;
+      simulated_now_ += std::max(seconds, 1.0 / 60.0);
+      now = simulated_now_;
+   } else {
+      now = tu_to_seconds(ts_now());
+   }
+
+   if (resolution_->record(seconds, now)) {
+      be_verbose() << "Resolution changed"
+         & attr("Frame Time (ms)") << seconds * 1000.0
+         & attr("Scale") << resolution_->scale()
+         & attr("Width") << resolution_->dim().x
+         & attr("Height") << resolution_->dim().y
+         | default_log();
+      resize_texture_(resolution_->dim());
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::log_resolution_() {
+   if (!resolution_) {
+      return;
+   }
+
+   be_info() << "Resolution control"
+      & attr("Target (ms)") << resolution_->target() * 1000.0
+      & attr("Average (ms)") << resolution_->average() * 1000.0
+      & attr("Scale") << resolution_->scale()
+      & attr("Width") << resolution_->dim().x
+      & attr("Height") << resolution_->dim().y
+      & attr("Full Width") << resolution_->full_dim().x
+      & attr("Full Height") << resolution_->full_dim().y
+      & attr("Frames") << resolution_->frames()
+      & attr("Downscales") << resolution_->downscales()
+      & attr("Upscales") << resolution_->upscales()
+      & attr("Simulated") << (simulated_ms_per_mpixel_ > 0.f)
+      | default_log();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool TexDemo::cache_wanted_() const {
+   return period_ > 0.0 && cache_mb_ > 0 && cache_phases_ > 0 && generator_ && !fixed_size_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool TexDemo::cached_() const {
+   return frame_cache_.baked() || !cache_ids_.empty();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Bakes the cache once per size, after resizing has settled.  A pipeline
+// that is already running is paused while baking and replaced by the cache
+// if it fits.
+void TexDemo::update_cache_() {
+   if (cache_attempted_ || resizer_.pending()) {
+      return;
+   }
+   cache_attempted_ = true;
+   if (!cache_wanted_()) {
+      return;
+   }
+
+   bool pipelined = pipeline_ && pipeline_->running();
+   if (pipelined) {
+      pipeline_->stop();
+   }
+
+   if (bake_cache_()) {
+      stop_pipeline_();
+      if (!headless_) {
+         upload_cache_();
+      }
+   } else if (pipelined) {
+      pipeline_->start(format_, dim_);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool TexDemo::bake_cache_() {
+   F64 time = time_;
+   TU start = ts_now();
+   bool baked = frame_cache_.bake(cache_phases_, std::size_t(cache_mb_) * 1024 * 1024, format_, dim_, [this](ImageBuffer& tex, F64 phase) {
+      std::swap(tex_, tex);
+      set_time_(phase * period_);
+      try {
+         PhaseTimer timer(stats_, Phase::generate);
+         generator_();
+      } catch (...) {
+         std::swap(tex_, tex);
+         throw;
+      }
+      std::swap(tex_, tex);
+   });
+   set_time_(time);
+
+   if (baked) {
+      be_verbose() << "Baked frame cache"
+         & attr("Phases") << frame_cache_.phases()
+         & attr("Frame Cache (MB)") << F64(frame_cache_.bytes()) / (1024.0 * 1024.0)
+         & attr("Bake Time (ms)") << tu_to_seconds(ts_now() - start) * 1000.0
+         | default_log();
+   } else {
+      be_verbose() << "Frame cache would exceed budget; generating frames live"
+         & attr("Phases") << cache_phases_
+         & attr("Budget (MB)") << cache_mb_
+         | default_log();
+   }
+   return baked;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Playback only rebinds textures, so once the frames are on the GPU the CPU
+// copies are freed.  They're not handed to pool_, since nothing else would
+// reuse that many buffers and the pool would just hold on to them.
+void TexDemo::upload_cache_() {
+   for (U32 i = 0; i < frame_cache_.phases(); ++i) {
+      cache_ids_.push_back(make_gl_texture_());
+      upload_(frame_cache_.frame(i));
+   }
+   frame_cache_.discard();
+   glBindTexture(GL_TEXTURE_2D, tex_id_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::clear_cache_() {
+   frame_cache_.clear();
+   if (!cache_ids_.empty()) {
+      glDeleteTextures((GLsizei)cache_ids_.size(), cache_ids_.data());
+      cache_ids_.clear();
+      glBindTexture(GL_TEXTURE_2D, tex_id_);
+   }
+   cache_attempted_ = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+GLuint TexDemo::make_gl_texture_() {
+   GLuint id = 0;
+   glGenTextures(1, &id);
+   glBindTexture(GL_TEXTURE_2D, id);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, linear_scaling_ ? GL_LINEAR : GL_NEAREST);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, linear_scaling_ ? GL_LINEAR : GL_NEAREST);
+   return id;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::start_pipeline_() {
+   // the view demos show the cached image directly and have nothing to
+   // pipeline, and frames that never change don't need a worker
+   if (pipeline_depth_ == 0 || !generator_ || fixed_size_ || cached_() || resolution_ ||
+       (generator_inputs_ & (input_time | input_rng | input_file)) == 0) {
+      return;
+   }
+
+   // once the pipeline has run, tex_ no longer holds the latest frame
+   generated_ = false;
+
+   {
+      std::lock_guard<std::mutex> lock(pipeline_seconds_mutex_);
+      pipeline_seconds_.clear();
+   }
+
+   // generate times are only recorded once the frame is consumed, so frames
+   // that are discarded (warmup) or never consumed don't skew the stats
+   pipeline_ = std::make_unique<FramePipeline>(pipeline_depth_, [this](ImageBuffer& tex) {
+      std::swap(tex_, tex);
+      try {
+         tick_();
+         TU start = ts_now();
+         generator_();
+         F64 seconds = tu_to_seconds(ts_now() - start);
+         std::lock_guard<std::mutex> lock(pipeline_seconds_mutex_);
+         pipeline_seconds_.push_back(seconds);
+      } catch (...) {
+         std::swap(tex_, tex);
+         throw;
+      }
+      std::swap(tex_, tex);
+   }, &pool_);
+   pipeline_->start(format_, dim_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::stop_pipeline_() {
+   if (!pipeline_) {
+      return;
+   }
+
+   pipeline_->stop();
+   be_info() << "Frame pipeline stopped"
+      & attr("Depth") << pipeline_->depth()
+      & attr("Produced") << pipeline_->produced()
+      & attr("Consumed") << pipeline_->consumed()
+      & attr("Max Queued") << pipeline_->max_queued()
+      & attr("Producer Stalls") << pipeline_->producer_stalls()
+      & attr("Consumer Stalls") << pipeline_->consumer_stalls()
+      | default_log();
+   pipeline_.reset();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Frames are consumed in the order they were produced, so the oldest time
+// belongs to the frame being consumed.
+void TexDemo::take_pipeline_seconds_(bool record) {
+   F64 seconds;
+   {
+      std::lock_guard<std::mutex> lock(pipeline_seconds_mutex_);
+      if (pipeline_seconds_.empty()) {
+         return;
+      }
+      seconds = pipeline_seconds_.front();
+      pipeline_seconds_.pop_front();
+   }
+   if (record) {
+      stats_.record(Phase::generate, seconds);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::write_stats_() {
+   for (std::size_t i = 0; i < std::size_t(Phase::count_); ++i) {
+      PhaseSummary s = stats_.summary(Phase(i));
+      if (s.count == 0) {
+         continue;
+      }
+      be_verbose() << "Phase timing"
+         & attr("Phase") << phase_name(Phase(i))
+         & attr("Count") << s.count
+         & attr("Mean (ms)") << s.mean * 1000.0
+         & attr("p50 (ms)") << s.p50 * 1000.0
+         & attr("p95 (ms)") << s.p95 * 1000.0
+         & attr("p99 (ms)") << s.p99 * 1000.0
+         & attr("Max (ms)") << s.max * 1000.0
+         | default_log();
+   }
+
+   if (!stats_file_.empty()) {
+      stats_.write(stats_file_, demo_);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::run_math_check_() {
+   for (auto& result : check_fast_math(1 << 20)) {
+      be_info() << "Math kernel check"
+         & attr("Kernel") << result.kernel
+         & attr("SIMD") << simd_level_name(result.level)
+         & attr("Max Abs Error") << result.max_abs_error
+         & attr("Mvalues/s") << result.mvalues_per_second
+         & attr("C Library Mvalues/s") << result.reference_mvalues_per_second
+         | default_log();
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::run_packing_check_() {
+   for (auto& result : check_float_packing(1 << 20)) {
+      be_info() << "Float packing check"
+         & attr("Kernel") << result.kernel
+         & attr("SIMD") << simd_level_name(result.level)
+         & attr("Mismatches") << result.mismatches
+         & attr("Mvalues/s") << result.mvalues_per_second
+         & attr("glm Mvalues/s") << result.reference_mvalues_per_second
+         | default_log();
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::run_blit_benchmark_() {
+   for (auto& result : benchmark_blits(ivec2(2048), 10)) {
+      be_info() << "Blit benchmark"
+         & attr("Kernel") << result.kernel
+         & attr("Source") << enum_name(to_gl_format(result.src).internal_format)
+         & attr("Destination") << enum_name(to_gl_format(result.dest).internal_format)
+         & attr("Max Abs Error") << result.max_abs_error
+         & attr("Mpixel/s") << result.mpixels_per_second
+         & attr("Generic Mpixel/s") << result.generic_mpixels_per_second
+         | default_log();
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::reseed_() {
+   if (!fixed_seed_) {
+      seed_ = perf_now();
+   }
+
+   be_verbose() << "Seeding RNG"
+      & attr("Seed") << seed_
+      | default_log();
+
+   rnd_.seed(seed_);
+   noise_.seed(seed_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::generate_expr_() {
+   ImageView image = tex_.image();
+   ivec2 dim = ivec2(image.dim());
+   radial_.prepare(*scheduler_, dim, expr_.radial_planes());
+   expr_.bind(F32(time_), effect_scale_);
+   generate_rows_parallel(*scheduler_, image, !generic_writers_, [=](const ImageRow& row, vec4* out) {
+      expr_.run_row(radial_, dim, row.x_begin, row.y, std::size_t(row.width()), out);
+   });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Slides that fail to load are logged and skipped in the direction of
+// travel, since this may be running under the GLFW key callback.  If none
+// load, the previous slide stays up.
+void TexDemo::show_slide_(bool opaque) {
+   for (std::size_t attempt = 0; attempt < files_.size(); ++attempt) {
+      TU start = ts_now();
+      LoadedImage image;
+      bool hit = false;
+      try {
+         prefetcher_->take(slide_, image, &hit);
+         image_cache_.assign(files_[slide_], opaque, std::move(image));
+      } catch (const std::exception& e) {
+         be_error() << "Failed to load slide"
+            & attr("Index") << slide_
+            & attr(ids::log_attr_path) << files_[slide_].string()
+            & attr(ids::log_attr_message) << S(e.what())
+            | default_log();
+         slide_ = slide_backward_ ? (slide_ + files_.size() - 1) % files_.size() : (slide_ + 1) % files_.size();
+         continue;
+      }
+      F64 wait_seconds = tu_to_seconds(ts_now() - start);
+
+      file_ = files_[slide_];
+      shown_slide_ = slide_;
+      slide_start_ = ts_now();
+
+      ivec2 dim = ivec2(image_cache_.source().dim());
+      if (dim != dim_) {
+         dim_ = dim;
+         if (wnd_) {
+            glfwSetWindowSize(wnd_, (int)(dim_.x * scale_), (int)(dim_.y * scale_));
+         }
+      }
+
+      be_verbose() << "Showing slide"
+         & attr("Index") << slide_
+         & attr(ids::log_attr_path) << file_.string()
+         & attr("Prefetched") << hit
+         & attr("Wait (ms)") << wait_seconds * 1000.0
+         | default_log();
+      return;
+   }
+
+   if (shown_slide_ != std::size_t(-1)) {
+      slide_ = shown_slide_;
+   } else {
+      shown_slide_ = slide_;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool TexDemo::navigate_slides_(int key) {
+   if (!prefetcher_) {
+      return false;
+   }
+
+   switch (key) {
+      case GLFW_KEY_RIGHT:
+      case GLFW_KEY_SPACE:
+      case GLFW_KEY_PAGE_DOWN:
+         slide_ = (slide_ + 1) % files_.size();
+         slide_backward_ = false;
+         break;
+      case GLFW_KEY_LEFT:
+      case GLFW_KEY_BACKSPACE:
+      case GLFW_KEY_PAGE_UP:
+         slide_ = (slide_ + files_.size() - 1) % files_.size();
+         slide_backward_ = true;
+         break;
+      default:
+         return false;
+   }
+
+   generate_(true);
+   upload_();
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::log_prefetch_() {
+   if (!prefetcher_) {
+      return;
+   }
+
+   U64 takes = prefetcher_->hits() + prefetcher_->misses();
+   F64 busy = prefetcher_->busy_seconds();
+   U64 images = prefetcher_->images();
+   be_info() << "Slideshow prefetch"
+      & attr("Files") << files_.size()
+      & attr("Depth") << prefetcher_->depth()
+      & attr("Threads") << prefetcher_->threads()
+      & attr("Images Decoded") << images
+      & attr("Mean Decode Time (ms)") << (images > 0 ? prefetcher_->decode_seconds() / F64(images) * 1000.0 : 0.0)
+      & attr("Images/s") << (busy > 0 ? F64(images) / busy : 0.0)
+      & attr("File MB/s") << (busy > 0 ? F64(prefetcher_->file_bytes()) / busy / 1000000.0 : 0.0)
+      & attr("Decoded MB/s") << (busy > 0 ? F64(prefetcher_->image_bytes()) / busy / 1000000.0 : 0.0)
+      & attr("Hits") << prefetcher_->hits()
+      & attr("Misses") << prefetcher_->misses()
+      & attr("Hit Rate") << (takes > 0 ? F64(prefetcher_->hits()) / F64(takes) : 0.0)
+      | default_log();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::open_tiles_() {
+   if (file_.empty()) {
+      be_error() << "The tiles demo requires --file" | default_log();
+      throw RecoverableError(std::make_error_code(std::errc::invalid_argument));
+   }
+   if (pyramid_file_.empty()) {
+      pyramid_file_ = Path(file_.string() + ".pyramid");
+   }
+
+   // tiles are stored in the texture format so they can be copied as-is
+   if (!pyramid_.open(pyramid_file_) || pyramid_.stale(file_, format_, tile_size_)) {
+      pyramid_.close();
+      TU start = ts_now();
+      image_cache_.refresh(file_, false);
+      bool built = MipPyramid::build(*scheduler_, image_cache_.source(), format_, tile_size_, U64(fs::file_size(file_)), pyramid_file_);
+      image_cache_.clear();
+      if (!built || !pyramid_.open(pyramid_file_)) {
+         be_error() << "Failed to build mip pyramid"
+            & attr(ids::log_attr_path) << pyramid_file_.string()
+            | default_log();
+         throw RecoverableError(std::make_error_code(std::errc::io_error));
+      }
+
+      be_info() << "Built mip pyramid"
+         & attr(ids::log_attr_path) << pyramid_file_.string()
+         & attr("Width") << pyramid_.level(0).dim.x
+         & attr("Height") << pyramid_.level(0).dim.y
+         & attr("Levels") << pyramid_.levels()
+         & attr("Tile Size") << pyramid_.tile_size()
+         & attr("Time (ms)") << tu_to_seconds(ts_now() - start) * 1000.0
+         | default_log();
+   }
+
+   tile_cache_.clear();
+   tile_cache_.max_bytes(std::size_t(tile_cache_mb_) * 1024 * 1024);
+   if (!pan_set_) {
+      pan_ = vec2(pyramid_.level(0).dim) * 0.5f;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::generate_tiles_() {
+   ImageView image = tex_.image();
+   tiles_level_ = render_tiled_view(*scheduler_, tile_cache_, pyramid_, pan_, zoom_, image);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool TexDemo::navigate_tiles_(int key) {
+   if (!pyramid_ || (pipeline_ && pipeline_->running())) {
+      return false;
+   }
+
+   vec2 image_dim = vec2(pyramid_.level(0).dim);
+   if (zoom_ <= 0.f) {
+      zoom_ = std::min(F32(dim_.x) / image_dim.x, F32(dim_.y) / image_dim.y);
+   }
+
+   // pan by a quarter of the view
+   vec2 step = vec2(dim_) * 0.25f / zoom_;
+   switch (key) {
+      case GLFW_KEY_LEFT:  pan_.x -= step.x; break;
+      case GLFW_KEY_RIGHT: pan_.x += step.x; break;
+      case GLFW_KEY_UP:    pan_.y -= step.y; break;
+      case GLFW_KEY_DOWN:  pan_.y += step.y; break;
+      case GLFW_KEY_EQUAL:
+      case GLFW_KEY_KP_ADD:
+         zoom_ *= 2.f;
+         break;
+      case GLFW_KEY_MINUS:
+      case GLFW_KEY_KP_SUBTRACT:
+         zoom_ *= 0.5f;
+         break;
+      default:
+         return false;
+   }
+   pan_ = glm::clamp(pan_, vec2(0.f), image_dim);
+
+   generate_(true);
+   upload_();
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::run_tile_queries_() {
+   tex_ = pool_.acquire(format_, dim_);
+   if (setup_) {
+      PhaseTimer timer(stats_, Phase::setup);
+      setup_();
+   }
+   if (!pyramid_) {
+      be_error() << "--query-tile requires the tiles demo" | default_log();
+      throw RecoverableError(std::make_error_code(std::errc::invalid_argument));
+   }
+
+   for (auto& query : tile_queries_) {
+      U32 level = query.first;
+      ivec2 tile = query.second;
+      if (level >= pyramid_.levels() || tile.x >= pyramid_.level(level).tiles.x || tile.y >= pyramid_.level(level).tiles.y) {
+         be_warn() << "Tile out of range"
+            & attr("Level") << level
+            & attr("Tile X") << tile.x
+            & attr("Tile Y") << tile.y
+            | default_log();
+         continue;
+      }
+
+      bool hit = false;
+      TU start = ts_now();
+      TileCache::TileData data = tile_cache_.get(pyramid_, level, tile, &hit);
+      F64 seconds = tu_to_seconds(ts_now() - start);
+
+      // FNV-1a
+      U64 checksum = 14695981039346656037ull;
+      for (UC c : *data) {
+         checksum = (checksum ^ c) * 1099511628211ull;
+      }
+
+      be_info() << "Tile query"
+         & attr("Level") << level
+         & attr("Level Width") << pyramid_.level(level).dim.x
+         & attr("Level Height") << pyramid_.level(level).dim.y
+         & attr("Tile X") << tile.x
+         & attr("Tile Y") << tile.y
+         & attr("Hit") << hit
+         & attr("Time (ms)") << seconds * 1000.0
+         & attr("Checksum") << checksum
+         | default_log();
+   }
+
+   log_tile_cache_();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::log_tile_cache_() {
+   if (!pyramid_) {
+      return;
+   }
+
+   U64 lookups = tile_cache_.hits() + tile_cache_.misses();
+   be_info() << "Tile cache"
+      & attr("Last Level") << tiles_level_
+      & attr("Tiles") << tile_cache_.tiles()
+      & attr("Size (MB)") << F64(tile_cache_.bytes()) / (1024.0 * 1024.0)
+      & attr("Cap (MB)") << F64(tile_cache_.max_bytes()) / (1024.0 * 1024.0)
+      & attr("Hits") << tile_cache_.hits()
+      & attr("Misses") << tile_cache_.misses()
+      & attr("Evictions") << tile_cache_.evictions()
+      & attr("Hit Rate") << (lookups > 0 ? F64(tile_cache_.hits()) / F64(lookups) : 0.0)
+      | default_log();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::generate_noise_(U32 channels) {
+   ImageView image = tex_.image();
+   ivec2 dim = ivec2(image.dim());
+   ivec2 tile_dim = choose_tile_dim(dim, image.format().block_size());
+   noise_.prepare(count_tiles(dim, tile_dim));
+
+   dispatch_pixel_writer(image, !generic_writers_, [&](auto put) {
+      visit_image_rows_parallel(*scheduler_, image, [&](const ImageRow& row) {
+         NoiseStream& stream = noise_.stream(row.tile);
+         thread_local std::vector<F32> samples;
+         thread_local std::vector<vec4> values;
+         samples.resize(std::size_t(row.width()) * channels);
+         values.resize(std::size_t(row.width()));
+
+         stream.fill_unorm(samples.data(), samples.size());
+         const F32* sample = samples.data();
+         for (vec4& pixel_norm : values) {
+            pixel_norm = channels == 1 ? vec4(sample[0]) : vec4(sample[0], sample[1], sample[2], 1.f);
+            sample += channels;
+         }
+
+         put(row, values.data());
+      });
+   });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool TexDemo::generate_(bool force) {
+   if (!force && generated_ &&
+       (generator_inputs_ & (input_rng | input_file)) == 0 &&
+       (!(generator_inputs_ & input_time) || time_ == generated_time_) &&
+       (!(generator_inputs_ & input_effect_scale) || effect_scale_ == generated_effect_scale_) &&
+       (!(generator_inputs_ & input_dim) || dim_ == generated_dim_)) {
+      ++skipped_frames_;
+      return false;
+   }
+
+   {
+      PhaseTimer timer(stats_, Phase::generate);
+      generator_();
+   }
+   generated_ = true;
+   generated_time_ = time_;
+   generated_effect_scale_ = effect_scale_;
+   generated_dim_ = dim_;
+   ++generated_frames_;
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::tick_() {
+   last_ = now_;
+   now_ = ts_now();
+   set_time_(time_ + tu_to_seconds(now_ - last_) / time_scale_);
+
+   if (prefetcher_ && generated_ && (headless_ || (slide_seconds_ > 0.f && tu_to_seconds(now_ - slide_start_) >= slide_seconds_))) {
+      slide_ = (slide_ + 1) % files_.size();
+      slide_backward_ = false;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::set_time_(F64 time) {
+   time_ = time;
+   sin_time_ = (F32)sin(time_ * 2.0 * glm::pi<F64>());
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void TexDemo::upload_() {
-   auto f = to_gl_format(tex_.view.format());
+   upload_(frame_image_());
+}
 
-   glPixelStorei(GL_UNPACK_ALIGNMENT, (GLint) tex_.storage->line_alignment());
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::upload_(const ImageView& image) {
+   if (compress_enabled_) {
+      compress_(image);
+      PhaseTimer timer(stats_, Phase::upload);
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+      be_verbose() << "Uploading compressed image"
+         & attr("Internal Format") << enum_name(compressed_.gl_format())
+         & attr("Size (KB)") << F64(compressed_.data.size()) / 1024.0
+         | default_log();
+
+      glCompressedTexImage2D(GL_TEXTURE_2D, 0, compressed_.gl_format(), compressed_.dim.x, compressed_.dim.y, 0, (GLsizei)compressed_.data.size(), compressed_.data.data());
+      return;
+   }
+
+   PhaseTimer timer(stats_, Phase::upload);
+   auto f = to_gl_format(image.format());
+
+   // Rows are padded to the largest power of two (up to 8) dividing the line
+   // span; this also covers views that don't belong to tex_.
+   GLint alignment = 8;
+   while (alignment > 1 && image.line_span() % std::size_t(alignment) != 0) {
+      alignment /= 2;
+   }
+   glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
 
    be_verbose() << "Uploading image"
       & attr("Internal Format") << enum_name(f.internal_format)
@@ -562,7 +1802,23 @@ void TexDemo::upload_() {
       & attr("Data Type") << enum_name(f.data_type)
       | default_log();
 
-   //glCompressedTexImage2D(GL_TEXTURE_2D, 0, f.internal_format, tex_.view.dim(0).x, tex_.view.dim(0).y, 0, (GLsizei)tex_.view.image().size(), tex_.view.image().data());
+   glTexImage2D(GL_TEXTURE_2D, 0, f.internal_format, image.dim().x, image.dim().y, 0, f.data_format, f.data_type, image.data());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ImageView TexDemo::frame_image_() const {
+   return view_image_ ? *view_image_ : tex_.image();
+}
 
-   glTexImage2D(GL_TEXTURE_2D, 0, f.internal_format, tex_.view.dim(0).x, tex_.view.dim(0).y, 0, f.data_format, f.data_type, tex_.view.image().data());
+///////////////////////////////////////////////////////////////////////////////
+void TexDemo::compress_(const ImageView& image) {
+   if (!encode_scheduler_) {
+      encode_scheduler_ = std::make_unique<TileScheduler>(threads_);
+   }
+   TU start = ts_now();
+   encode_blocks(*encode_scheduler_, image, block_codec_, block_quality_, compressed_);
+   F64 seconds = tu_to_seconds(ts_now() - start);
+   stats_.record(Phase::convert, seconds);
+   encode_seconds_ += seconds;
+   ++encoded_frames_;
 }
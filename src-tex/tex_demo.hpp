@@ -2,6 +2,22 @@
 #ifndef TEX_DEMO_HPP_
 #define TEX_DEMO_HPP_
 
+#include "tex_tile_scheduler.hpp"
+#include "tex_noise.hpp"
+#include "tex_radial_field.hpp"
+#include "tex_expr.hpp"
+#include "tex_color_lut.hpp"
+#include "tex_image_cache.hpp"
+#include "tex_image_prefetcher.hpp"
+#include "tex_frame_pipeline.hpp"
+#include "tex_texture_pool.hpp"
+#include "tex_resize_coalescer.hpp"
+#include "tex_resolution_controller.hpp"
+#include "tex_frame_cache.hpp"
+#include "tex_phase_stats.hpp"
+#include "tex_block_encoder.hpp"
+#include "tex_mip_pyramid.hpp"
+#include "tex_tile_cache.hpp"
 #include <be/core/lifecycle.hpp>
 #include <be/core/glm.hpp>
 #include <be/core/time.hpp>
@@ -11,8 +27,13 @@
 #include <be/gfx/tex/texture.hpp>
 #include <be/gfx/bgl.hpp>
 #include <glfw/glfw3.h>
+#include <deque>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <random>
+#include <utility>
+#include <vector>
 
 ///////////////////////////////////////////////////////////////////////////////
 class TexDemo final {
@@ -20,9 +41,63 @@ public:
    TexDemo(int argc, char** argv);
    int operator()();
 
+   // For driving headless runs from the benchmark suite.
+   const PhaseStats& stats() const;
+   be::ivec2 dim() const;
+
 private:
+   // Inputs a generator's output depends on, so animated windowed frames can
+   // be skipped when none of them changed (headless runs always generate).
+   // rng and file inputs are assumed to change every frame.
+   enum generator_input : be::U32 {
+      input_time = 1,
+      input_rng = 2,
+      input_effect_scale = 4,
+      input_dim = 8,
+      input_file = 16,
+      input_all = 0xFFFFFFFF
+   };
+
    void run_();
+   void run_headless_();
+   void run_resize_sequence_();
+   void run_math_check_();
+   void run_packing_check_();
+   void run_blit_benchmark_();
+   bool generate_(bool force);
+   void tick_();
+   void set_time_(be::F64 time);
+   void reseed_();
+   void generate_noise_(be::U32 channels);
+   void generate_expr_();
+   void show_slide_(bool opaque);
+   bool navigate_slides_(int key);
+   void log_prefetch_();
+   void open_tiles_();
+   void generate_tiles_();
+   bool navigate_tiles_(int key);
+   void run_tile_queries_();
+   void log_tile_cache_();
+   void regenerate_(be::ivec2 dim);
+   void resize_texture_(be::ivec2 dim);
+   void start_resolution_control_();
+   void adapt_resolution_(be::F64 seconds);
+   void log_resolution_();
+   bool cache_wanted_() const;
+   bool cached_() const;
+   void update_cache_();
+   bool bake_cache_();
+   void upload_cache_();
+   void clear_cache_();
+   void write_stats_();
+   be::gfx::gl::GLuint make_gl_texture_();
+   void start_pipeline_();
+   void stop_pipeline_();
+   void take_pipeline_seconds_(bool record);
    void upload_();
+   void upload_(const be::gfx::tex::ImageView& image);
+   void compress_(const be::gfx::tex::ImageView& image);
+   be::gfx::tex::ImageView frame_image_() const;
 
    be::CoreInitLifecycle init_;
    be::CoreLifecycle core_;
@@ -31,17 +106,71 @@ private:
    be::I8 status_ = 0;
 
    bool resizable_ = false;
+   bool fixed_size_ = false; // the generator picks dim_, so resizing only rescales
+   be::I32 resize_preview_ = 4;
+   ResizeCoalescer resizer_ = ResizeCoalescer(be::ivec2(160, 120));
+   std::vector<std::pair<be::F64, be::ivec2>> resize_sequence_;
    be::ivec2 dim_ = be::ivec2(160, 120);
    be::F32 scale_ = 4.f;
    bool linear_scaling_ = false;
+   be::F32 target_ms_ = 0.f;
+   be::F32 min_scale_ = 0.25f;
+   be::F32 simulated_ms_per_mpixel_ = 0.f;
+   be::F64 simulated_now_ = 0.0;
+   std::unique_ptr<ResolutionController> resolution_;
    GLFWwindow* wnd_ = nullptr;
    be::gfx::tex::ImageFormat format_; // TODO
-   be::gfx::tex::Texture tex_;
+   TexturePool pool_;
+   ImageBuffer tex_;
    be::gfx::gl::GLuint tex_id_ = 0;
+   be::F64 period_ = 0.0; // in units of time_; 0 if the generator isn't periodic
+   be::U32 cache_mb_ = 0;
+   be::U32 cache_phases_ = 120;
+   bool cache_attempted_ = false;
+   FrameCache frame_cache_ { &pool_ };
+   std::vector<be::gfx::gl::GLuint> cache_ids_;
    std::function<void()> setup_;
    std::function<void()> generator_;
+   be::U32 generator_inputs_ = input_all;
+   bool generated_ = false;
+   be::F64 generated_time_ = 0.0;
+   be::F32 generated_effect_scale_ = 0.f;
+   be::ivec2 generated_dim_;
+   be::U64 generated_frames_ = 0;
+   be::U64 skipped_frames_ = 0;
+   PhaseStats stats_;
+   be::Path stats_file_;
+   be::U32 threads_ = 0;
+   std::unique_ptr<TileScheduler> scheduler_;
+   bool generic_writers_ = false;
    bool animate_ = false;
+   bool headless_ = false;
+   bool check_math_ = false;
+   bool check_packing_ = false;
+   bool bench_blit_ = false;
+   be::U32 frames_ = 100;
+   be::U32 warmup_ = 0;
+   be::Path dump_file_;
+   be::U32 pipeline_depth_ = 0;
+   std::unique_ptr<FramePipeline> pipeline_;
+   std::mutex pipeline_seconds_mutex_;
+   std::deque<be::F64> pipeline_seconds_; // generate times of frames not yet consumed
+   bool compress_enabled_ = false;
+   BlockCodec block_codec_ = BlockCodec::bc1;
+   BlockQuality block_quality_ = BlockQuality::normal;
+   std::unique_ptr<TileScheduler> encode_scheduler_; // scheduler_ may be busy on the pipeline worker
+   CompressedImage compressed_;
+   be::F64 encode_seconds_ = 0.0;
+   be::U64 encoded_frames_ = 0;
+   be::S demo_;
+   be::U64 seed_ = 0;
+   bool fixed_seed_ = false;
    be::util::xo128p rnd_;
+   NoiseEngine noise_;
+   RadialField radial_;
+   ExprProgram expr_;
+   be::U32 lut_size_ = 1024;
+   ColorLut1D hue_lut_;
    std::uniform_int_distribution<> idist_ = std::uniform_int_distribution<>(0, 255);
    std::uniform_real_distribution<be::F32> fdist_ = std::uniform_real_distribution<be::F32>(0.f, 1.f);
    be::TU last_ = be::TU::zero();
@@ -52,6 +181,27 @@ private:
    be::F32 effect_scale_ = 1.f;
    be::vec4 data_[8];
    be::Path file_;
+   std::vector<be::Path> files_;
+   ImageCache image_cache_;
+   be::U32 prefetch_depth_ = 4;
+   be::U32 decode_threads_ = 0;
+   be::F32 slide_seconds_ = 5.f;
+   std::unique_ptr<ImagePrefetcher> prefetcher_;
+   std::size_t slide_ = 0;
+   std::size_t shown_slide_ = std::size_t(-1);
+   bool slide_backward_ = false; // skip failed slides toward the previous one
+   be::TU slide_start_ = be::TU::zero();
+   be::Path pyramid_file_;
+   MipPyramid pyramid_;
+   be::I32 tile_size_ = MipPyramid::default_tile_size;
+   be::U32 tile_cache_mb_ = 256;
+   TileCache tile_cache_;
+   be::F32 zoom_ = 0.f; // texture pixels per image pixel; 0 fits the image
+   be::vec2 pan_;
+   bool pan_set_ = false;
+   be::U32 tiles_level_ = 0;
+   std::vector<std::pair<be::U32, be::ivec2>> tile_queries_;
+   const be::gfx::tex::ImageView* view_image_ = nullptr; // shown instead of tex_ when set
 };
 
 #endif
@@ -0,0 +1,644 @@
+#include "tex_expr.hpp"
+#include "tex_fast_math.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+using namespace be;
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+struct ParseError {
+   S message;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+F32 evaluate(ExprOp op, F32 a, F32 b, F32 c) {
+   switch (op) {
+      case ExprOp::add:    return a + b;
+      case ExprOp::sub:    return a - b;
+      case ExprOp::mul:    return a * b;
+      case ExprOp::div:    return a / b;
+      case ExprOp::affine: return a * b + c;
+      case ExprOp::min:    return std::min(a, b);
+      case ExprOp::max:    return std::max(a, b);
+      case ExprOp::pow:    return std::pow(a, b);
+      case ExprOp::atan2:  return std::atan2(a, b);
+      case ExprOp::sin:    return std::sin(a);
+      case ExprOp::cos:    return std::cos(a);
+      case ExprOp::sqrt:   return std::sqrt(a);
+      case ExprOp::abs:    return std::abs(a);
+      case ExprOp::floor:  return std::floor(a);
+      case ExprOp::fract:  return a - std::floor(a);
+      case ExprOp::exp:    return std::exp(a);
+      case ExprOp::log:    return std::log(a);
+      default:             return 0.f;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename F>
+void unary_op(const F32* a, F32* dest, std::size_t n, F func) {
+   for (std::size_t i = 0; i < n; ++i) {
+      dest[i] = func(a[i]);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// At least one of a and b is a row; the other may be a per-frame scalar.
+template <typename F>
+void binary_op(const F32* a, F32 scalar_a, const F32* b, F32 scalar_b, F32* dest, std::size_t n, F func) {
+   if (a && b) {
+      for (std::size_t i = 0; i < n; ++i) {
+         dest[i] = func(a[i], b[i]);
+      }
+   } else if (a) {
+      for (std::size_t i = 0; i < n; ++i) {
+         dest[i] = func(a[i], scalar_b);
+      }
+   } else {
+      for (std::size_t i = 0; i < n; ++i) {
+         dest[i] = func(scalar_a, b[i]);
+      }
+   }
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+class ExprProgram::Parser final {
+public:
+   Parser(ExprProgram& program, const S& source)
+      : program_(program),
+        source_(source) { }
+
+   std::vector<I32> parse() {
+      std::vector<I32> channels;
+      channels.push_back(expression_());
+      while (accept_(',')) {
+         channels.push_back(expression_());
+      }
+      skip_space_();
+      if (pos_ < source_.size()) {
+         fail_(S("unexpected '") + source_[pos_] + "'");
+      }
+      if (channels.size() == 2) {
+         fail_("expected 1, 3 or 4 channel expressions");
+      }
+      if (channels.size() > 4) {
+         fail_("too many channel expressions");
+      }
+      return channels;
+   }
+
+private:
+   void skip_space_() {
+      while (pos_ < source_.size() && std::isspace((unsigned char)source_[pos_])) {
+         ++pos_;
+      }
+   }
+
+   bool accept_(char c) {
+      skip_space_();
+      if (pos_ < source_.size() && source_[pos_] == c) {
+         ++pos_;
+         return true;
+      }
+      return false;
+   }
+
+   void expect_(char c) {
+      if (!accept_(c)) {
+         fail_(S("expected '") + c + "'");
+      }
+   }
+
+   [[noreturn]] void fail_(const S& message) const {
+      throw ParseError { "column " + std::to_string(pos_ + 1) + ": " + message };
+   }
+
+   I32 expression_() {
+      I32 result = term_();
+      for (;;) {
+         if (accept_('+')) {
+            result = program_.make_(ExprOp::add, result, term_());
+         } else if (accept_('-')) {
+            result = program_.make_(ExprOp::sub, result, term_());
+         } else {
+            return result;
+         }
+      }
+   }
+
+   I32 term_() {
+      I32 result = unary_();
+      for (;;) {
+         if (accept_('*')) {
+            result = program_.make_(ExprOp::mul, result, unary_());
+         } else if (accept_('/')) {
+            result = program_.make_(ExprOp::div, result, unary_());
+         } else {
+            return result;
+         }
+      }
+   }
+
+   I32 unary_() {
+      if (accept_('-')) {
+         return program_.make_(ExprOp::mul, unary_(), program_.constant_(-1.f));
+      } else if (accept_('+')) {
+         return unary_();
+      }
+      return power_();
+   }
+
+   // right associative, and binds tighter than unary minus: -x^2 is -(x^2)
+   I32 power_() {
+      I32 base = primary_();
+      if (accept_('^')) {
+         return program_.make_(ExprOp::pow, base, unary_());
+      }
+      return base;
+   }
+
+   I32 primary_() {
+      skip_space_();
+      if (pos_ >= source_.size()) {
+         fail_("unexpected end of expression");
+      }
+
+      char c = source_[pos_];
+      if (accept_('(')) {
+         I32 result = expression_();
+         expect_(')');
+         return result;
+      }
+
+      if (std::isdigit((unsigned char)c) || c == '.') {
+         const char* begin = source_.c_str() + pos_;
+         char* end = nullptr;
+         F32 value = std::strtof(begin, &end);
+         if (end == begin) {
+            fail_("invalid number");
+         }
+         pos_ += std::size_t(end - begin);
+         return program_.constant_(value);
+      }
+
+      if (!std::isalpha((unsigned char)c) && c != '_') {
+         fail_(S("unexpected '") + c + "'");
+      }
+
+      std::size_t start = pos_;
+      while (pos_ < source_.size() && (std::isalnum((unsigned char)source_[pos_]) || source_[pos_] == '_')) {
+         ++pos_;
+      }
+      S name = source_.substr(start, pos_ - start);
+
+      skip_space_();
+      if (pos_ < source_.size() && source_[pos_] == '(') {
+         return call_(name);
+      }
+
+      if (name == "x") return program_.input_(ExprInput::x);
+      if (name == "y") return program_.input_(ExprInput::y);
+      if (name == "r") return program_.input_(ExprInput::r);
+      if (name == "theta") return program_.input_(ExprInput::theta);
+      if (name == "t") return program_.input_(ExprInput::t);
+      if (name == "effect_scale") return program_.input_(ExprInput::effect_scale);
+      if (name == "pi") return program_.constant_(glm::pi<F32>());
+
+      pos_ = start;
+      fail_("unknown variable '" + name + "'");
+   }
+
+   I32 call_(const S& name) {
+      struct Function {
+         const char* name;
+         ExprOp op;
+         std::size_t args;
+      };
+      static const Function functions[] = {
+         { "sin", ExprOp::sin, 1 },
+         { "cos", ExprOp::cos, 1 },
+         { "sqrt", ExprOp::sqrt, 1 },
+         { "abs", ExprOp::abs, 1 },
+         { "floor", ExprOp::floor, 1 },
+         { "fract", ExprOp::fract, 1 },
+         { "exp", ExprOp::exp, 1 },
+         { "log", ExprOp::log, 1 },
+         { "atan2", ExprOp::atan2, 2 },
+         { "min", ExprOp::min, 2 },
+         { "max", ExprOp::max, 2 },
+         { "pow", ExprOp::pow, 2 },
+         { "clamp", ExprOp::min, 3 } // min(max(a, b), c)
+      };
+
+      const Function* func = nullptr;
+      for (auto& f : functions) {
+         if (name == f.name) {
+            func = &f;
+         }
+      }
+      if (!func) {
+         fail_("unknown function '" + name + "'");
+      }
+
+      expect_('(');
+      std::vector<I32> args;
+      if (!accept_(')')) {
+         args.push_back(expression_());
+         while (accept_(',')) {
+            args.push_back(expression_());
+         }
+         expect_(')');
+      }
+      if (args.size() != func->args) {
+         fail_(S(func->name) + " takes " + std::to_string(func->args) + " argument" + (func->args == 1 ? "" : "s"));
+      }
+
+      if (func->args == 3) {
+         return program_.make_(ExprOp::min, program_.make_(ExprOp::max, args[0], args[1]), args[2]);
+      }
+      return program_.make_(func->op, args[0], func->args > 1 ? args[1] : -1);
+   }
+
+   ExprProgram& program_;
+   const S& source_;
+   std::size_t pos_ = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+bool ExprProgram::compile(const S& source, S& error) {
+   nodes_.clear();
+   channels_.clear();
+   tape_.clear();
+   row_inputs_.clear();
+   inputs_ = 0;
+   registers_ = 0;
+
+   try {
+      std::vector<I32> outputs = Parser(*this, source).parse();
+      build_tape_(outputs);
+   } catch (const ParseError& e) {
+      error = e.message;
+      nodes_.clear();
+      channels_.clear();
+      tape_.clear();
+      return false;
+   }
+
+   values_.assign(nodes_.size(), 0.f);
+   bind(0.f, 1.f);
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool ExprProgram::uses(ExprInput input) const {
+   return (inputs_ & (1u << U32(input))) != 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U8 ExprProgram::radial_planes() const {
+   U8 planes = 0;
+   if (uses(ExprInput::r)) {
+      planes |= RadialField::plane_distance;
+   }
+   if (uses(ExprInput::r2)) {
+      planes |= RadialField::plane_distance2;
+   }
+   if (uses(ExprInput::theta)) {
+      planes |= RadialField::plane_angle;
+   }
+   return planes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ExprProgram::bind(F32 t, F32 effect_scale) {
+   // nodes only refer to earlier nodes, so one pass in order suffices
+   for (std::size_t i = 0; i < nodes_.size(); ++i) {
+      const Node& node = nodes_[i];
+      if (node.variability == Variability::varying) {
+         continue;
+      }
+      if (node.op == ExprOp::constant) {
+         values_[i] = node.value;
+      } else if (node.op == ExprOp::input) {
+         values_[i] = node.input == ExprInput::t ? t : effect_scale;
+      } else {
+         values_[i] = evaluate(node.op,
+                               node.args[0] >= 0 ? values_[std::size_t(node.args[0])] : 0.f,
+                               node.args[1] >= 0 ? values_[std::size_t(node.args[1])] : 0.f,
+                               node.args[2] >= 0 ? values_[std::size_t(node.args[2])] : 0.f);
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ExprProgram::run_row(const RadialField& radial, ivec2 dim, I32 x_begin, I32 y, std::size_t n, vec4* out) const {
+   thread_local std::vector<F32> registers;
+   thread_local std::vector<const F32*> rows;
+   if (registers.size() < std::size_t(registers_) * n) {
+      registers.resize(std::size_t(registers_) * n);
+   }
+   rows.assign(nodes_.size(), nullptr);
+
+   for (I32 node : row_inputs_) {
+      switch (nodes_[std::size_t(node)].input) {
+         case ExprInput::r:  rows[std::size_t(node)] = radial.distance(y) + x_begin; break;
+         case ExprInput::r2: rows[std::size_t(node)] = radial.distance2(y) + x_begin; break;
+         default:            rows[std::size_t(node)] = radial.angle(y) + x_begin; break;
+      }
+   }
+
+   for (auto& instruction : tape_) {
+      F32* dest = registers.data() + std::size_t(instruction.dest) * n;
+      execute_(nodes_[std::size_t(instruction.node)], rows, dest, dim, x_begin, y, n);
+      rows[std::size_t(instruction.node)] = dest;
+   }
+
+   F32* values = glm::value_ptr(out[0]);
+   for (std::size_t c = 0; c < 4; ++c) {
+      if (channels_.size() == 3 && c == 3) {
+         for (std::size_t i = 0; i < n; ++i) {
+            values[i * 4 + c] = 1.f;
+         }
+         continue;
+      }
+
+      const Channel& channel = channels_[channels_.size() == 1 ? 0 : c];
+      const F32* src = rows[std::size_t(channel.node)];
+      if (src) {
+         // a trailing multiply-add is applied here instead of in its own pass
+         F32 scale = values_[std::size_t(channel.scale)];
+         F32 offset = values_[std::size_t(channel.offset)];
+         for (std::size_t i = 0; i < n; ++i) {
+            values[i * 4 + c] = src[i] * scale + offset;
+         }
+      } else {
+         F32 value = values_[std::size_t(channel.node)];
+         for (std::size_t i = 0; i < n; ++i) {
+            values[i * 4 + c] = value;
+         }
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+I32 ExprProgram::constant_(F32 value) {
+   return intern_(Node { ExprOp::constant, ExprInput::x, Variability::constant, value, { -1, -1, -1 } });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+I32 ExprProgram::input_(ExprInput input) {
+   Variability variability = input == ExprInput::t || input == ExprInput::effect_scale ? Variability::uniform : Variability::varying;
+   return intern_(Node { ExprOp::input, input, variability, 0.f, { -1, -1, -1 } });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Folds and rewrites the operation where possible, then returns the shared
+// node for it.
+I32 ExprProgram::make_(ExprOp op, I32 a, I32 b, I32 c) {
+   Variability variability = Variability::constant;
+   for (I32 arg : { a, b, c }) {
+      if (arg >= 0) {
+         variability = std::max(variability, nodes_[std::size_t(arg)].variability);
+      }
+   }
+
+   if (variability == Variability::constant) {
+      return constant_(evaluate(op,
+                                nodes_[std::size_t(a)].value,
+                                b >= 0 ? nodes_[std::size_t(b)].value : 0.f,
+                                c >= 0 ? nodes_[std::size_t(c)].value : 0.f));
+   }
+
+   bool row_a = nodes_[std::size_t(a)].variability == Variability::varying;
+   bool row_b = b >= 0 && nodes_[std::size_t(b)].variability == Variability::varying;
+
+   switch (op) {
+      case ExprOp::add:
+         if (is_constant_(a, 0.f)) return b;
+         if (is_constant_(b, 0.f)) return a;
+         if (row_a && !row_b) return make_(ExprOp::affine, a, constant_(1.f), b);
+         if (row_b && !row_a) return make_(ExprOp::affine, b, constant_(1.f), a);
+         break;
+
+      case ExprOp::sub:
+         if (is_constant_(b, 0.f)) return a;
+         if (row_a && !row_b) return make_(ExprOp::affine, a, constant_(1.f), make_(ExprOp::mul, b, constant_(-1.f)));
+         if (row_b && !row_a) return make_(ExprOp::affine, b, constant_(-1.f), a);
+         break;
+
+      case ExprOp::mul:
+         if (is_constant_(a, 1.f)) return b;
+         if (is_constant_(b, 1.f)) return a;
+         if (a == b && nodes_[std::size_t(a)].op == ExprOp::input && nodes_[std::size_t(a)].input == ExprInput::r) {
+            return input_(ExprInput::r2);
+         }
+         if (row_a && !row_b) return make_(ExprOp::affine, a, b, constant_(0.f));
+         if (row_b && !row_a) return make_(ExprOp::affine, b, a, constant_(0.f));
+         break;
+
+      case ExprOp::div:
+         if (is_constant_(b, 1.f)) return a;
+         if (row_a && !row_b) return make_(ExprOp::affine, a, make_(ExprOp::div, constant_(1.f), b), constant_(0.f));
+         break;
+
+      case ExprOp::pow:
+         if (is_constant_(b, 1.f)) return a;
+         if (is_constant_(b, 2.f)) return make_(ExprOp::mul, a, a);
+         if (is_constant_(b, 0.5f)) return make_(ExprOp::sqrt, a);
+         break;
+
+      case ExprOp::affine: {
+         if (is_constant_(b, 1.f) && is_constant_(c, 0.f)) return a;
+         Node inner = nodes_[std::size_t(a)];
+         if (inner.op == ExprOp::affine) {
+            I32 scale = make_(ExprOp::mul, inner.args[1], b);
+            I32 offset = make_(ExprOp::add, make_(ExprOp::mul, inner.args[2], b), c);
+            return make_(ExprOp::affine, inner.args[0], scale, offset);
+         }
+         break;
+      }
+
+      default:
+         break;
+   }
+
+   return intern_(Node { op, ExprInput::x, variability, 0.f, { a, b, c } });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Expressions are small, so a linear search is fine.
+I32 ExprProgram::intern_(const Node& node) {
+   for (std::size_t i = 0; i < nodes_.size(); ++i) {
+      const Node& other = nodes_[i];
+      if (other.op == node.op && other.input == node.input &&
+          std::memcmp(&other.value, &node.value, sizeof(F32)) == 0 &&
+          std::equal(std::begin(other.args), std::end(other.args), std::begin(node.args))) {
+         return I32(i);
+      }
+   }
+   nodes_.push_back(node);
+   return I32(nodes_.size() - 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool ExprProgram::is_constant_(I32 node, F32 value) const {
+   return node >= 0 && nodes_[std::size_t(node)].op == ExprOp::constant && nodes_[std::size_t(node)].value == value;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ExprProgram::build_tape_(const std::vector<I32>& outputs) {
+   for (I32 output : outputs) {
+      const Node& node = nodes_[std::size_t(output)];
+      if (node.variability != Variability::varying) {
+         channels_.push_back(Channel { output, -1, -1 });
+      } else if (node.op == ExprOp::affine) {
+         channels_.push_back(Channel { node.args[0], node.args[1], node.args[2] });
+      } else {
+         I32 one = constant_(1.f);
+         channels_.push_back(Channel { output, one, constant_(0.f) });
+      }
+   }
+
+   // everything reachable from a channel; since nodes only refer to earlier
+   // nodes, one backwards pass marks them all
+   std::vector<bool> reachable(nodes_.size(), false);
+   for (auto& channel : channels_) {
+      for (I32 node : { channel.node, channel.scale, channel.offset }) {
+         if (node >= 0) {
+            reachable[std::size_t(node)] = true;
+         }
+      }
+   }
+   for (std::size_t i = nodes_.size(); i-- > 0; ) {
+      if (!reachable[i]) {
+         continue;
+      }
+      const Node& node = nodes_[i];
+      if (node.op == ExprOp::input) {
+         inputs_ |= 1u << U32(node.input);
+      }
+      for (I32 arg : node.args) {
+         if (arg >= 0) {
+            reachable[std::size_t(arg)] = true;
+         }
+      }
+   }
+
+   // registers are released after the last instruction that reads them
+   const I32 never = std::numeric_limits<I32>::max();
+   std::vector<I32> last_use(nodes_.size(), -1);
+   for (std::size_t i = 0; i < nodes_.size(); ++i) {
+      if (reachable[i]) {
+         for (I32 arg : nodes_[i].args) {
+            if (arg >= 0) {
+               last_use[std::size_t(arg)] = I32(i);
+            }
+         }
+      }
+   }
+   for (auto& channel : channels_) {
+      last_use[std::size_t(channel.node)] = never;
+   }
+
+   std::vector<I32> node_register(nodes_.size(), -1);
+   std::vector<I32> free_registers;
+   for (std::size_t i = 0; i < nodes_.size(); ++i) {
+      const Node& node = nodes_[i];
+      if (!reachable[i] || node.variability != Variability::varying) {
+         continue;
+      }
+      if (node.op == ExprOp::input && node.input != ExprInput::x && node.input != ExprInput::y) {
+         row_inputs_.push_back(I32(i));
+         continue;
+      }
+
+      I32 dest;
+      if (free_registers.empty()) {
+         dest = registers_++;
+      } else {
+         dest = free_registers.back();
+         free_registers.pop_back();
+      }
+      node_register[i] = dest;
+      tape_.push_back(Instruction { I32(i), dest });
+
+      for (std::size_t a = 0; a < 3; ++a) {
+         I32 arg = node.args[a];
+         if (arg >= 0 && last_use[std::size_t(arg)] == I32(i) && node_register[std::size_t(arg)] >= 0 &&
+             std::find(node.args, node.args + a, arg) == node.args + a) {
+            free_registers.push_back(node_register[std::size_t(arg)]);
+         }
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ExprProgram::execute_(const Node& node, const std::vector<const F32*>& rows, F32* dest, ivec2 dim, I32 x_begin, I32 y, std::size_t n) const {
+   const F32* a = node.args[0] >= 0 ? rows[std::size_t(node.args[0])] : nullptr;
+   const F32* b = node.args[1] >= 0 ? rows[std::size_t(node.args[1])] : nullptr;
+   F32 scalar_a = node.args[0] >= 0 ? values_[std::size_t(node.args[0])] : 0.f;
+   F32 scalar_b = node.args[1] >= 0 ? values_[std::size_t(node.args[1])] : 0.f;
+
+   switch (node.op) {
+      case ExprOp::input:
+         if (node.input == ExprInput::x) {
+            // same offsets as RadialField
+            F32 center = F32(dim.x) / 2.f;
+            for (std::size_t i = 0; i < n; ++i) {
+               dest[i] = F32(std::size_t(x_begin) + i) + 0.5f - center;
+            }
+         } else {
+            std::fill(dest, dest + n, y + 0.5f - F32(dim.y) / 2.f);
+         }
+         break;
+
+      case ExprOp::affine: {
+         F32 scale = scalar_b;
+         F32 offset = values_[std::size_t(node.args[2])];
+         for (std::size_t i = 0; i < n; ++i) {
+            dest[i] = a[i] * scale + offset;
+         }
+         break;
+      }
+
+      case ExprOp::add:   binary_op(a, scalar_a, b, scalar_b, dest, n, [](F32 l, F32 r) { return l + r; }); break;
+      case ExprOp::sub:   binary_op(a, scalar_a, b, scalar_b, dest, n, [](F32 l, F32 r) { return l - r; }); break;
+      case ExprOp::mul:   binary_op(a, scalar_a, b, scalar_b, dest, n, [](F32 l, F32 r) { return l * r; }); break;
+      case ExprOp::div:   binary_op(a, scalar_a, b, scalar_b, dest, n, [](F32 l, F32 r) { return l / r; }); break;
+      case ExprOp::min:   binary_op(a, scalar_a, b, scalar_b, dest, n, [](F32 l, F32 r) { return std::min(l, r); }); break;
+      case ExprOp::max:   binary_op(a, scalar_a, b, scalar_b, dest, n, [](F32 l, F32 r) { return std::max(l, r); }); break;
+      case ExprOp::pow:   binary_op(a, scalar_a, b, scalar_b, dest, n, [](F32 l, F32 r) { return std::pow(l, r); }); break;
+
+      case ExprOp::atan2:
+         // fast_atan2 wants two rows; dest may alias either input
+         if (!a) {
+            std::fill(dest, dest + n, scalar_a);
+            a = dest;
+         } else if (!b) {
+            std::fill(dest, dest + n, scalar_b);
+            b = dest;
+         }
+         fast_atan2(a, b, dest, n);
+         break;
+
+      case ExprOp::sin:   fast_sin(a, dest, n); break;
+      case ExprOp::cos:   fast_cos(a, dest, n); break;
+      case ExprOp::sqrt:  fast_sqrt(a, dest, n); break;
+      case ExprOp::abs:   unary_op(a, dest, n, [](F32 v) { return std::abs(v); }); break;
+      case ExprOp::floor: unary_op(a, dest, n, [](F32 v) { return std::floor(v); }); break;
+      case ExprOp::fract: unary_op(a, dest, n, [](F32 v) { return v - std::floor(v); }); break;
+      case ExprOp::exp:   unary_op(a, dest, n, [](F32 v) { return std::exp(v); }); break;
+      case ExprOp::log:   unary_op(a, dest, n, [](F32 v) { return std::log(v); }); break;
+
+      default:
+         break;
+   }
+}
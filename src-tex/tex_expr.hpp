@@ -0,0 +1,120 @@
+#pragma once
+#ifndef TEX_EXPR_HPP_
+#define TEX_EXPR_HPP_
+
+#include "tex_radial_field.hpp"
+#include <be/core/glm.hpp>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// x and y are pixel offsets from the image center, matching r and theta
+// from RadialField.  r2 is r * r, read from the distance2 plane.  t is the
+// demo time in seconds.
+enum class ExprInput : be::U8 {
+   x,
+   y,
+   r,
+   r2,
+   theta,
+   t,
+   effect_scale
+};
+
+///////////////////////////////////////////////////////////////////////////////
+enum class ExprOp : be::U8 {
+   constant,
+   input,
+   add,
+   sub,
+   mul,
+   div,
+   affine, // args[0] * args[1] + args[2]
+   min,
+   max,
+   pow,
+   atan2,
+   sin,
+   cos,
+   sqrt,
+   abs,
+   floor,
+   fract,
+   exp,
+   log
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// One to four comma-separated channel expressions, compiled to a tape of
+// row-wide operations.  One expression fills all four channels like the
+// built-in demos, three give RGB with alpha 1, four give RGBA.
+//
+// Supports + - * / ^, parentheses, numbers, pi, the inputs above (t and
+// effect_scale by name) and the functions sin, cos, sqrt, atan2, abs,
+// floor, fract, exp, log, min, max, pow and clamp.
+//
+// Subexpressions are shared, constant subexpressions are folded while
+// parsing, and subexpressions that only depend on t and effect_scale are
+// evaluated once per frame by bind().  Chains of scalar multiplies and adds
+// collapse into one multiply-add per pixel, and division by a per-frame
+// value becomes a multiply.
+class ExprProgram final {
+public:
+   bool compile(const be::S& source, be::S& error);
+
+   bool empty() const { return channels_.empty(); }
+   bool uses(ExprInput input) const;
+   be::U8 radial_planes() const;
+   std::size_t instructions() const { return tape_.size(); }
+
+   // Must be called before run_row() whenever t or effect_scale changes.
+   void bind(be::F32 t, be::F32 effect_scale);
+
+   // radial must have radial_planes() prepared for dim.
+   void run_row(const RadialField& radial, be::ivec2 dim, be::I32 x_begin, be::I32 y, std::size_t n, be::vec4* out) const;
+
+private:
+   enum class Variability : be::U8 {
+      constant,
+      uniform, // constant within a frame
+      varying
+   };
+
+   struct Node {
+      ExprOp op;
+      ExprInput input;
+      Variability variability;
+      be::F32 value;
+      be::I32 args[3];
+   };
+
+   struct Instruction {
+      be::I32 node;
+      be::I32 dest; // register
+   };
+
+   struct Channel {
+      be::I32 node;
+      be::I32 scale;
+      be::I32 offset;
+   };
+
+   class Parser;
+
+   be::I32 constant_(be::F32 value);
+   be::I32 input_(ExprInput input);
+   be::I32 make_(ExprOp op, be::I32 a, be::I32 b = -1, be::I32 c = -1);
+   be::I32 intern_(const Node& node);
+   bool is_constant_(be::I32 node, be::F32 value) const;
+   void build_tape_(const std::vector<be::I32>& outputs);
+   void execute_(const Node& node, const std::vector<const be::F32*>& rows, be::F32* dest, be::ivec2 dim, be::I32 x_begin, be::I32 y, std::size_t n) const;
+
+   std::vector<Node> nodes_;
+   std::vector<be::F32> values_; // per node; valid for non-varying nodes after bind()
+   std::vector<Channel> channels_;
+   std::vector<Instruction> tape_;
+   std::vector<be::I32> row_inputs_; // r, r2 and theta nodes, read in place
+   be::U32 inputs_ = 0; // 1 << ExprInput for each input reachable from a channel
+   be::I32 registers_ = 0;
+};
+
+#endif
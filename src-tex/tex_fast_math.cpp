@@ -0,0 +1,576 @@
+#include "tex_fast_math.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+// MSVC allows AVX2 intrinsics without /arch:AVX2, so both paths are always
+// compiled and chosen at runtime.
+#define TEX_FAST_MATH_SSE41
+#define TEX_FAST_MATH_AVX2
+#define TEX_FAST_MATH_SSE41_TARGET
+#define TEX_FAST_MATH_AVX2_TARGET
+#define TEX_FAST_MATH_KERNEL
+#include <intrin.h>
+#include <immintrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// GCC and Clang compile the Ops for their own target regardless of -m flags.
+// The generic templates have no target, so the kernel entry points are
+// flattened to inline them into code compiled for the right ISA.
+#define TEX_FAST_MATH_SSE41
+#define TEX_FAST_MATH_AVX2
+#define TEX_FAST_MATH_SSE41_TARGET __attribute__((target("sse4.1")))
+#define TEX_FAST_MATH_AVX2_TARGET __attribute__((target("avx2,fma")))
+#define TEX_FAST_MATH_KERNEL __attribute__((flatten))
+#include <immintrin.h>
+#if !defined(__clang__)
+// the templates return __m256 before they are flattened into AVX2 code
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+#endif
+
+using namespace be;
+
+namespace {
+
+constexpr F32 two_over_pi = 0.636619772367581343f;
+constexpr F32 half_pi = 1.57079632679489662f;
+constexpr F32 pi = 3.14159265358979324f;
+
+// pi/2 split so that q * pio2_1 is exact for |x| <= float_reduce_limit
+constexpr F32 pio2_1 = 1.5703125f;
+constexpr F32 pio2_2 = 4.837512969970703125e-4f;
+constexpr F32 pio2_3 = 7.54978995489188216e-8f;
+constexpr F32 float_reduce_limit = 8192.f;
+
+// pi/2 in 33 bit parts (fdlibm), reduced in double up to wide_reduce_limit;
+// larger arguments fall back to libm, which does a full Payne-Hanek.
+constexpr F64 two_over_pi_d = 6.36619772367581382433e-01;
+constexpr F64 pio2_1_d = 1.57079632673412561417e+00;
+constexpr F64 pio2_2_d = 6.07710050630396597660e-11;
+constexpr F64 pio2_3_d = 2.02226624871116645580e-21;
+constexpr F32 wide_reduce_limit = 67108864.f; // 2^26
+
+// minimax polynomials on [-pi/4, pi/4] (Cephes sinf/cosf)
+constexpr F32 sin_c1 = -1.6666654611e-1f;
+constexpr F32 sin_c2 = 8.3321608736e-3f;
+constexpr F32 sin_c3 = -1.9515295891e-4f;
+constexpr F32 cos_c1 = 4.166664568298827e-2f;
+constexpr F32 cos_c2 = -1.388731625493765e-3f;
+constexpr F32 cos_c3 = 2.443315711809948e-5f;
+
+// minimax polynomial for atan(t) on [0, 1]
+constexpr F32 atan_c1 = 0.99997726f;
+constexpr F32 atan_c3 = -0.33262347f;
+constexpr F32 atan_c5 = 0.19354346f;
+constexpr F32 atan_c7 = -0.11643287f;
+constexpr F32 atan_c9 = 0.05265332f;
+constexpr F32 atan_c11 = -0.01172120f;
+
+///////////////////////////////////////////////////////////////////////////////
+struct ScalarOps {
+   using V = F32;
+   using M = bool;
+   static constexpr std::size_t width = 1;
+
+   static V load(const F32* p) { return *p; }
+   static void store(F32* p, V v) { *p = v; }
+   static V set(F32 v) { return v; }
+   static V add(V a, V b) { return a + b; }
+   static V sub(V a, V b) { return a - b; }
+   static V mul(V a, V b) { return a * b; }
+   static V div(V a, V b) { return a / b; }
+   static V sqrt(V a) { return std::sqrt(a); }
+   static V abs(V a) { return std::abs(a); }
+   static V min(V a, V b) { return a < b ? a : b; }
+   static V max(V a, V b) { return a < b ? b : a; }
+   static V floor(V a) { return std::floor(a); }
+   static V round(V a) { return std::nearbyint(a); }
+   static M lt(V a, V b) { return a < b; }
+   static V select(M m, V a, V b) { return m ? a : b; }
+   static bool any(M m) { return m; }
+
+   // q is the quadrant count mod 4
+   static void reduce_wide(V x, V& q, V& r) {
+      F64 qd = std::nearbyint(F64(x) * two_over_pi_d);
+      r = F32(((F64(x) - qd * pio2_1_d) - qd * pio2_2_d) - qd * pio2_3_d);
+      q = F32(qd - 4.0 * std::floor(qd * 0.25));
+   }
+};
+
+#ifdef TEX_FAST_MATH_SSE41
+#define TARGET TEX_FAST_MATH_SSE41_TARGET
+///////////////////////////////////////////////////////////////////////////////
+struct Sse41Ops {
+   using V = __m128;
+   using M = __m128;
+   static constexpr std::size_t width = 4;
+
+   TARGET static V load(const F32* p) { return _mm_loadu_ps(p); }
+   TARGET static void store(F32* p, V v) { _mm_storeu_ps(p, v); }
+   TARGET static V set(F32 v) { return _mm_set1_ps(v); }
+   TARGET static V add(V a, V b) { return _mm_add_ps(a, b); }
+   TARGET static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+   TARGET static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+   TARGET static V div(V a, V b) { return _mm_div_ps(a, b); }
+   TARGET static V sqrt(V a) { return _mm_sqrt_ps(a); }
+   TARGET static V abs(V a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+   TARGET static V min(V a, V b) { return _mm_min_ps(a, b); }
+   TARGET static V max(V a, V b) { return _mm_max_ps(a, b); }
+   TARGET static V floor(V a) { return _mm_floor_ps(a); }
+   TARGET static V round(V a) { return _mm_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+   TARGET static M lt(V a, V b) { return _mm_cmplt_ps(a, b); }
+   TARGET static V select(M m, V a, V b) { return _mm_blendv_ps(b, a, m); }
+   TARGET static bool any(M m) { return _mm_movemask_ps(m) != 0; }
+
+   TARGET static void reduce_wide(__m128d x, __m128d& q, __m128d& r) {
+      q = _mm_round_pd(_mm_mul_pd(x, _mm_set1_pd(two_over_pi_d)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+      r = _mm_sub_pd(x, _mm_mul_pd(q, _mm_set1_pd(pio2_1_d)));
+      r = _mm_sub_pd(r, _mm_mul_pd(q, _mm_set1_pd(pio2_2_d)));
+      r = _mm_sub_pd(r, _mm_mul_pd(q, _mm_set1_pd(pio2_3_d)));
+      q = _mm_sub_pd(q, _mm_mul_pd(_mm_set1_pd(4.0), _mm_floor_pd(_mm_mul_pd(q, _mm_set1_pd(0.25)))));
+   }
+
+   TARGET static void reduce_wide(V x, V& q, V& r) {
+      __m128d q0, q1, r0, r1;
+      reduce_wide(_mm_cvtps_pd(x), q0, r0);
+      reduce_wide(_mm_cvtps_pd(_mm_movehl_ps(x, x)), q1, r1);
+      q = _mm_movelh_ps(_mm_cvtpd_ps(q0), _mm_cvtpd_ps(q1));
+      r = _mm_movelh_ps(_mm_cvtpd_ps(r0), _mm_cvtpd_ps(r1));
+   }
+};
+#undef TARGET
+#endif
+
+#ifdef TEX_FAST_MATH_AVX2
+#define TARGET TEX_FAST_MATH_AVX2_TARGET
+///////////////////////////////////////////////////////////////////////////////
+struct Avx2Ops {
+   using V = __m256;
+   using M = __m256;
+   static constexpr std::size_t width = 8;
+
+   TARGET static V load(const F32* p) { return _mm256_loadu_ps(p); }
+   TARGET static void store(F32* p, V v) { _mm256_storeu_ps(p, v); }
+   TARGET static V set(F32 v) { return _mm256_set1_ps(v); }
+   TARGET static V add(V a, V b) { return _mm256_add_ps(a, b); }
+   TARGET static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+   TARGET static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+   TARGET static V div(V a, V b) { return _mm256_div_ps(a, b); }
+   TARGET static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+   TARGET static V abs(V a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+   TARGET static V min(V a, V b) { return _mm256_min_ps(a, b); }
+   TARGET static V max(V a, V b) { return _mm256_max_ps(a, b); }
+   TARGET static V floor(V a) { return _mm256_floor_ps(a); }
+   TARGET static V round(V a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+   TARGET static M lt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+   TARGET static V select(M m, V a, V b) { return _mm256_blendv_ps(b, a, m); }
+   TARGET static bool any(M m) { return _mm256_movemask_ps(m) != 0; }
+
+   TARGET static void reduce_wide(__m256d x, __m256d& q, __m256d& r) {
+      q = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(two_over_pi_d)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+      r = _mm256_sub_pd(x, _mm256_mul_pd(q, _mm256_set1_pd(pio2_1_d)));
+      r = _mm256_sub_pd(r, _mm256_mul_pd(q, _mm256_set1_pd(pio2_2_d)));
+      r = _mm256_sub_pd(r, _mm256_mul_pd(q, _mm256_set1_pd(pio2_3_d)));
+      q = _mm256_sub_pd(q, _mm256_mul_pd(_mm256_set1_pd(4.0), _mm256_floor_pd(_mm256_mul_pd(q, _mm256_set1_pd(0.25)))));
+   }
+
+   TARGET static void reduce_wide(V x, V& q, V& r) {
+      __m256d q0, q1, r0, r1;
+      reduce_wide(_mm256_cvtps_pd(_mm256_castps256_ps128(x)), q0, r0);
+      reduce_wide(_mm256_cvtps_pd(_mm256_extractf128_ps(x, 1)), q1, r1);
+      q = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(q0)), _mm256_cvtpd_ps(q1), 1);
+      r = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(r0)), _mm256_cvtpd_ps(r1), 1);
+   }
+};
+#undef TARGET
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename O>
+struct Algorithms {
+   using V = typename O::V;
+
+   // sin(x + offset * pi/2)
+   static V sin_quadrant(const V& x, F32 offset) {
+      V ax = O::abs(x);
+      V q, r;
+      if (O::any(O::lt(O::set(float_reduce_limit), ax))) {
+         O::reduce_wide(x, q, r);
+      } else {
+         q = O::round(O::mul(x, O::set(two_over_pi)));
+         r = O::sub(x, O::mul(q, O::set(pio2_1)));
+         r = O::sub(r, O::mul(q, O::set(pio2_2)));
+         r = O::sub(r, O::mul(q, O::set(pio2_3)));
+      }
+
+      q = O::add(q, O::set(offset));
+      V quadrant = O::sub(q, O::mul(O::set(4.f), O::floor(O::mul(q, O::set(0.25f)))));
+      V odd = O::sub(quadrant, O::mul(O::set(2.f), O::floor(O::mul(quadrant, O::set(0.5f)))));
+
+      V r2 = O::mul(r, r);
+      V s = O::add(O::set(sin_c2), O::mul(r2, O::set(sin_c3)));
+      s = O::add(O::set(sin_c1), O::mul(r2, s));
+      s = O::add(r, O::mul(O::mul(r, r2), s));
+
+      V c = O::add(O::set(cos_c2), O::mul(r2, O::set(cos_c3)));
+      c = O::add(O::set(cos_c1), O::mul(r2, c));
+      c = O::add(O::sub(O::set(1.f), O::mul(O::set(0.5f), r2)), O::mul(O::mul(r2, r2), c));
+
+      V result = O::select(O::lt(O::set(0.5f), odd), c, s);
+      result = O::select(O::lt(O::set(1.5f), quadrant), O::sub(O::set(0.f), result), result);
+      if (O::any(O::lt(O::set(wide_reduce_limit), ax))) {
+         result = libm_lanes(x, result, offset);
+      }
+      return result;
+   }
+
+   static V libm_lanes(const V& x, const V& result, F32 offset) {
+      F32 in[O::width];
+      F32 out[O::width];
+      O::store(in, x);
+      O::store(out, result);
+      for (std::size_t i = 0; i < O::width; ++i) {
+         if (std::abs(in[i]) > wide_reduce_limit) {
+            out[i] = F32(offset == 0.f ? std::sin(F64(in[i])) : std::cos(F64(in[i])));
+         }
+      }
+      return O::load(out);
+   }
+
+   static V atan2(const V& y, const V& x) {
+      V ax = O::abs(x);
+      V ay = O::abs(y);
+      V mn = O::min(ax, ay);
+      V mx = O::max(ax, ay);
+      V t = O::select(O::lt(O::set(0.f), mx), O::div(mn, mx), O::set(0.f));
+
+      V t2 = O::mul(t, t);
+      V p = O::add(O::set(atan_c9), O::mul(t2, O::set(atan_c11)));
+      p = O::add(O::set(atan_c7), O::mul(t2, p));
+      p = O::add(O::set(atan_c5), O::mul(t2, p));
+      p = O::add(O::set(atan_c3), O::mul(t2, p));
+      p = O::add(O::set(atan_c1), O::mul(t2, p));
+      p = O::mul(t, p);
+
+      p = O::select(O::lt(ax, ay), O::sub(O::set(half_pi), p), p);
+      p = O::select(O::lt(x, O::set(0.f)), O::sub(O::set(pi), p), p);
+      return O::select(O::lt(y, O::set(0.f)), O::sub(O::set(0.f), p), p);
+   }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename O>
+void sin_kernel(const F32* x, F32* out, std::size_t n) {
+   std::size_t i = 0;
+   for (; i + O::width <= n; i += O::width) {
+      O::store(out + i, Algorithms<O>::sin_quadrant(O::load(x + i), 0.f));
+   }
+   for (; i < n; ++i) {
+      out[i] = Algorithms<ScalarOps>::sin_quadrant(x[i], 0.f);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename O>
+void cos_kernel(const F32* x, F32* out, std::size_t n) {
+   std::size_t i = 0;
+   for (; i + O::width <= n; i += O::width) {
+      O::store(out + i, Algorithms<O>::sin_quadrant(O::load(x + i), 1.f));
+   }
+   for (; i < n; ++i) {
+      out[i] = Algorithms<ScalarOps>::sin_quadrant(x[i], 1.f);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename O>
+void atan2_kernel(const F32* y, const F32* x, F32* out, std::size_t n) {
+   std::size_t i = 0;
+   for (; i + O::width <= n; i += O::width) {
+      O::store(out + i, Algorithms<O>::atan2(O::load(y + i), O::load(x + i)));
+   }
+   for (; i < n; ++i) {
+      out[i] = Algorithms<ScalarOps>::atan2(y[i], x[i]);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename O>
+void sqrt_kernel(const F32* x, F32* out, std::size_t n) {
+   std::size_t i = 0;
+   for (; i + O::width <= n; i += O::width) {
+      O::store(out + i, O::sqrt(O::load(x + i)));
+   }
+   for (; i < n; ++i) {
+      out[i] = std::sqrt(x[i]);
+   }
+}
+
+#ifdef TEX_FAST_MATH_SSE41
+///////////////////////////////////////////////////////////////////////////////
+TEX_FAST_MATH_SSE41_TARGET TEX_FAST_MATH_KERNEL
+void sin_sse41(const F32* x, F32* out, std::size_t n) {
+   sin_kernel<Sse41Ops>(x, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEX_FAST_MATH_SSE41_TARGET TEX_FAST_MATH_KERNEL
+void cos_sse41(const F32* x, F32* out, std::size_t n) {
+   cos_kernel<Sse41Ops>(x, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEX_FAST_MATH_SSE41_TARGET TEX_FAST_MATH_KERNEL
+void atan2_sse41(const F32* y, const F32* x, F32* out, std::size_t n) {
+   atan2_kernel<Sse41Ops>(y, x, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEX_FAST_MATH_SSE41_TARGET TEX_FAST_MATH_KERNEL
+void sqrt_sse41(const F32* x, F32* out, std::size_t n) {
+   sqrt_kernel<Sse41Ops>(x, out, n);
+}
+#endif
+
+#ifdef TEX_FAST_MATH_AVX2
+///////////////////////////////////////////////////////////////////////////////
+TEX_FAST_MATH_AVX2_TARGET TEX_FAST_MATH_KERNEL
+void sin_avx2(const F32* x, F32* out, std::size_t n) {
+   sin_kernel<Avx2Ops>(x, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEX_FAST_MATH_AVX2_TARGET TEX_FAST_MATH_KERNEL
+void cos_avx2(const F32* x, F32* out, std::size_t n) {
+   cos_kernel<Avx2Ops>(x, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEX_FAST_MATH_AVX2_TARGET TEX_FAST_MATH_KERNEL
+void atan2_avx2(const F32* y, const F32* x, F32* out, std::size_t n) {
+   atan2_kernel<Avx2Ops>(y, x, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEX_FAST_MATH_AVX2_TARGET TEX_FAST_MATH_KERNEL
+void sqrt_avx2(const F32* x, F32* out, std::size_t n) {
+   sqrt_kernel<Avx2Ops>(x, out, n);
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// One value at a time the polynomial (and especially the wide reduction) is
+// slower than sinf/cosf, so the scalar level calls libm for these.
+void sin_libm(const F32* x, F32* out, std::size_t n) {
+   for (std::size_t i = 0; i < n; ++i) {
+      out[i] = std::sin(x[i]);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void cos_libm(const F32* x, F32* out, std::size_t n) {
+   for (std::size_t i = 0; i < n; ++i) {
+      out[i] = std::cos(x[i]);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+struct KernelTable {
+   void(*sin)(const F32*, F32*, std::size_t);
+   void(*cos)(const F32*, F32*, std::size_t);
+   void(*atan2)(const F32*, const F32*, F32*, std::size_t);
+   void(*sqrt)(const F32*, F32*, std::size_t);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+const KernelTable& kernel_table(SimdLevel level) {
+   static const KernelTable scalar { sin_libm, cos_libm, atan2_kernel<ScalarOps>, sqrt_kernel<ScalarOps> };
+#ifdef TEX_FAST_MATH_SSE41
+   static const KernelTable sse41 { sin_sse41, cos_sse41, atan2_sse41, sqrt_sse41 };
+#endif
+#ifdef TEX_FAST_MATH_AVX2
+   static const KernelTable avx2 { sin_avx2, cos_avx2, atan2_avx2, sqrt_avx2 };
+#endif
+
+   switch (level) {
+#ifdef TEX_FAST_MATH_AVX2
+      case SimdLevel::avx2: return avx2;
+#endif
+#ifdef TEX_FAST_MATH_SSE41
+      case SimdLevel::sse41: return sse41;
+#endif
+      default: return scalar;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The AVX2 level also needs FMA (fast math) and F16C (float packing); every
+// AVX2 CPU so far has both.
+SimdLevel detect_simd_level() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+   int info[4];
+   __cpuid(info, 0);
+   int max_leaf = info[0];
+   __cpuid(info, 1);
+   bool sse41 = (info[2] & (1 << 19)) != 0;
+   bool fma = (info[2] & (1 << 12)) != 0;
+   bool osxsave = (info[2] & (1 << 27)) != 0;
+   bool avx = (info[2] & (1 << 28)) != 0;
+   bool f16c = (info[2] & (1 << 29)) != 0;
+   if (max_leaf >= 7 && osxsave && avx && fma && f16c && (_xgetbv(0) & 6) == 6) {
+      __cpuidex(info, 7, 0);
+      if ((info[1] & (1 << 5)) != 0) {
+         return SimdLevel::avx2;
+      }
+   }
+   if (sse41) {
+      return SimdLevel::sse41;
+   }
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c")) {
+      return SimdLevel::avx2;
+   }
+   if (__builtin_cpu_supports("sse4.1")) {
+      return SimdLevel::sse41;
+   }
+#endif
+   return SimdLevel::scalar;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::atomic<SimdLevel>& current_level() {
+   static std::atomic<SimdLevel> level(max_simd_level());
+   return level;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<F32> make_check_values(std::size_t samples, F32 lo, F32 hi, U32 seed) {
+   std::vector<F32> values(samples);
+   U32 state = seed;
+   for (F32& v : values) {
+      state = state * 1664525u + 1013904223u;
+      v = lo + (hi - lo) * (F32(state >> 8) * (1.f / 16777216.f));
+   }
+   return values;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename F>
+F64 measure_mvalues_per_second(std::size_t samples, F func) {
+   using clock = std::chrono::steady_clock;
+   const int repeats = 8;
+   auto start = clock::now();
+   for (int i = 0; i < repeats; ++i) {
+      func();
+   }
+   F64 seconds = std::chrono::duration<F64>(clock::now() - start).count();
+   return seconds > 0 ? F64(samples) * repeats / seconds / 1000000.0 : 0.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+F64 max_abs_error(const std::vector<F32>& a, const std::vector<F32>& b) {
+   F64 err = 0;
+   for (std::size_t i = 0; i < a.size(); ++i) {
+      err = std::max(err, std::abs(F64(a[i]) - F64(b[i])));
+   }
+   return err;
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+SimdLevel max_simd_level() {
+   static const SimdLevel level = detect_simd_level();
+   return level;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+SimdLevel simd_level() {
+   return current_level().load(std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void set_simd_level(SimdLevel level) {
+   current_level().store(std::min(level, max_simd_level()), std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const char* simd_level_name(SimdLevel level) {
+   switch (level) {
+      case SimdLevel::sse41: return "SSE4.1";
+      case SimdLevel::avx2:  return "AVX2";
+      default:               return "scalar";
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void fast_sin(const F32* x, F32* out, std::size_t n) {
+   kernel_table(simd_level()).sin(x, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void fast_cos(const F32* x, F32* out, std::size_t n) {
+   kernel_table(simd_level()).cos(x, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void fast_atan2(const F32* y, const F32* x, F32* out, std::size_t n) {
+   kernel_table(simd_level()).atan2(y, x, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void fast_sqrt(const F32* x, F32* out, std::size_t n) {
+   kernel_table(simd_level()).sqrt(x, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<FastMathCheck> check_fast_math(std::size_t samples) {
+   std::vector<FastMathCheck> results;
+
+   std::vector<F32> angles = make_check_values(samples, -8192.f, 8192.f, 1);
+   // cosdst2 passes squared distances: up to 2^27 for a 16k texture
+   std::vector<F32> wide_angles = make_check_values(samples, -134217728.f, 134217728.f, 5);
+   std::vector<F32> ys = make_check_values(samples, -2048.f, 2048.f, 2);
+   std::vector<F32> xs = make_check_values(samples, -2048.f, 2048.f, 3);
+   std::vector<F32> squares = make_check_values(samples, 0.f, 16777216.f, 4);
+   std::vector<F32> expected(samples);
+   std::vector<F32> actual(samples);
+
+   auto check = [&](const char* kernel, auto reference, auto approx) {
+      F64 reference_speed = measure_mvalues_per_second(samples, [&]() { reference(expected.data()); });
+      for (int level = int(SimdLevel::scalar); level <= int(max_simd_level()); ++level) {
+         const KernelTable& table = kernel_table(SimdLevel(level));
+         F64 speed = measure_mvalues_per_second(samples, [&]() { approx(table, actual.data()); });
+         results.push_back(FastMathCheck { kernel, SimdLevel(level), max_abs_error(expected, actual), speed, reference_speed });
+      }
+   };
+
+   check("sin",
+      [&](F32* out) { for (std::size_t i = 0; i < samples; ++i) out[i] = sinf(angles[i]); },
+      [&](const KernelTable& t, F32* out) { t.sin(angles.data(), out, samples); });
+
+   check("cos",
+      [&](F32* out) { for (std::size_t i = 0; i < samples; ++i) out[i] = cosf(angles[i]); },
+      [&](const KernelTable& t, F32* out) { t.cos(angles.data(), out, samples); });
+
+   check("sin wide",
+      [&](F32* out) { for (std::size_t i = 0; i < samples; ++i) out[i] = sinf(wide_angles[i]); },
+      [&](const KernelTable& t, F32* out) { t.sin(wide_angles.data(), out, samples); });
+
+   check("cos wide",
+      [&](F32* out) { for (std::size_t i = 0; i < samples; ++i) out[i] = cosf(wide_angles[i]); },
+      [&](const KernelTable& t, F32* out) { t.cos(wide_angles.data(), out, samples); });
+
+   check("atan2",
+      [&](F32* out) { for (std::size_t i = 0; i < samples; ++i) out[i] = atan2f(ys[i], xs[i]); },
+      [&](const KernelTable& t, F32* out) { t.atan2(ys.data(), xs.data(), out, samples); });
+
+   check("sqrt",
+      [&](F32* out) { for (std::size_t i = 0; i < samples; ++i) out[i] = sqrtf(squares[i]); },
+      [&](const KernelTable& t, F32* out) { t.sqrt(squares.data(), out, samples); });
+
+   return results;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#ifndef TEX_FAST_MATH_HPP_
+#define TEX_FAST_MATH_HPP_
+
+#include <be/core/be.hpp>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+enum class SimdLevel {
+   scalar,
+   sse41,
+   avx2
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// The highest level supported by the CPU; AVX2 also requires FMA and F16C.
+// Kernels use this level unless set_simd_level() has been called with a
+// lower one.
+SimdLevel max_simd_level();
+SimdLevel simd_level();
+void set_simd_level(SimdLevel level);
+const char* simd_level_name(SimdLevel level);
+
+///////////////////////////////////////////////////////////////////////////////
+// Bulk approximations evaluated 4 (SSE4.1) or 8 (AVX2) values at a time; the
+// scalar level calls sinf/cosf directly.  Max absolute error for sin/cos is
+// about 1.2e-7 at any argument: |x| above 8192 is reduced in double, and
+// above 2^26 those lanes call libm.  atan2 is
+// within 2e-6 radians and sqrt is exact.  out may alias an input.
+void fast_sin(const be::F32* x, be::F32* out, std::size_t n);
+void fast_cos(const be::F32* x, be::F32* out, std::size_t n);
+void fast_atan2(const be::F32* y, const be::F32* x, be::F32* out, std::size_t n);
+void fast_sqrt(const be::F32* x, be::F32* out, std::size_t n);
+
+///////////////////////////////////////////////////////////////////////////////
+struct FastMathCheck {
+   const char* kernel;
+   SimdLevel level;
+   be::F64 max_abs_error;
+   be::F64 mvalues_per_second;
+   be::F64 reference_mvalues_per_second;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Compares every kernel at every available level against the libm calls the
+// generators used before (sinf, cosf, atan2f, sqrtf) over the argument
+// ranges the demos produce.
+std::vector<FastMathCheck> check_fast_math(std::size_t samples);
+
+#endif
@@ -0,0 +1,849 @@
+#include "tex_float_pack.hpp"
+#include <be/gfx/tex/make_texture.hpp>
+#include <be/gfx/tex/pixel_access_norm.hpp>
+#include <be/gfx/bgl.hpp>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define TEX_FLOAT_PACK_SSE41
+#define TEX_FLOAT_PACK_AVX2
+#define TEX_FLOAT_PACK_SSE41_TARGET
+#define TEX_FLOAT_PACK_AVX2_TARGET
+#define TEX_FLOAT_PACK_KERNEL
+#include <immintrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// Same scheme as tex_fast_math.cpp: targeted Ops, flattened entry points,
+// and the level picked at runtime.  The AVX2 level implies F16C.
+#define TEX_FLOAT_PACK_SSE41
+#define TEX_FLOAT_PACK_AVX2
+#define TEX_FLOAT_PACK_SSE41_TARGET __attribute__((target("sse4.1")))
+#define TEX_FLOAT_PACK_AVX2_TARGET __attribute__((target("avx2,f16c")))
+#define TEX_FLOAT_PACK_KERNEL __attribute__((flatten))
+#include <immintrin.h>
+#if !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+#endif
+
+using namespace be;
+using namespace be::gfx::gl;
+using namespace be::gfx::tex;
+
+namespace {
+
+// RGB9_E5 lanes whose largest channel is this close below a power of two
+// go through glm, since floor(log2(x)) there depends on libm rounding.
+constexpr U32 rgb9e5_near_power_mantissa = 0x7fff00;
+
+///////////////////////////////////////////////////////////////////////////////
+U32 pack_r11g11b10f_value(const vec4& v) {
+   return glm::packF2x11_1x10(vec3(v));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+vec4 unpack_r11g11b10f_value(U32 v) {
+   return vec4(glm::unpackF2x11_1x10(v), 1.f);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U32 pack_rgb9e5_value(const vec4& v) {
+   return glm::packF3x9_E1x5(vec3(v));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+vec4 unpack_rgb9e5_value(U32 v) {
+   return vec4(glm::unpackF3x9_E1x5(v), 1.f);
+}
+
+#ifdef TEX_FLOAT_PACK_SSE41
+#define TARGET TEX_FLOAT_PACK_SSE41_TARGET
+///////////////////////////////////////////////////////////////////////////////
+struct Sse41Ops {
+   using I = __m128i;
+   using F = __m128;
+   static constexpr std::size_t width = 4;
+
+   TARGET static I set(I32 v) { return _mm_set1_epi32(v); }
+   TARGET static F setf(F32 v) { return _mm_set1_ps(v); }
+   TARGET static I bits(F v) { return _mm_castps_si128(v); }
+   TARGET static F floats(I v) { return _mm_castsi128_ps(v); }
+   TARGET static I and_(I a, I b) { return _mm_and_si128(a, b); }
+   TARGET static I or_(I a, I b) { return _mm_or_si128(a, b); }
+   TARGET static I add(I a, I b) { return _mm_add_epi32(a, b); }
+   TARGET static I sub(I a, I b) { return _mm_sub_epi32(a, b); }
+   template <int N> TARGET static I srli(I a) { return _mm_srli_epi32(a, N); }
+   template <int N> TARGET static I slli(I a) { return _mm_slli_epi32(a, N); }
+   TARGET static I eq(I a, I b) { return _mm_cmpeq_epi32(a, b); }
+   TARGET static I gt(I a, I b) { return _mm_cmpgt_epi32(a, b); }
+   TARGET static I max(I a, I b) { return _mm_max_epi32(a, b); }
+   TARGET static I select(I m, I a, I b) { return _mm_blendv_epi8(b, a, m); }
+   TARGET static F addf(F a, F b) { return _mm_add_ps(a, b); }
+   TARGET static F mulf(F a, F b) { return _mm_mul_ps(a, b); }
+   TARGET static F maxf(F a, F b) { return _mm_max_ps(a, b); }
+   TARGET static F minf(F a, F b) { return _mm_min_ps(a, b); }
+   TARGET static F floorf(F a) { return _mm_floor_ps(a); }
+   TARGET static I unordered(F a, F b) { return _mm_castps_si128(_mm_cmpunord_ps(a, b)); }
+   TARGET static I trunc(F a) { return _mm_cvttps_epi32(a); }
+   TARGET static F convert(I a) { return _mm_cvtepi32_ps(a); }
+   TARGET static U32 mask(I m) { return U32(_mm_movemask_ps(_mm_castsi128_ps(m))); }
+
+   TARGET static F loadf(const F32* p) { return _mm_loadu_ps(p); }
+   TARGET static void storef(F32* p, F v) { _mm_storeu_ps(p, v); }
+   TARGET static I load32(const U32* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+   TARGET static void store32(U32* p, I v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+   TARGET static I load16(const U16* p) { return _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))); }
+   TARGET static void store16(U16* p, I v) { _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packus_epi32(v, v)); }
+
+   TARGET static void load_pixels(const vec4* p, F& r, F& g, F& b, F& a) {
+      const F32* f = glm::value_ptr(p[0]);
+      r = _mm_loadu_ps(f);
+      g = _mm_loadu_ps(f + 4);
+      b = _mm_loadu_ps(f + 8);
+      a = _mm_loadu_ps(f + 12);
+      _MM_TRANSPOSE4_PS(r, g, b, a);
+   }
+
+   TARGET static void store_pixels(vec4* p, F r, F g, F b, F a) {
+      _MM_TRANSPOSE4_PS(r, g, b, a);
+      F32* f = glm::value_ptr(p[0]);
+      _mm_storeu_ps(f, r);
+      _mm_storeu_ps(f + 4, g);
+      _mm_storeu_ps(f + 8, b);
+      _mm_storeu_ps(f + 12, a);
+   }
+
+   TARGET static F half_to_float(I h);
+};
+#undef TARGET
+#endif
+
+#ifdef TEX_FLOAT_PACK_AVX2
+#define TARGET TEX_FLOAT_PACK_AVX2_TARGET
+///////////////////////////////////////////////////////////////////////////////
+struct Avx2Ops {
+   using I = __m256i;
+   using F = __m256;
+   static constexpr std::size_t width = 8;
+
+   TARGET static I set(I32 v) { return _mm256_set1_epi32(v); }
+   TARGET static F setf(F32 v) { return _mm256_set1_ps(v); }
+   TARGET static I bits(F v) { return _mm256_castps_si256(v); }
+   TARGET static F floats(I v) { return _mm256_castsi256_ps(v); }
+   TARGET static I and_(I a, I b) { return _mm256_and_si256(a, b); }
+   TARGET static I or_(I a, I b) { return _mm256_or_si256(a, b); }
+   TARGET static I add(I a, I b) { return _mm256_add_epi32(a, b); }
+   TARGET static I sub(I a, I b) { return _mm256_sub_epi32(a, b); }
+   template <int N> TARGET static I srli(I a) { return _mm256_srli_epi32(a, N); }
+   template <int N> TARGET static I slli(I a) { return _mm256_slli_epi32(a, N); }
+   TARGET static I eq(I a, I b) { return _mm256_cmpeq_epi32(a, b); }
+   TARGET static I gt(I a, I b) { return _mm256_cmpgt_epi32(a, b); }
+   TARGET static I max(I a, I b) { return _mm256_max_epi32(a, b); }
+   TARGET static I select(I m, I a, I b) { return _mm256_blendv_epi8(b, a, m); }
+   TARGET static F addf(F a, F b) { return _mm256_add_ps(a, b); }
+   TARGET static F mulf(F a, F b) { return _mm256_mul_ps(a, b); }
+   TARGET static F maxf(F a, F b) { return _mm256_max_ps(a, b); }
+   TARGET static F minf(F a, F b) { return _mm256_min_ps(a, b); }
+   TARGET static F floorf(F a) { return _mm256_floor_ps(a); }
+   TARGET static I unordered(F a, F b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_UNORD_Q)); }
+   TARGET static I trunc(F a) { return _mm256_cvttps_epi32(a); }
+   TARGET static F convert(I a) { return _mm256_cvtepi32_ps(a); }
+   TARGET static U32 mask(I m) { return U32(_mm256_movemask_ps(_mm256_castsi256_ps(m))); }
+
+   TARGET static F loadf(const F32* p) { return _mm256_loadu_ps(p); }
+   TARGET static void storef(F32* p, F v) { _mm256_storeu_ps(p, v); }
+   TARGET static I load32(const U32* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+   TARGET static void store32(U32* p, I v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+   TARGET static I load16(const U16* p) { return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))); }
+   TARGET static void store16(U16* p, I v) {
+      // packus works within 128-bit lanes; gather the two useful quarters
+      I packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), _MM_SHUFFLE(3, 1, 2, 0));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(packed));
+   }
+
+   TARGET static void load_pixels(const vec4* p, F& r, F& g, F& b, F& a) {
+      const F32* f = glm::value_ptr(p[0]);
+      F p01 = _mm256_loadu_ps(f);
+      F p23 = _mm256_loadu_ps(f + 8);
+      F p45 = _mm256_loadu_ps(f + 16);
+      F p67 = _mm256_loadu_ps(f + 24);
+      // pixels i and i + 4 share a register, then transpose each half
+      F p04 = _mm256_permute2f128_ps(p01, p45, 0x20);
+      F p15 = _mm256_permute2f128_ps(p01, p45, 0x31);
+      F p26 = _mm256_permute2f128_ps(p23, p67, 0x20);
+      F p37 = _mm256_permute2f128_ps(p23, p67, 0x31);
+      F t0 = _mm256_unpacklo_ps(p04, p15);
+      F t1 = _mm256_unpackhi_ps(p04, p15);
+      F t2 = _mm256_unpacklo_ps(p26, p37);
+      F t3 = _mm256_unpackhi_ps(p26, p37);
+      r = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+      g = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+      b = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+      a = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+   }
+
+   TARGET static void store_pixels(vec4* p, F r, F g, F b, F a) {
+      F t0 = _mm256_unpacklo_ps(r, g);
+      F t1 = _mm256_unpackhi_ps(r, g);
+      F t2 = _mm256_unpacklo_ps(b, a);
+      F t3 = _mm256_unpackhi_ps(b, a);
+      F p04 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+      F p15 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+      F p26 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+      F p37 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+      F32* f = glm::value_ptr(p[0]);
+      _mm256_storeu_ps(f, _mm256_permute2f128_ps(p04, p15, 0x20));
+      _mm256_storeu_ps(f + 8, _mm256_permute2f128_ps(p26, p37, 0x20));
+      _mm256_storeu_ps(f + 16, _mm256_permute2f128_ps(p04, p15, 0x31));
+      _mm256_storeu_ps(f + 24, _mm256_permute2f128_ps(p26, p37, 0x31));
+   }
+
+   TARGET static F half_to_float(I h);
+};
+#undef TARGET
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// glm::detail::toFloat16: round half up, flush below 2^-25, keep NaN
+// payload bits and set the low bit if they would all be lost.
+template <typename Ops>
+typename Ops::I half_bits(const typename Ops::F& x) {
+   using I = typename Ops::I;
+   const I zero = Ops::set(0);
+   I i = Ops::bits(x);
+   I s = Ops::and_(Ops::template srli<16>(i), Ops::set(0x8000));
+   I e = Ops::sub(Ops::and_(Ops::template srli<23>(i), Ops::set(0xff)), Ops::set(112));
+   I m = Ops::and_(i, Ops::set(0x7fffff));
+
+   I rounded = Ops::add(m, Ops::template slli<1>(Ops::and_(m, Ops::set(0x1000))));
+   I en = Ops::add(e, Ops::template srli<23>(rounded));
+   I normal = Ops::or_(Ops::template slli<10>(en), Ops::template srli<13>(Ops::and_(rounded, Ops::set(0x7fffff))));
+   normal = Ops::select(Ops::gt(en, Ops::set(30)), Ops::set(0x7c00), normal);
+
+   // glm shifts the full mantissa right by 1 - e, then rounds half up on
+   // the shifted bits.  Scaling by 2^(e - 1) and truncating is that shift.
+   I shift_scale = Ops::template slli<23>(Ops::add(e, Ops::set(126)));
+   I shifted = Ops::trunc(Ops::mulf(Ops::convert(Ops::or_(m, Ops::set(0x800000))), Ops::floats(shift_scale)));
+   I subnormal = Ops::template srli<13>(Ops::add(shifted, Ops::template slli<1>(Ops::and_(shifted, Ops::set(0x1000)))));
+   subnormal = Ops::select(Ops::gt(Ops::set(-10), e), zero, subnormal);
+
+   I payload = Ops::template srli<13>(m);
+   I nan = Ops::or_(Ops::set(0x7c00), Ops::or_(payload, Ops::and_(Ops::eq(payload, zero), Ops::set(1))));
+   I special = Ops::select(Ops::eq(m, zero), Ops::set(0x7c00), nan);
+
+   I result = Ops::select(Ops::gt(e, zero), normal, subnormal);
+   result = Ops::select(Ops::eq(e, Ops::set(143)), special, result);
+   return Ops::or_(result, s);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// glm::detail::toFloat32, which is exact.
+template <typename Ops>
+typename Ops::F half_value(const typename Ops::I& h) {
+   using I = typename Ops::I;
+   const I zero = Ops::set(0);
+   I s = Ops::template slli<16>(Ops::and_(h, Ops::set(0x8000)));
+   I e = Ops::and_(Ops::template srli<10>(h), Ops::set(0x1f));
+   I m = Ops::and_(h, Ops::set(0x3ff));
+
+   I normal = Ops::or_(Ops::template slli<23>(Ops::add(e, Ops::set(112))), Ops::template slli<13>(m));
+   I special = Ops::or_(Ops::set(0x7f800000), Ops::template slli<13>(m));
+   I subnormal = Ops::bits(Ops::mulf(Ops::convert(m), Ops::setf(1.f / 16777216.f)));
+
+   I result = Ops::select(Ops::eq(e, Ops::set(31)), special, normal);
+   result = Ops::select(Ops::eq(e, zero), subnormal, result);
+   return Ops::floats(Ops::or_(result, s));
+}
+
+#ifdef TEX_FLOAT_PACK_SSE41
+///////////////////////////////////////////////////////////////////////////////
+TEX_FLOAT_PACK_SSE41_TARGET Sse41Ops::F Sse41Ops::half_to_float(I h) {
+   return half_value<Sse41Ops>(h);
+}
+#endif
+
+#ifdef TEX_FLOAT_PACK_AVX2
+///////////////////////////////////////////////////////////////////////////////
+TEX_FLOAT_PACK_AVX2_TARGET Avx2Ops::F Avx2Ops::half_to_float(I h) {
+   // F16C is exact except that it quiets signaling NaNs; glm keeps the
+   // payload as is.
+   F f = _mm256_cvtph_ps(_mm256_castsi256_si128(_mm256_packus_epi32(h, _mm256_permute4x64_epi64(h, _MM_SHUFFLE(1, 0, 3, 2)))));
+   I nan_bits = or_(slli<16>(and_(h, set(0x8000))), or_(set(0x7f800000), slli<13>(and_(h, set(0x3ff)))));
+   I is_nan = gt(and_(h, set(0x7fff)), set(0x7c00));
+   return floats(select(is_nan, nan_bits, bits(f)));
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// glm::detail::floatTo11bit / floatTo10bit: truncates, ignores the sign.
+template <typename Ops, int MantissaBits>
+typename Ops::I packed_float_bits(const typename Ops::F& x) {
+   using I = typename Ops::I;
+   constexpr int shift = 23 - MantissaBits;
+   constexpr I32 exponent_mask = 0x1f << MantissaBits;
+   constexpr I32 mantissa_mask = (1 << MantissaBits) - 1;
+   I i = Ops::bits(x);
+   I magnitude = Ops::and_(i, Ops::set(0x7fffffff));
+   I code = Ops::or_(Ops::and_(Ops::template srli<shift>(Ops::sub(Ops::and_(i, Ops::set(0x7f800000)), Ops::set(0x38000000))), Ops::set(exponent_mask)),
+                     Ops::and_(Ops::template srli<shift>(i), Ops::set(mantissa_mask)));
+   code = Ops::select(Ops::eq(magnitude, Ops::set(0)), Ops::set(0), code);
+   code = Ops::select(Ops::eq(magnitude, Ops::set(0x7f800000)), Ops::set(exponent_mask), code);
+   code = Ops::select(Ops::gt(magnitude, Ops::set(0x7f800000)), Ops::set(exponent_mask | mantissa_mask), code);
+   return code;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// glm::detail::packed11bitToFloat / packed10bitToFloat.  x isn't masked
+// first, so the special cases only match when no higher bits are set, and
+// they return float(~0), i.e. -1.
+template <typename Ops, int MantissaBits>
+typename Ops::F packed_float_value(const typename Ops::I& x) {
+   using I = typename Ops::I;
+   constexpr int shift = 23 - MantissaBits;
+   constexpr I32 exponent_mask = 0x1f << MantissaBits;
+   constexpr I32 mantissa_mask = (1 << MantissaBits) - 1;
+   I value = Ops::or_(Ops::and_(Ops::add(Ops::template slli<shift>(Ops::and_(x, Ops::set(exponent_mask))), Ops::set(0x38000000)), Ops::set(0x7f800000)),
+                      Ops::template slli<shift>(Ops::and_(x, Ops::set(mantissa_mask))));
+   I special = Ops::or_(Ops::eq(x, Ops::set(exponent_mask | mantissa_mask)), Ops::eq(x, Ops::set(exponent_mask)));
+   value = Ops::select(special, Ops::bits(Ops::setf(-1.f)), value);
+   value = Ops::select(Ops::eq(x, Ops::set(0)), Ops::set(0), value);
+   return Ops::floats(value);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename Ops>
+void pack_half_kernel(const F32* in, U16* out, std::size_t n) {
+   std::size_t i = 0;
+   for (; i + Ops::width <= n; i += Ops::width) {
+      Ops::store16(out + i, half_bits<Ops>(Ops::loadf(in + i)));
+   }
+   for (; i < n; ++i) {
+      out[i] = glm::packHalf1x16(in[i]);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename Ops>
+void unpack_half_kernel(const U16* in, F32* out, std::size_t n) {
+   std::size_t i = 0;
+   for (; i + Ops::width <= n; i += Ops::width) {
+      Ops::storef(out + i, Ops::half_to_float(Ops::load16(in + i)));
+   }
+   for (; i < n; ++i) {
+      out[i] = glm::unpackHalf1x16(in[i]);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename Ops>
+void pack_r11g11b10f_kernel(const vec4* in, U32* out, std::size_t n) {
+   std::size_t i = 0;
+   for (; i + Ops::width <= n; i += Ops::width) {
+      typename Ops::F r, g, b, a;
+      Ops::load_pixels(in + i, r, g, b, a);
+      typename Ops::I word = Ops::or_(packed_float_bits<Ops, 6>(r),
+                             Ops::or_(Ops::template slli<11>(packed_float_bits<Ops, 6>(g)),
+                                      Ops::template slli<22>(packed_float_bits<Ops, 5>(b))));
+      Ops::store32(out + i, word);
+   }
+   for (; i < n; ++i) {
+      out[i] = pack_r11g11b10f_value(in[i]);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename Ops>
+void unpack_r11g11b10f_kernel(const U32* in, vec4* out, std::size_t n) {
+   std::size_t i = 0;
+   for (; i + Ops::width <= n; i += Ops::width) {
+      typename Ops::I word = Ops::load32(in + i);
+      Ops::store_pixels(out + i,
+                        packed_float_value<Ops, 6>(word),
+                        packed_float_value<Ops, 6>(Ops::template srli<11>(word)),
+                        packed_float_value<Ops, 5>(Ops::template srli<22>(word)),
+                        Ops::setf(1.f));
+   }
+   for (; i < n; ++i) {
+      out[i] = unpack_r11g11b10f_value(in[i]);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// glm::packF3x9_E1x5, with floor(log2(max)) read from the exponent bits.
+template <typename Ops>
+void pack_rgb9e5_kernel(const vec4* in, U32* out, std::size_t n) {
+   using I = typename Ops::I;
+   using F = typename Ops::F;
+   const F zero = Ops::setf(0.f);
+   const F shared_exp_max = Ops::setf((std::pow(2.f, 9.f - 1.f) / std::pow(2.f, 9.f)) * std::pow(2.f, 31.f - 15.f));
+   const F half = Ops::setf(0.5f);
+
+   std::size_t i = 0;
+   for (; i + Ops::width <= n; i += Ops::width) {
+      F r, g, b, a;
+      Ops::load_pixels(in + i, r, g, b, a);
+      I unordered = Ops::or_(Ops::unordered(r, g), Ops::unordered(b, b));
+      r = Ops::minf(Ops::maxf(r, zero), shared_exp_max);
+      g = Ops::minf(Ops::maxf(g, zero), shared_exp_max);
+      b = Ops::minf(Ops::maxf(b, zero), shared_exp_max);
+      F max_color = Ops::maxf(r, Ops::maxf(g, b));
+
+      I max_bits = Ops::bits(max_color);
+      I exp_p = Ops::add(Ops::max(Ops::sub(Ops::template srli<23>(max_bits), Ops::set(127)), Ops::set(-16)), Ops::set(16));
+      F scale = Ops::floats(Ops::template slli<23>(Ops::sub(Ops::set(127 + 24), exp_p)));
+      F max_shared = Ops::floorf(Ops::addf(Ops::mulf(max_color, scale), half));
+      I bump = Ops::eq(Ops::bits(max_shared), Ops::bits(Ops::setf(512.f)));
+      I exp = Ops::sub(exp_p, bump); // bump is -1 where set
+      scale = Ops::floats(Ops::template slli<23>(Ops::sub(Ops::set(127 + 24), exp)));
+
+      I word = Ops::or_(Ops::trunc(Ops::floorf(Ops::addf(Ops::mulf(r, scale), half))),
+               Ops::or_(Ops::template slli<9>(Ops::trunc(Ops::floorf(Ops::addf(Ops::mulf(g, scale), half)))),
+               Ops::or_(Ops::template slli<18>(Ops::trunc(Ops::floorf(Ops::addf(Ops::mulf(b, scale), half)))),
+                        Ops::template slli<27>(exp))));
+      Ops::store32(out + i, word);
+
+      I near_power = Ops::gt(Ops::and_(max_bits, Ops::set(0x7fffff)), Ops::set(I32(rgb9e5_near_power_mantissa) - 1));
+      U32 fallback = Ops::mask(Ops::or_(unordered, near_power));
+      while (fallback != 0) {
+         U32 lane = 0;
+         while ((fallback & (1u << lane)) == 0) {
+            ++lane;
+         }
+         fallback &= ~(1u << lane);
+         out[i + lane] = pack_rgb9e5_value(in[i + lane]);
+      }
+   }
+   for (; i < n; ++i) {
+      out[i] = pack_rgb9e5_value(in[i]);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename Ops>
+void unpack_rgb9e5_kernel(const U32* in, vec4* out, std::size_t n) {
+   using I = typename Ops::I;
+   using F = typename Ops::F;
+   const I mask9 = Ops::set(0x1ff);
+   std::size_t i = 0;
+   for (; i + Ops::width <= n; i += Ops::width) {
+      I word = Ops::load32(in + i);
+      // 2^(e - 24) as float bits; e - 24 >= -24 is always normal
+      F scale = Ops::floats(Ops::template slli<23>(Ops::add(Ops::template srli<27>(word), Ops::set(127 - 24))));
+      Ops::store_pixels(out + i,
+                        Ops::mulf(Ops::convert(Ops::and_(word, mask9)), scale),
+                        Ops::mulf(Ops::convert(Ops::and_(Ops::template srli<9>(word), mask9)), scale),
+                        Ops::mulf(Ops::convert(Ops::and_(Ops::template srli<18>(word), mask9)), scale),
+                        Ops::setf(1.f));
+   }
+   for (; i < n; ++i) {
+      out[i] = unpack_rgb9e5_value(in[i]);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void pack_half_scalar(const F32* in, U16* out, std::size_t n) {
+   for (std::size_t i = 0; i < n; ++i) {
+      out[i] = glm::packHalf1x16(in[i]);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void unpack_half_scalar(const U16* in, F32* out, std::size_t n) {
+   for (std::size_t i = 0; i < n; ++i) {
+      out[i] = glm::unpackHalf1x16(in[i]);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void pack_r11g11b10f_scalar(const vec4* in, U32* out, std::size_t n) {
+   for (std::size_t i = 0; i < n; ++i) {
+      out[i] = pack_r11g11b10f_value(in[i]);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void unpack_r11g11b10f_scalar(const U32* in, vec4* out, std::size_t n) {
+   for (std::size_t i = 0; i < n; ++i) {
+      out[i] = unpack_r11g11b10f_value(in[i]);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void pack_rgb9e5_scalar(const vec4* in, U32* out, std::size_t n) {
+   for (std::size_t i = 0; i < n; ++i) {
+      out[i] = pack_rgb9e5_value(in[i]);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void unpack_rgb9e5_scalar(const U32* in, vec4* out, std::size_t n) {
+   for (std::size_t i = 0; i < n; ++i) {
+      out[i] = unpack_rgb9e5_value(in[i]);
+   }
+}
+
+#ifdef TEX_FLOAT_PACK_SSE41
+///////////////////////////////////////////////////////////////////////////////
+TEX_FLOAT_PACK_SSE41_TARGET TEX_FLOAT_PACK_KERNEL
+void pack_half_sse41(const F32* in, U16* out, std::size_t n) {
+   pack_half_kernel<Sse41Ops>(in, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEX_FLOAT_PACK_SSE41_TARGET TEX_FLOAT_PACK_KERNEL
+void unpack_half_sse41(const U16* in, F32* out, std::size_t n) {
+   unpack_half_kernel<Sse41Ops>(in, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEX_FLOAT_PACK_SSE41_TARGET TEX_FLOAT_PACK_KERNEL
+void pack_r11g11b10f_sse41(const vec4* in, U32* out, std::size_t n) {
+   pack_r11g11b10f_kernel<Sse41Ops>(in, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEX_FLOAT_PACK_SSE41_TARGET TEX_FLOAT_PACK_KERNEL
+void unpack_r11g11b10f_sse41(const U32* in, vec4* out, std::size_t n) {
+   unpack_r11g11b10f_kernel<Sse41Ops>(in, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEX_FLOAT_PACK_SSE41_TARGET TEX_FLOAT_PACK_KERNEL
+void pack_rgb9e5_sse41(const vec4* in, U32* out, std::size_t n) {
+   pack_rgb9e5_kernel<Sse41Ops>(in, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEX_FLOAT_PACK_SSE41_TARGET TEX_FLOAT_PACK_KERNEL
+void unpack_rgb9e5_sse41(const U32* in, vec4* out, std::size_t n) {
+   unpack_rgb9e5_kernel<Sse41Ops>(in, out, n);
+}
+#endif
+
+#ifdef TEX_FLOAT_PACK_AVX2
+///////////////////////////////////////////////////////////////////////////////
+TEX_FLOAT_PACK_AVX2_TARGET TEX_FLOAT_PACK_KERNEL
+void pack_half_avx2(const F32* in, U16* out, std::size_t n) {
+   pack_half_kernel<Avx2Ops>(in, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEX_FLOAT_PACK_AVX2_TARGET TEX_FLOAT_PACK_KERNEL
+void unpack_half_avx2(const U16* in, F32* out, std::size_t n) {
+   unpack_half_kernel<Avx2Ops>(in, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEX_FLOAT_PACK_AVX2_TARGET TEX_FLOAT_PACK_KERNEL
+void pack_r11g11b10f_avx2(const vec4* in, U32* out, std::size_t n) {
+   pack_r11g11b10f_kernel<Avx2Ops>(in, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEX_FLOAT_PACK_AVX2_TARGET TEX_FLOAT_PACK_KERNEL
+void unpack_r11g11b10f_avx2(const U32* in, vec4* out, std::size_t n) {
+   unpack_r11g11b10f_kernel<Avx2Ops>(in, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEX_FLOAT_PACK_AVX2_TARGET TEX_FLOAT_PACK_KERNEL
+void pack_rgb9e5_avx2(const vec4* in, U32* out, std::size_t n) {
+   pack_rgb9e5_kernel<Avx2Ops>(in, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEX_FLOAT_PACK_AVX2_TARGET TEX_FLOAT_PACK_KERNEL
+void unpack_rgb9e5_avx2(const U32* in, vec4* out, std::size_t n) {
+   unpack_rgb9e5_kernel<Avx2Ops>(in, out, n);
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+struct PackTable {
+   void (*pack_half)(const F32*, U16*, std::size_t);
+   void (*unpack_half)(const U16*, F32*, std::size_t);
+   void (*pack_r11g11b10f)(const vec4*, U32*, std::size_t);
+   void (*unpack_r11g11b10f)(const U32*, vec4*, std::size_t);
+   void (*pack_rgb9e5)(const vec4*, U32*, std::size_t);
+   void (*unpack_rgb9e5)(const U32*, vec4*, std::size_t);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+const PackTable& pack_table(SimdLevel level) {
+   static const PackTable scalar {
+      pack_half_scalar,
+      unpack_half_scalar,
+      pack_r11g11b10f_scalar,
+      unpack_r11g11b10f_scalar,
+      pack_rgb9e5_scalar,
+      unpack_rgb9e5_scalar
+   };
+#ifdef TEX_FLOAT_PACK_SSE41
+   static const PackTable sse41 {
+      pack_half_sse41,
+      unpack_half_sse41,
+      pack_r11g11b10f_sse41,
+      unpack_r11g11b10f_sse41,
+      pack_rgb9e5_sse41,
+      unpack_rgb9e5_sse41
+   };
+#endif
+#ifdef TEX_FLOAT_PACK_AVX2
+   static const PackTable avx2 {
+      pack_half_avx2,
+      unpack_half_avx2,
+      pack_r11g11b10f_avx2,
+      unpack_r11g11b10f_avx2,
+      pack_rgb9e5_avx2,
+      unpack_rgb9e5_avx2
+   };
+#endif
+
+   switch (level) {
+#ifdef TEX_FLOAT_PACK_AVX2
+      case SimdLevel::avx2: return avx2;
+#endif
+#ifdef TEX_FLOAT_PACK_SSE41
+      case SimdLevel::sse41: return sse41;
+#endif
+      default: return scalar;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Edge cases for every format: signed zeros, subnormals, rounding ties,
+// values just below each power of two, the largest finite values,
+// infinities and NaNs, followed by pseudo-random values with random
+// exponents.
+std::vector<F32> make_probe_values(std::size_t random_count) {
+   std::vector<F32> values = {
+      0.f, -0.f, 1.f, -1.f, 0.5f, 2.f, 65504.f, 65519.f, 65520.f, 65536.f, 1e10f, -1e10f,
+      32768.f, 65408.f, 64512.f, 65024.f, 5.9604645e-8f, 2.9802322e-8f, 6.1035156e-5f, 3.0517578e-5f,
+      std::numeric_limits<F32>::denorm_min(), std::numeric_limits<F32>::min(), std::numeric_limits<F32>::max(),
+      std::numeric_limits<F32>::infinity(), -std::numeric_limits<F32>::infinity(),
+      std::numeric_limits<F32>::quiet_NaN(), -std::numeric_limits<F32>::quiet_NaN()
+   };
+
+   for (I32 e = -30; e <= 17; ++e) {
+      F32 p = std::ldexp(1.f, e);
+      values.push_back(p);
+      values.push_back(std::nextafter(p, 0.f));
+      values.push_back(std::nextafter(p, 2.f * p));
+      values.push_back(p * (1.f + 1.f / 2048.f)); // half tie
+      values.push_back(p * (1.f + 3.f / 2048.f));
+      values.push_back(p * (1.f + 1.f / 128.f));
+      values.push_back(-p * 1.25f);
+   }
+
+   U32 state = 12345;
+   for (std::size_t i = 0; i < random_count; ++i) {
+      state = state * 1664525u + 1013904223u;
+      U32 bits = state;
+      state = state * 1664525u + 1013904223u;
+      // exponents between 2^-30 and 2^17, any mantissa, either sign
+      U32 exponent = 97 + (state >> 8) % 48;
+      bits = (bits & 0x807fffffu) | (exponent << 23);
+      F32 v;
+      std::memcpy(&v, &bits, sizeof(v));
+      values.push_back(v);
+   }
+
+   return values;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool same_bits(const void* a, const void* b, std::size_t bytes) {
+   return std::memcmp(a, b, bytes) == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool verify_format(const ImageFormat& format) {
+   static const ImageFormat rgba16f = canonical_format(GL_RGBA16F);
+   static const ImageFormat r11g11b10f = canonical_format(GL_R11F_G11F_B10F);
+   static const ImageFormat rgb9e5 = canonical_format(GL_RGB9_E5);
+   if (format != rgba16f && format != r11g11b10f && format != rgb9e5) {
+      return false;
+   }
+
+   std::vector<F32> values = make_probe_values(4096);
+   std::vector<vec4> pixels;
+   for (std::size_t i = 0; i < values.size(); ++i) {
+      // rotate so every channel sees every value
+      pixels.push_back(vec4(values[i], values[(i + 1) % values.size()], values[(i + 2) % values.size()], values[(i + 3) % values.size()]));
+   }
+
+   ivec2 dim = ivec2(I32(pixels.size()), 1);
+   Texture generic = make_planar_texture(format, dim, 1);
+   ImageView view = generic.view.image();
+   auto put = put_pixel_norm_func<ivec2>(view);
+   auto get = get_pixel_norm_func<ivec2>(view);
+   for (I32 x = 0; x < dim.x; ++x) {
+      put(view, ivec2(x, 0), pixels[std::size_t(x)]);
+   }
+
+   std::vector<vec4> generic_values(pixels.size());
+   for (I32 x = 0; x < dim.x; ++x) {
+      generic_values[std::size_t(x)] = get(view, ivec2(x, 0));
+   }
+   std::vector<vec4> unpacked(pixels.size());
+   std::size_t bytes = pixels.size() * format.block_size();
+
+   if (format == rgba16f) {
+      std::vector<U16> packed(pixels.size() * 4);
+      pack_half(glm::value_ptr(pixels[0]), packed.data(), packed.size());
+      unpack_half(reinterpret_cast<const U16*>(view.data()), glm::value_ptr(unpacked[0]), packed.size());
+      return same_bits(packed.data(), view.data(), bytes) && same_bits(unpacked.data(), generic_values.data(), unpacked.size() * sizeof(vec4));
+   }
+
+   std::vector<U32> packed(pixels.size());
+   if (format == r11g11b10f) {
+      pack_r11g11b10f(pixels.data(), packed.data(), pixels.size());
+      unpack_r11g11b10f(reinterpret_cast<const U32*>(view.data()), unpacked.data(), pixels.size());
+   } else {
+      pack_rgb9e5(pixels.data(), packed.data(), pixels.size());
+      unpack_rgb9e5(reinterpret_cast<const U32*>(view.data()), unpacked.data(), pixels.size());
+   }
+   return same_bits(packed.data(), view.data(), bytes) && same_bits(unpacked.data(), generic_values.data(), unpacked.size() * sizeof(vec4));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename F>
+F64 measure_mvalues_per_second(std::size_t values, F func) {
+   using clock = std::chrono::steady_clock;
+   const int repeats = 8;
+   func();
+   auto start = clock::now();
+   for (int i = 0; i < repeats; ++i) {
+      func();
+   }
+   F64 seconds = std::chrono::duration<F64>(clock::now() - start).count();
+   return seconds > 0 ? F64(values) * repeats / seconds / 1000000.0 : 0.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+U64 count_mismatches(const std::vector<T>& a, const std::vector<T>& b, std::size_t bytes_per_value) {
+   const UC* pa = reinterpret_cast<const UC*>(a.data());
+   const UC* pb = reinterpret_cast<const UC*>(b.data());
+   std::size_t n = a.size() * sizeof(T) / bytes_per_value;
+   U64 mismatches = 0;
+   for (std::size_t i = 0; i < n; ++i) {
+      if (!same_bits(pa + i * bytes_per_value, pb + i * bytes_per_value, bytes_per_value)) {
+         ++mismatches;
+      }
+   }
+   return mismatches;
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+void pack_half(const F32* in, U16* out, std::size_t n) {
+   pack_table(simd_level()).pack_half(in, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void unpack_half(const U16* in, F32* out, std::size_t n) {
+   pack_table(simd_level()).unpack_half(in, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void pack_r11g11b10f(const vec4* in, U32* out, std::size_t n) {
+   pack_table(simd_level()).pack_r11g11b10f(in, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void unpack_r11g11b10f(const U32* in, vec4* out, std::size_t n) {
+   pack_table(simd_level()).unpack_r11g11b10f(in, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void pack_rgb9e5(const vec4* in, U32* out, std::size_t n) {
+   pack_table(simd_level()).pack_rgb9e5(in, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void unpack_rgb9e5(const U32* in, vec4* out, std::size_t n) {
+   pack_table(simd_level()).unpack_rgb9e5(in, out, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool float_pack_verified(const ImageFormat& format) {
+   static const bool rgba16f = verify_format(canonical_format(GL_RGBA16F));
+   static const bool r11g11b10f = verify_format(canonical_format(GL_R11F_G11F_B10F));
+   static const bool rgb9e5 = verify_format(canonical_format(GL_RGB9_E5));
+
+   if (format == canonical_format(GL_RGBA16F)) {
+      return rgba16f;
+   } else if (format == canonical_format(GL_R11F_G11F_B10F)) {
+      return r11g11b10f;
+   } else if (format == canonical_format(GL_RGB9_E5)) {
+      return rgb9e5;
+   }
+   return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<FloatPackCheck> check_float_packing(std::size_t samples) {
+   std::vector<FloatPackCheck> results;
+
+   std::vector<F32> values = make_probe_values(samples);
+   values.resize(values.size() & ~std::size_t(3));
+   std::size_t count = values.size();
+   std::size_t pixel_count = count / 4;
+   const vec4* pixels = reinterpret_cast<const vec4*>(values.data());
+
+   std::vector<U16> halves(count);
+   std::vector<U16> expected_halves(count);
+   std::vector<U32> words(pixel_count);
+   std::vector<U32> expected_words(pixel_count);
+   std::vector<F32> floats(count);
+   std::vector<F32> expected_floats(count);
+   vec4* out_pixels = reinterpret_cast<vec4*>(floats.data());
+   vec4* expected_pixels = reinterpret_cast<vec4*>(expected_floats.data());
+
+   auto check = [&](const char* kernel, std::size_t n, auto reference, auto kernel_func, auto mismatches) {
+      F64 reference_speed = measure_mvalues_per_second(n, reference);
+      for (int level = int(SimdLevel::scalar); level <= int(max_simd_level()); ++level) {
+         const PackTable& table = pack_table(SimdLevel(level));
+         F64 speed = measure_mvalues_per_second(n, [&]() { kernel_func(table); });
+         results.push_back(FloatPackCheck { kernel, SimdLevel(level), mismatches(), speed, reference_speed });
+      }
+   };
+
+   check("pack half", count,
+      [&]() { for (std::size_t i = 0; i < count; ++i) expected_halves[i] = glm::packHalf1x16(values[i]); },
+      [&](const PackTable& t) { t.pack_half(values.data(), halves.data(), count); },
+      [&]() { return count_mismatches(halves, expected_halves, sizeof(U16)); });
+
+   check("unpack half", count,
+      [&]() { for (std::size_t i = 0; i < count; ++i) expected_floats[i] = glm::unpackHalf1x16(expected_halves[i]); },
+      [&](const PackTable& t) { t.unpack_half(expected_halves.data(), floats.data(), count); },
+      [&]() { return count_mismatches(floats, expected_floats, sizeof(F32)); });
+
+   check("pack 11/11/10", pixel_count,
+      [&]() { for (std::size_t i = 0; i < pixel_count; ++i) expected_words[i] = pack_r11g11b10f_value(pixels[i]); },
+      [&](const PackTable& t) { t.pack_r11g11b10f(pixels, words.data(), pixel_count); },
+      [&]() { return count_mismatches(words, expected_words, sizeof(U32)); });
+
+   check("unpack 11/11/10", pixel_count,
+      [&]() { for (std::size_t i = 0; i < pixel_count; ++i) expected_pixels[i] = unpack_r11g11b10f_value(expected_words[i]); },
+      [&](const PackTable& t) { t.unpack_r11g11b10f(expected_words.data(), out_pixels, pixel_count); },
+      [&]() { return count_mismatches(floats, expected_floats, sizeof(vec4)); });
+
+   check("pack 9/9/9/5", pixel_count,
+      [&]() { for (std::size_t i = 0; i < pixel_count; ++i) expected_words[i] = pack_rgb9e5_value(pixels[i]); },
+      [&](const PackTable& t) { t.pack_rgb9e5(pixels, words.data(), pixel_count); },
+      [&]() { return count_mismatches(words, expected_words, sizeof(U32)); });
+
+   check("unpack 9/9/9/5", pixel_count,
+      [&]() { for (std::size_t i = 0; i < pixel_count; ++i) expected_pixels[i] = unpack_rgb9e5_value(expected_words[i]); },
+      [&](const PackTable& t) { t.unpack_rgb9e5(expected_words.data(), out_pixels, pixel_count); },
+      [&]() { return count_mismatches(floats, expected_floats, sizeof(vec4)); });
+
+   return results;
+}
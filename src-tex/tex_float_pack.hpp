@@ -0,0 +1,45 @@
+#pragma once
+#ifndef TEX_FLOAT_PACK_HPP_
+#define TEX_FLOAT_PACK_HPP_
+
+#include "tex_fast_math.hpp"
+#include <be/core/glm.hpp>
+#include <be/gfx/tex/image_format.hpp>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// Bulk conversions for the HDR formats, bit-exact with the glm functions
+// they replace: packHalf1x16/unpackHalf1x16 (RGBA16F, per value),
+// packF2x11_1x10/unpackF2x11_1x10 (R11F_G11F_B10F) and
+// packF3x9_E1x5/unpackF3x9_E1x5 (RGB9_E5).  Packed pixels are one U32 each;
+// unpacked pixels get alpha 1.  Uses the level from simd_level().
+void pack_half(const be::F32* in, be::U16* out, std::size_t n);
+void unpack_half(const be::U16* in, be::F32* out, std::size_t n);
+void pack_r11g11b10f(const be::vec4* in, be::U32* out, std::size_t n);
+void unpack_r11g11b10f(const be::U32* in, be::vec4* out, std::size_t n);
+void pack_rgb9e5(const be::vec4* in, be::U32* out, std::size_t n);
+void unpack_rgb9e5(const be::U32* in, be::vec4* out, std::size_t n);
+
+///////////////////////////////////////////////////////////////////////////////
+// True if format is RGBA16F, R11F_G11F_B10F or RGB9_E5 and the kernels
+// above give the same bits as put_pixel_norm/get_pixel_norm for a set of
+// edge cases and random values.  Checked once per format; callers should
+// use the generic path when this is false.
+bool float_pack_verified(const be::gfx::tex::ImageFormat& format);
+
+///////////////////////////////////////////////////////////////////////////////
+struct FloatPackCheck {
+   const char* kernel;
+   SimdLevel level;
+   be::U64 mismatches; // values whose bits differ from the glm conversion
+   be::F64 mvalues_per_second;
+   be::F64 reference_mvalues_per_second;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Compares every kernel at every available level against the per-value
+// glm conversion, over edge cases plus random values spanning each
+// format's range.
+std::vector<FloatPackCheck> check_float_packing(std::size_t samples);
+
+#endif
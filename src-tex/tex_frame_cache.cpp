@@ -0,0 +1,93 @@
+#include "tex_frame_cache.hpp"
+#include <cmath>
+
+using namespace be;
+using namespace be::gfx::tex;
+
+///////////////////////////////////////////////////////////////////////////////
+FrameCache::FrameCache(TexturePool* pool)
+   : pool_(pool) { }
+
+///////////////////////////////////////////////////////////////////////////////
+bool FrameCache::bake(U32 phases, std::size_t budget_bytes, const ImageFormat& format, ivec2 dim, const Renderer& render) {
+   clear();
+   if (phases == 0) {
+      return false;
+   }
+
+   ImageBuffer first = pool_ ? pool_->acquire(format, dim) : ImageBuffer(format, dim);
+   std::size_t frame_bytes = first.image().size();
+   if (frame_bytes * phases > budget_bytes) {
+      if (pool_) {
+         pool_->release(std::move(first));
+      }
+      return false;
+   }
+
+   frames_.reserve(phases);
+   frames_.push_back(std::move(first));
+   for (U32 i = 1; i < phases; ++i) {
+      frames_.push_back(pool_ ? pool_->acquire(format, dim) : ImageBuffer(format, dim));
+   }
+
+   try {
+      for (U32 i = 0; i < phases; ++i) {
+         render(frames_[i], F64(i) / F64(phases));
+         views_.push_back(frames_[i].image());
+      }
+   } catch (...) {
+      clear();
+      throw;
+   }
+
+   bytes_ = frame_bytes * phases;
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FrameCache::clear() {
+   if (pool_) {
+      for (auto& frame : frames_) {
+         pool_->release(std::move(frame));
+      }
+   }
+   discard();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FrameCache::discard() {
+   frames_.clear();
+   views_.clear();
+   bytes_ = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool FrameCache::baked() const {
+   return !views_.empty();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U32 FrameCache::phases() const {
+   return U32(views_.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t FrameCache::bytes() const {
+   return bytes_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U32 FrameCache::index(F64 phase, U32 phases) {
+   U32 i = U32(std::floor((phase - std::floor(phase)) * F64(phases) + 0.5));
+   return i < phases ? i : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U32 FrameCache::index(F64 phase) const {
+   return index(phase, phases());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const ImageView& FrameCache::frame(U32 index) const {
+   return views_[index];
+}
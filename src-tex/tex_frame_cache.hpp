@@ -0,0 +1,45 @@
+#pragma once
+#ifndef TEX_FRAME_CACHE_HPP_
+#define TEX_FRAME_CACHE_HPP_
+
+#include "tex_texture_pool.hpp"
+#include <be/core/glm.hpp>
+#include <functional>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// Pre-rendered frames of a periodic animation, sampled at evenly spaced
+// phases in [0, 1).  Playback picks the nearest phase, so the animation is
+// quantized to the number of phases baked.
+class FrameCache final {
+public:
+   using Renderer = std::function<void(ImageBuffer&, be::F64 phase)>;
+
+   explicit FrameCache(TexturePool* pool = nullptr);
+
+   // Renders every phase, or returns false without rendering anything if the
+   // frames wouldn't fit in budget_bytes.
+   bool bake(be::U32 phases, std::size_t budget_bytes, const be::gfx::tex::ImageFormat& format, be::ivec2 dim, const Renderer& render);
+   // Returns the frames to the pool, if any.
+   void clear();
+   // Frees the frames without pooling them, e.g. once they've been uploaded
+   // and won't be rendered into again.
+   void discard();
+
+   bool baked() const;
+   be::U32 phases() const;
+   std::size_t bytes() const;
+
+   // phase may be any value; only its fractional part is used.
+   static be::U32 index(be::F64 phase, be::U32 phases);
+   be::U32 index(be::F64 phase) const;
+   const be::gfx::tex::ImageView& frame(be::U32 index) const;
+
+private:
+   TexturePool* pool_;
+   std::vector<ImageBuffer> frames_;
+   std::vector<be::gfx::tex::ImageView> views_;
+   std::size_t bytes_ = 0;
+};
+
+#endif
@@ -0,0 +1,207 @@
+#include "tex_frame_pipeline.hpp"
+#include <algorithm>
+#include <fstream>
+#include <memory>
+
+using namespace be;
+using namespace be::gfx::tex;
+
+///////////////////////////////////////////////////////////////////////////////
+FrameConsumer null_frame_consumer() {
+   return [](const ImageView&, U64) { };
+}
+
+///////////////////////////////////////////////////////////////////////////////
+FrameConsumer raw_file_frame_consumer(const Path& path) {
+   auto stream = std::make_shared<std::ofstream>(path.string(), std::ios::binary | std::ios::trunc);
+   if (!*stream) {
+      throw fs::filesystem_error("Could not open frame output file", path, std::make_error_code(std::errc::io_error));
+   }
+   return [=](const ImageView& image, U64) {
+      stream->write(reinterpret_cast<const char*>(image.data()), std::streamsize(image.size()));
+      if (!*stream) {
+         throw fs::filesystem_error("Could not write frame", path, std::make_error_code(std::errc::io_error));
+      }
+   };
+}
+
+///////////////////////////////////////////////////////////////////////////////
+FramePipeline::FramePipeline(U32 depth, FrameProducer producer, TexturePool* pool)
+   : depth_(std::max(depth, 1u)),
+     producer_(std::move(producer)),
+     pool_(pool) { }
+
+///////////////////////////////////////////////////////////////////////////////
+FramePipeline::~FramePipeline() {
+   stop();
+   release_slots_();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FramePipeline::start(const ImageFormat& format, ivec2 dim) {
+   stop();
+   release_slots_();
+
+   free_.clear();
+   ready_.clear();
+   for (U32 i = 0; i < depth_; ++i) {
+      slots_.push_back(pool_ ? pool_->acquire(format, dim) : ImageBuffer(format, dim));
+      free_.push_back(i);
+   }
+
+   stopping_ = false;
+   running_ = true;
+   exception_ = nullptr;
+   worker_thread_ = std::thread(&FramePipeline::worker_, this);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FramePipeline::stop() {
+   if (!running_) {
+      return;
+   }
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+   }
+   free_cv_.notify_all();
+   worker_thread_.join();
+   running_ = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool FramePipeline::running() const {
+   return running_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool FramePipeline::consume(const FrameConsumer& consumer, bool wait) {
+   U32 slot;
+   U64 frame;
+   {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (ready_.empty()) {
+         ++consumer_stalls_;
+         if (!wait) {
+            if (exception_) {
+               std::rethrow_exception(exception_);
+            }
+            return false;
+         }
+         ready_cv_.wait(lock, [this]() { return !ready_.empty() || exception_ || !running_; });
+      }
+      if (exception_) {
+         std::rethrow_exception(exception_);
+      }
+      if (ready_.empty()) {
+         return false;
+      }
+      slot = ready_.front();
+      ready_.pop_front();
+      frame = consumed_++;
+   }
+
+   try {
+      consumer(slots_[slot].image(), frame);
+   } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      free_.push_back(slot);
+      free_cv_.notify_one();
+      throw;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      free_.push_back(slot);
+   }
+   free_cv_.notify_one();
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FramePipeline::worker_() {
+   for (;;) {
+      U32 slot;
+      {
+         std::unique_lock<std::mutex> lock(mutex_);
+         if (free_.empty() && !stopping_) {
+            ++producer_stalls_;
+            free_cv_.wait(lock, [this]() { return stopping_ || !free_.empty(); });
+         }
+         if (stopping_) {
+            return;
+         }
+         slot = free_.front();
+         free_.pop_front();
+      }
+
+      try {
+         producer_(slots_[slot]);
+      } catch (...) {
+         std::lock_guard<std::mutex> lock(mutex_);
+         exception_ = std::current_exception();
+         free_.push_back(slot);
+         ready_cv_.notify_all();
+         return;
+      }
+
+      {
+         std::lock_guard<std::mutex> lock(mutex_);
+         ready_.push_back(slot);
+         ++produced_;
+         max_queued_ = std::max(max_queued_, U32(ready_.size()));
+      }
+      ready_cv_.notify_one();
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FramePipeline::release_slots_() {
+   if (pool_) {
+      for (auto& slot : slots_) {
+         pool_->release(std::move(slot));
+      }
+   }
+   slots_.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U32 FramePipeline::depth() const {
+   return depth_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U32 FramePipeline::queued() const {
+   std::lock_guard<std::mutex> lock(mutex_);
+   return U32(ready_.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U32 FramePipeline::max_queued() const {
+   std::lock_guard<std::mutex> lock(mutex_);
+   return max_queued_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 FramePipeline::produced() const {
+   std::lock_guard<std::mutex> lock(mutex_);
+   return produced_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 FramePipeline::consumed() const {
+   std::lock_guard<std::mutex> lock(mutex_);
+   return consumed_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 FramePipeline::producer_stalls() const {
+   std::lock_guard<std::mutex> lock(mutex_);
+   return producer_stalls_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 FramePipeline::consumer_stalls() const {
+   std::lock_guard<std::mutex> lock(mutex_);
+   return consumer_stalls_;
+}
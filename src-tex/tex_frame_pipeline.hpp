@@ -0,0 +1,86 @@
+#pragma once
+#ifndef TEX_FRAME_PIPELINE_HPP_
+#define TEX_FRAME_PIPELINE_HPP_
+
+#include "tex_texture_pool.hpp"
+#include <be/core/glm.hpp>
+#include <be/core/filesystem.hpp>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+using FrameProducer = std::function<void(ImageBuffer&)>;
+using FrameConsumer = std::function<void(const be::gfx::tex::ImageView&, be::U64 frame)>;
+
+///////////////////////////////////////////////////////////////////////////////
+FrameConsumer null_frame_consumer();
+
+///////////////////////////////////////////////////////////////////////////////
+// Appends the raw pixel data of every frame to a single file.
+FrameConsumer raw_file_frame_consumer(const be::Path& path);
+
+///////////////////////////////////////////////////////////////////////////////
+// Generates frames on a worker thread into a ring of preallocated textures
+// while the caller consumes earlier ones.  The producer owns a slot from the
+// time it starts generating until the frame is consumed, so it never writes
+// to a texture that is being read.  If a pool is provided, the ring is
+// allocated from it and returned to it when reallocated or destroyed.
+class FramePipeline final {
+public:
+   FramePipeline(be::U32 depth, FrameProducer producer, TexturePool* pool = nullptr);
+   ~FramePipeline();
+
+   FramePipeline(const FramePipeline&) = delete;
+   FramePipeline& operator=(const FramePipeline&) = delete;
+
+   // (Re)allocates the ring and starts the worker.  Anything the producer
+   // shares with the caller must not be touched until stop() returns.
+   void start(const be::gfx::tex::ImageFormat& format, be::ivec2 dim);
+   void stop();
+   bool running() const;
+
+   // Passes the oldest finished frame to consumer and recycles its slot.  If
+   // no frame is ready, either waits for one or returns false immediately.
+   // Exceptions thrown by the producer are rethrown here.
+   bool consume(const FrameConsumer& consumer, bool wait);
+
+   be::U32 depth() const;
+   be::U32 queued() const;
+   be::U32 max_queued() const;
+   be::U64 produced() const;
+   be::U64 consumed() const;
+   be::U64 producer_stalls() const; // ring full; the consumer is the bottleneck
+   be::U64 consumer_stalls() const; // ring empty; the producer is the bottleneck
+
+private:
+   void worker_();
+   void release_slots_();
+
+   be::U32 depth_;
+   FrameProducer producer_;
+   TexturePool* pool_;
+   std::vector<ImageBuffer> slots_;
+   std::deque<be::U32> free_;
+   std::deque<be::U32> ready_;
+   std::thread worker_thread_;
+
+   mutable std::mutex mutex_;
+   std::condition_variable free_cv_;
+   std::condition_variable ready_cv_;
+   bool stopping_ = false;
+   bool running_ = false;
+   std::exception_ptr exception_;
+
+   be::U32 max_queued_ = 0;
+   be::U64 produced_ = 0;
+   be::U64 consumed_ = 0;
+   be::U64 producer_stalls_ = 0;
+   be::U64 consumer_stalls_ = 0;
+};
+
+#endif
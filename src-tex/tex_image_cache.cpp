@@ -0,0 +1,177 @@
+#include "tex_image_cache.hpp"
+#include "tex_blit.hpp"
+#include "tex_channel_ops.hpp"
+#include <be/core/logging.hpp>
+#include <be/gfx/tex/texture_reader.hpp>
+#include <be/gfx/tex/pixel_access_norm.hpp>
+#include <be/gfx/tex/log_texture_info.hpp>
+
+using namespace be;
+using namespace be::gfx::tex;
+
+///////////////////////////////////////////////////////////////////////////////
+void load_image(const Path& path, bool opaque, TexturePool* pool, LoadedImage& image) {
+   image = LoadedImage();
+
+   MappedImage mapped;
+   if (map_image(path, mapped)) {
+      if (opaque) {
+         // the mapping is read-only, so forcing alpha needs a private copy
+         image.copy = pool ? pool->acquire(mapped.view.format(), ivec2(mapped.view.dim())) : ImageBuffer(mapped.view.format(), ivec2(mapped.view.dim()));
+         image.view = image.copy.image();
+         blit_image(mapped.view, image.view);
+      } else {
+         image.mapped = std::move(mapped);
+         image.view = image.mapped.view;
+      }
+   } else {
+      TextureReader reader;
+      reader.read(path);
+      image.decoded = reader.texture();
+      log_texture_info(image.decoded.view, path.string());
+      image.view = image.decoded.view.image(0, 0, 0);
+   }
+
+   if (opaque) {
+      ImageView& source = image.view;
+      ChannelLayout layout;
+      if (channel_layout(source.format(), layout)) {
+         fill_channel(source, 3, 1.f); // no-op if there's no alpha channel
+      } else {
+         // packed formats
+         auto get = get_pixel_norm_func<ivec2>(source);
+         auto put = put_pixel_norm_func<ivec2>(source);
+         ivec2 dim = ivec2(source.dim());
+         for (ivec2 pc(0); pc.y < dim.y; ++pc.y) {
+            for (pc.x = 0; pc.x < dim.x; ++pc.x) {
+               vec4 p = get(source, pc);
+               p.a = 1.f;
+               put(source, pc, p);
+            }
+         }
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ImageCache::pool(TexturePool* pool) {
+   pool_ = pool;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool ImageCache::refresh(const Path& path, bool opaque) {
+   file_time mtime = fs::last_write_time(path);
+   if (has_source_ && path == path_ && mtime == mtime_ && opaque == opaque_) {
+      ++hits_;
+      return false;
+   }
+
+   clear();
+
+   LoadedImage image;
+   load_image(path, opaque, pool_, image);
+   adopt_(path, mtime, opaque, std::move(image));
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ImageCache::assign(const Path& path, bool opaque, LoadedImage&& image) {
+   file_time mtime = fs::last_write_time(path);
+   clear();
+   adopt_(path, mtime, opaque, std::move(image));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ImageCache::adopt_(const Path& path, file_time mtime, bool opaque, LoadedImage&& image) {
+   mapped_ = std::move(image.mapped);
+   copy_ = std::move(image.copy);
+   decoded_ = std::move(image.decoded);
+   if (mapped_.file) {
+      source_ = mapped_.view;
+   } else if (copy_) {
+      source_ = copy_.image();
+   } else {
+      source_ = decoded_.view.image(0, 0, 0);
+   }
+
+   path_ = path;
+   mtime_ = mtime;
+   opaque_ = opaque;
+   has_source_ = true;
+   ++loads_;
+
+   be_info() << "Loaded image"
+      & attr(ids::log_attr_path) << path.string()
+      & attr("Mapped") << bool(mapped_.file)
+      & attr("Size (MB)") << F64(source_.size()) / (1024.0 * 1024.0)
+      & attr("Peak RSS (MB)") << F64(peak_resident_bytes()) / (1024.0 * 1024.0)
+      | default_log();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const ImageView& ImageCache::source() const {
+   return source_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool ImageCache::source_mapped() const {
+   return bool(mapped_.file);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const ImageView& ImageCache::image(const ImageFormat& format) {
+   if (source_.format() == format) {
+      return source_;
+   }
+
+   if (!has_converted_ || converted_view_.format() != format) {
+      release_(converted_);
+      converted_ = pool_ ? pool_->acquire(format, ivec2(source_.dim())) : ImageBuffer(format, ivec2(source_.dim()));
+      converted_view_ = converted_.image();
+      const char* path = blit_image(source_, converted_view_);
+      be_verbose() << "Converted image"
+         & attr("Blit") << path
+         | default_log();
+      has_converted_ = true;
+      ++generation_;
+   }
+   return converted_view_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 ImageCache::generation() const {
+   return generation_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 ImageCache::loads() const {
+   return loads_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 ImageCache::hits() const {
+   return hits_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ImageCache::clear() {
+   // drop the old pixels before the next file is loaded to keep peak memory down
+   has_source_ = false;
+   has_converted_ = false;
+   source_ = ImageView();
+   converted_view_ = ImageView();
+   release_(converted_);
+   release_(copy_);
+   decoded_ = Texture();
+   mapped_ = MappedImage();
+   path_ = Path();
+   ++generation_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ImageCache::release_(ImageBuffer& buffer) {
+   if (pool_) {
+      pool_->release(std::move(buffer));
+   }
+   buffer = ImageBuffer();
+}
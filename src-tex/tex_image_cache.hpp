@@ -0,0 +1,87 @@
+#pragma once
+#ifndef TEX_IMAGE_CACHE_HPP_
+#define TEX_IMAGE_CACHE_HPP_
+
+#include "tex_mapped_image.hpp"
+#include "tex_texture_pool.hpp"
+#include <be/core/filesystem.hpp>
+#include <be/gfx/tex/texture.hpp>
+#include <utility>
+
+///////////////////////////////////////////////////////////////////////////////
+// An image file's pixels: mapped in place, a private copy of the mapping,
+// or decoded.
+struct LoadedImage {
+   MappedImage mapped;
+   ImageBuffer copy;
+   be::gfx::tex::Texture decoded;
+   be::gfx::tex::ImageView view;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Maps path if possible, otherwise decodes it.  If opaque is set, alpha is
+// forced to 1; a mapped file is copied first, into a buffer from pool if
+// set.  Safe to call from several threads as long as pool is null.
+void load_image(const be::Path& path, bool opaque, TexturePool* pool, LoadedImage& image);
+
+///////////////////////////////////////////////////////////////////////////////
+// Holds the most recently loaded image file along with a copy converted to
+// the display format.  The file is only read again when its path, its
+// modification time, or the opaque flag changes; the converted copy is only
+// rebuilt when the source or the requested format changes.
+//
+// Uncompressed KTX files are memory-mapped and used in place, so when the
+// file already has the display format no pixel data is copied at all.
+class ImageCache final {
+public:
+   // Converted copies are drawn from and returned to pool, if set.
+   void pool(TexturePool* pool);
+
+   // Returns true if the file was (re)loaded.  If opaque is set, alpha is
+   // forced to 1 once, right after loading.
+   bool refresh(const be::Path& path, bool opaque);
+
+   // Takes an image loaded elsewhere (e.g. by ImagePrefetcher) as if it had
+   // been loaded by refresh(path, opaque).
+   void assign(const be::Path& path, bool opaque, LoadedImage&& image);
+
+   const be::gfx::tex::ImageView& source() const;
+   bool source_mapped() const;
+
+   // Returns source() directly when it already has the requested format.
+   // Valid until the next call to refresh(), image(), or clear().
+   const be::gfx::tex::ImageView& image(const be::gfx::tex::ImageFormat& format);
+
+   // Incremented whenever the view returned by image() may have changed.
+   be::U64 generation() const;
+   be::U64 loads() const;
+   be::U64 hits() const;
+
+   void clear();
+
+private:
+   using file_time = decltype(be::fs::last_write_time(std::declval<const be::Path&>()));
+
+   void adopt_(const be::Path& path, file_time mtime, bool opaque, LoadedImage&& image);
+   void release_(ImageBuffer& buffer);
+
+   TexturePool* pool_ = nullptr;
+   be::Path path_;
+   file_time mtime_ = file_time();
+   bool opaque_ = false;
+   bool has_source_ = false;
+   MappedImage mapped_;
+   ImageBuffer copy_;
+   be::gfx::tex::Texture decoded_;
+   be::gfx::tex::ImageView source_;
+
+   bool has_converted_ = false;
+   ImageBuffer converted_;
+   be::gfx::tex::ImageView converted_view_;
+
+   be::U64 generation_ = 0;
+   be::U64 loads_ = 0;
+   be::U64 hits_ = 0;
+};
+
+#endif
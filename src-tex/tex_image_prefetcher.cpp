@@ -0,0 +1,218 @@
+#include "tex_image_prefetcher.hpp"
+#include <algorithm>
+
+using namespace be;
+using namespace be::gfx::tex;
+
+///////////////////////////////////////////////////////////////////////////////
+ImagePrefetcher::ImagePrefetcher(std::vector<Path> paths, U32 depth, U32 threads, bool opaque, PhaseStats* stats)
+   : paths_(std::move(paths)),
+     depth_(U32(std::min(std::size_t(depth), paths_.empty() ? 0 : paths_.size() - 1))),
+     opaque_(opaque),
+     stats_(stats) {
+   if (threads == 0) {
+      threads = std::min(std::max(depth_, 1u), std::max(1u, std::thread::hardware_concurrency()));
+   }
+   for (U32 i = 0; i < threads; ++i) {
+      workers_.emplace_back([this]() {
+         work_();
+      });
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ImagePrefetcher::~ImagePrefetcher() {
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+   }
+   work_cv_.notify_all();
+   for (auto& worker : workers_) {
+      worker.join();
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const std::vector<Path>& ImagePrefetcher::paths() const {
+   return paths_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U32 ImagePrefetcher::depth() const {
+   return depth_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U32 ImagePrefetcher::threads() const {
+   return U32(workers_.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ImagePrefetcher::prefetch(std::size_t index) {
+   std::lock_guard<std::mutex> lock(mutex_);
+   schedule_(index);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ImagePrefetcher::take(std::size_t index, LoadedImage& image, bool* hit) {
+   std::unique_lock<std::mutex> lock(mutex_);
+   schedule_(index);
+
+   Slot& slot = slots_[index];
+   bool ready = slot.state == SlotState::ready || slot.state == SlotState::failed;
+   ++(ready ? hits_ : misses_);
+   if (hit) {
+      *hit = ready;
+   }
+
+   ready_cv_.wait(lock, [&]() {
+      return slot.state == SlotState::ready || slot.state == SlotState::failed;
+   });
+
+   std::exception_ptr error = slot.error;
+   image = std::move(slot.image);
+   slots_.erase(index); // the depth images after it stay queued
+   lock.unlock();
+
+   if (error) {
+      std::rethrow_exception(error);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 ImagePrefetcher::hits() const {
+   std::lock_guard<std::mutex> lock(mutex_);
+   return hits_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 ImagePrefetcher::misses() const {
+   std::lock_guard<std::mutex> lock(mutex_);
+   return misses_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 ImagePrefetcher::images() const {
+   std::lock_guard<std::mutex> lock(mutex_);
+   return images_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 ImagePrefetcher::file_bytes() const {
+   std::lock_guard<std::mutex> lock(mutex_);
+   return file_bytes_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 ImagePrefetcher::image_bytes() const {
+   std::lock_guard<std::mutex> lock(mutex_);
+   return image_bytes_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+F64 ImagePrefetcher::decode_seconds() const {
+   std::lock_guard<std::mutex> lock(mutex_);
+   return decode_seconds_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+F64 ImagePrefetcher::busy_seconds() const {
+   std::lock_guard<std::mutex> lock(mutex_);
+   return active_ > 0 ? busy_seconds_ + tu_to_seconds(ts_now() - busy_start_) : busy_seconds_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Requires mutex_.  Keeps slots for index and the depth_ images after it;
+// anything else is dropped, including loads already in progress.
+void ImagePrefetcher::schedule_(std::size_t index) {
+   if (paths_.empty()) {
+      return;
+   }
+
+   auto wanted = [&](std::size_t i) {
+      return (i + paths_.size() - index) % paths_.size() <= depth_;
+   };
+   for (auto it = slots_.begin(); it != slots_.end(); ) {
+      it = wanted(it->first) ? std::next(it) : slots_.erase(it);
+   }
+   queue_.erase(std::remove_if(queue_.begin(), queue_.end(), [&](std::size_t i) { return !wanted(i); }), queue_.end());
+
+   // nearest first; index itself jumps the queue
+   for (U32 d = depth_ + 1; d-- > 0; ) {
+      std::size_t i = (index + d) % paths_.size();
+      if (slots_.find(i) == slots_.end()) {
+         slots_[i];
+         if (d == 0) {
+            queue_.push_front(i);
+         } else {
+            queue_.insert(std::find_if(queue_.begin(), queue_.end(), [&](std::size_t q) { return (q + paths_.size() - index) % paths_.size() > d; }), i);
+         }
+      }
+   }
+   work_cv_.notify_all();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ImagePrefetcher::work_() {
+   std::unique_lock<std::mutex> lock(mutex_);
+   for (;;) {
+      work_cv_.wait(lock, [this]() {
+         return stopping_ || !queue_.empty();
+      });
+      if (stopping_) {
+         return;
+      }
+
+      std::size_t index = queue_.front();
+      queue_.pop_front();
+      auto it = slots_.find(index);
+      if (it == slots_.end() || it->second.state != SlotState::queued) {
+         continue;
+      }
+      it->second.state = SlotState::loading;
+      if (active_++ == 0) {
+         busy_start_ = ts_now();
+      }
+      lock.unlock();
+
+      LoadedImage image;
+      std::exception_ptr error;
+      U64 file_bytes = 0;
+      TU start = ts_now();
+      try {
+         file_bytes = U64(fs::file_size(paths_[index]));
+         load_image(paths_[index], opaque_, nullptr, image);
+      } catch (...) {
+         error = std::current_exception();
+      }
+      TU end = ts_now();
+      F64 seconds = tu_to_seconds(end - start);
+      if (stats_) {
+         stats_->record(Phase::decode, seconds);
+      }
+
+      lock.lock();
+      if (--active_ == 0) {
+         busy_seconds_ += tu_to_seconds(end - busy_start_);
+      }
+      if (!error) {
+         ++images_;
+         file_bytes_ += file_bytes;
+         image_bytes_ += U64(image.view.size());
+         decode_seconds_ += seconds;
+      }
+
+      // the slot may have been dropped (or dropped and queued again) meanwhile
+      it = slots_.find(index);
+      if (it != slots_.end() && it->second.state == SlotState::loading) {
+         it->second.state = error ? SlotState::failed : SlotState::ready;
+         it->second.image = std::move(image);
+         it->second.error = error;
+         ready_cv_.notify_all();
+      } else {
+         lock.unlock();
+         image = LoadedImage(); // don't free pixels while holding the lock
+         lock.lock();
+      }
+   }
+}
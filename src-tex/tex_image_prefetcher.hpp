@@ -0,0 +1,93 @@
+#pragma once
+#ifndef TEX_IMAGE_PREFETCHER_HPP_
+#define TEX_IMAGE_PREFETCHER_HPP_
+
+#include "tex_image_cache.hpp"
+#include "tex_phase_stats.hpp"
+#include <be/core/filesystem.hpp>
+#include <be/core/time.hpp>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// Loads the images following the one being shown on background threads, so
+// stepping through a list of files doesn't wait for decoding.  At most depth
+// loaded images are held at once, besides the one handed out by take().
+// The list wraps around.
+class ImagePrefetcher final {
+public:
+   // threads = 0 uses min(depth, hardware threads).  Decode times are
+   // recorded to stats as Phase::decode, if set.
+   ImagePrefetcher(std::vector<be::Path> paths, be::U32 depth, be::U32 threads, bool opaque, PhaseStats* stats = nullptr);
+   ~ImagePrefetcher();
+
+   ImagePrefetcher(const ImagePrefetcher&) = delete;
+   ImagePrefetcher& operator=(const ImagePrefetcher&) = delete;
+
+   const std::vector<be::Path>& paths() const;
+   be::U32 depth() const;
+   be::U32 threads() const;
+
+   // Starts loading index and the depth images after it.
+   void prefetch(std::size_t index);
+
+   // Like prefetch(), then waits for index to finish loading and hands it
+   // over.  hit is set if it had already loaded.  Rethrows any error from
+   // loading.
+   void take(std::size_t index, LoadedImage& image, bool* hit = nullptr);
+
+   be::U64 hits() const;
+   be::U64 misses() const;
+   be::U64 images() const; // loaded successfully, including any never taken
+   be::U64 file_bytes() const;
+   be::U64 image_bytes() const; // pixel data after decoding
+   be::F64 decode_seconds() const; // summed over threads
+   be::F64 busy_seconds() const; // wall time with at least one load in progress
+
+private:
+   enum class SlotState {
+      queued,
+      loading,
+      ready,
+      failed
+   };
+
+   struct Slot {
+      SlotState state = SlotState::queued;
+      LoadedImage image;
+      std::exception_ptr error;
+   };
+
+   void schedule_(std::size_t index);
+   void work_();
+
+   std::vector<be::Path> paths_;
+   be::U32 depth_;
+   bool opaque_;
+   PhaseStats* stats_;
+
+   mutable std::mutex mutex_;
+   std::condition_variable work_cv_;
+   std::condition_variable ready_cv_;
+   std::map<std::size_t, Slot> slots_;
+   std::deque<std::size_t> queue_;
+   bool stopping_ = false;
+   std::vector<std::thread> workers_;
+
+   be::U32 active_ = 0;
+   be::TU busy_start_;
+   be::U64 hits_ = 0;
+   be::U64 misses_ = 0;
+   be::U64 images_ = 0;
+   be::U64 file_bytes_ = 0;
+   be::U64 image_bytes_ = 0;
+   be::F64 decode_seconds_ = 0;
+   be::F64 busy_seconds_ = 0;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#pragma once
+#ifndef TEX_IMAGE_ROWS_HPP_
+#define TEX_IMAGE_ROWS_HPP_
+
+#include "tex_tile_scheduler.hpp"
+#include <be/core/glm.hpp>
+#include <be/gfx/tex/texture.hpp>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// A contiguous run of pixels within one line of an image.  data points at
+// the start of the line; lines are addressed using the view's line span, so
+// any padding required by the storage's line alignment is skipped.
+struct ImageRow {
+   be::gfx::tex::ImageView* view;
+   be::UC* data;
+   be::I32 y;
+   be::I32 x_begin;
+   be::I32 x_end;
+   std::size_t stride; // bytes between adjacent pixels
+   be::U32 tile;
+
+   be::I32 width() const {
+      return x_end - x_begin;
+   }
+
+   be::UC* begin() const {
+      return data + std::size_t(x_begin) * stride;
+   }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+inline ImageRow image_row(be::gfx::tex::ImageView& view, be::I32 y, be::I32 x_begin, be::I32 x_end, be::U32 tile = 0) {
+   ImageRow row;
+   row.view = &view;
+   row.data = view.data() + std::size_t(y) * view.line_span();
+   row.y = y;
+   row.x_begin = x_begin;
+   row.x_end = x_end;
+   row.stride = view.format().block_size();
+   row.tile = tile;
+   return row;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Per-thread temporary storage for row kernels; each slot is a separate
+// buffer that is reused across rows.
+inline be::F32* row_scratch(std::size_t slot, std::size_t count) {
+   thread_local std::vector<be::F32> buffers[4];
+   std::vector<be::F32>& buffer = buffers[slot];
+   if (buffer.size() < count) {
+      buffer.resize(count);
+   }
+   return buffer.data();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename F>
+void visit_image_rows(be::gfx::tex::ImageView& view, F func) {
+   be::ivec2 dim = be::ivec2(view.dim());
+   for (be::I32 y = 0; y < dim.y; ++y) {
+      func(image_row(view, y, 0, dim.x));
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Rows belonging to the same tile are always visited in order on one thread.
+template <typename F>
+void visit_image_rows_parallel(TileScheduler& scheduler, be::gfx::tex::ImageView view, F func) {
+   be::ivec2 dim = be::ivec2(view.dim());
+   be::ivec2 tile_dim = choose_tile_dim(dim, view.format().block_size());
+   scheduler.run(dim, tile_dim, [&](const Tile& tile) {
+      for (be::I32 y = tile.offset.y; y < tile.offset.y + tile.dim.y; ++y) {
+         func(image_row(view, y, tile.offset.x, tile.offset.x + tile.dim.x, tile.index));
+      }
+   });
+}
+
+#endif
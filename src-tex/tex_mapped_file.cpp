@@ -0,0 +1,187 @@
+#include "tex_mapped_file.hpp"
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef PSAPI_VERSION
+#define PSAPI_VERSION 2 // K32GetProcessMemoryInfo lives in kernel32
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace be;
+
+///////////////////////////////////////////////////////////////////////////////
+MappedFile::~MappedFile() {
+   close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+MappedFile::MappedFile(MappedFile&& other) noexcept
+   : data_(other.data_),
+     size_(other.size_)
+#ifdef _WIN32
+     , file_(other.file_),
+     mapping_(other.mapping_)
+#endif
+{
+   other.data_ = nullptr;
+   other.size_ = 0;
+#ifdef _WIN32
+   other.file_ = nullptr;
+   other.mapping_ = nullptr;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+   if (this != &other) {
+      close();
+      std::swap(data_, other.data_);
+      std::swap(size_, other.size_);
+#ifdef _WIN32
+      std::swap(file_, other.file_);
+      std::swap(mapping_, other.mapping_);
+#endif
+   }
+   return *this;
+}
+
+#ifdef _WIN32
+
+///////////////////////////////////////////////////////////////////////////////
+bool MappedFile::open(const Path& path) {
+   close();
+
+   HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+   if (file == INVALID_HANDLE_VALUE) {
+      return false;
+   }
+
+   LARGE_INTEGER size;
+   if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0) {
+      CloseHandle(file);
+      return false;
+   }
+
+   HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+   if (!mapping) {
+      CloseHandle(file);
+      return false;
+   }
+
+   void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+   if (!data) {
+      CloseHandle(mapping);
+      CloseHandle(file);
+      return false;
+   }
+
+   file_ = file;
+   mapping_ = mapping;
+   data_ = static_cast<const UC*>(data);
+   size_ = std::size_t(size.QuadPart);
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void MappedFile::close() {
+   if (data_) {
+      UnmapViewOfFile(data_);
+      CloseHandle(mapping_);
+      CloseHandle(file_);
+   }
+   data_ = nullptr;
+   size_ = 0;
+   mapping_ = nullptr;
+   file_ = nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t peak_resident_bytes() {
+   PROCESS_MEMORY_COUNTERS counters;
+   if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+      return std::size_t(counters.PeakWorkingSetSize);
+   }
+   return 0;
+}
+
+#else
+
+///////////////////////////////////////////////////////////////////////////////
+bool MappedFile::open(const Path& path) {
+   close();
+
+   int fd = ::open(path.c_str(), O_RDONLY);
+   if (fd < 0) {
+      return false;
+   }
+
+   struct stat st;
+   if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+      ::close(fd);
+      return false;
+   }
+
+   void* data = mmap(nullptr, std::size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+   ::close(fd); // the mapping keeps its own reference to the file
+   if (data == MAP_FAILED) {
+      return false;
+   }
+
+   data_ = static_cast<const UC*>(data);
+   size_ = std::size_t(st.st_size);
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void MappedFile::close() {
+   if (data_) {
+      munmap(const_cast<UC*>(data_), size_);
+   }
+   data_ = nullptr;
+   size_ = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t peak_resident_bytes() {
+   struct rusage usage;
+   if (getrusage(RUSAGE_SELF, &usage) != 0) {
+      return 0;
+   }
+#ifdef __APPLE__
+   return std::size_t(usage.ru_maxrss);
+#else
+   return std::size_t(usage.ru_maxrss) * 1024;
+#endif
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+const UC* MappedFile::data() const {
+   return data_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t MappedFile::size() const {
+   return size_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+MappedFile::operator bool() const {
+   return data_ != nullptr;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#ifndef TEX_MAPPED_FILE_HPP_
+#define TEX_MAPPED_FILE_HPP_
+
+#include <be/core/filesystem.hpp>
+
+///////////////////////////////////////////////////////////////////////////////
+// Read-only view of a whole file.  Pages are only loaded when touched, and
+// are shared with the OS file cache instead of being copied into the heap.
+class MappedFile final {
+public:
+   MappedFile() = default;
+   ~MappedFile();
+
+   MappedFile(MappedFile&& other) noexcept;
+   MappedFile& operator=(MappedFile&& other) noexcept;
+   MappedFile(const MappedFile&) = delete;
+   MappedFile& operator=(const MappedFile&) = delete;
+
+   // Returns false if the file can't be opened or mapped (or is empty).
+   bool open(const be::Path& path);
+   void close();
+
+   const be::UC* data() const;
+   std::size_t size() const;
+   explicit operator bool() const;
+
+private:
+   const be::UC* data_ = nullptr;
+   std::size_t size_ = 0;
+#ifdef _WIN32
+   void* file_ = nullptr;
+   void* mapping_ = nullptr;
+#endif
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Peak resident set size / working set of this process, or 0 if unknown.
+std::size_t peak_resident_bytes();
+
+#endif
@@ -0,0 +1,84 @@
+#include "tex_mapped_image.hpp"
+#include <be/gfx/tex/image_format_gl.hpp>
+#include <cstring>
+
+using namespace be;
+using namespace be::gfx::tex;
+
+namespace {
+
+constexpr UC ktx_identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+constexpr U32 ktx_native_endian = 0x04030201;
+
+///////////////////////////////////////////////////////////////////////////////
+struct KtxHeader {
+   UC identifier[12];
+   U32 endianness;
+   U32 gl_type;
+   U32 gl_type_size;
+   U32 gl_format;
+   U32 gl_internal_format;
+   U32 gl_base_internal_format;
+   U32 pixel_width;
+   U32 pixel_height;
+   U32 pixel_depth;
+   U32 array_elements;
+   U32 faces;
+   U32 mipmap_levels;
+   U32 key_value_bytes;
+};
+
+static_assert(sizeof(KtxHeader) == 64, "Unexpected KTX header padding");
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+bool map_image(const Path& path, MappedImage& image) {
+   MappedFile file;
+   if (!file.open(path) || file.size() < sizeof(KtxHeader)) {
+      return false;
+   }
+
+   KtxHeader header;
+   std::memcpy(&header, file.data(), sizeof(KtxHeader));
+   if (std::memcmp(header.identifier, ktx_identifier, sizeof(ktx_identifier)) != 0 ||
+       header.endianness != ktx_native_endian ||
+       header.gl_type == 0 || header.gl_format == 0 || // compressed
+       header.pixel_width == 0 || header.pixel_height == 0 ||
+       header.pixel_depth > 1 || header.array_elements > 1 || header.faces != 1) {
+      return false;
+   }
+
+   ImageFormat format = canonical_format(header.gl_internal_format);
+   auto gl = to_gl_format(format);
+   if (gl.data_format != header.gl_format || gl.data_type != header.gl_type) {
+      return false; // e.g. BGRA data; needs a real conversion
+   }
+
+   std::size_t offset = sizeof(KtxHeader) + std::size_t(header.key_value_bytes);
+   if (offset + sizeof(U32) > file.size()) {
+      return false;
+   }
+   U32 image_size;
+   std::memcpy(&image_size, file.data() + offset, sizeof(U32));
+   offset += sizeof(U32);
+
+   // KTX rows are padded to 4 bytes; only accept files where that padding
+   // agrees with the view's own line span.
+   std::size_t row_bytes = std::size_t(header.pixel_width) * format.block_size();
+   std::size_t line_span = (row_bytes + 3) & ~std::size_t(3);
+   std::size_t size = line_span * header.pixel_height;
+   if (image_size < size || offset + size > file.size()) {
+      return false;
+   }
+
+   ivec3 dim(I32(header.pixel_width), I32(header.pixel_height), 1);
+   ImageView view(format, dim, const_cast<UC*>(file.data() + offset), size);
+   if (view.line_span() != line_span) {
+      return false;
+   }
+
+   image.file = std::move(file);
+   image.view = view;
+   return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#ifndef TEX_MAPPED_IMAGE_HPP_
+#define TEX_MAPPED_IMAGE_HPP_
+
+#include "tex_mapped_file.hpp"
+#include <be/gfx/tex/image_view.hpp>
+
+///////////////////////////////////////////////////////////////////////////////
+// An ImageView pointing directly into a mapped file.  The view must be
+// treated as read-only and is valid until the MappedImage is closed.
+struct MappedImage {
+   MappedFile file;
+   be::gfx::tex::ImageView view;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Maps the first image of an uncompressed, native-endian 2D KTX (v1) file
+// whose pixel layout matches the canonical format for its internal format.
+// Returns false for anything else, so the caller can fall back to
+// TextureReader.
+bool map_image(const be::Path& path, MappedImage& image);
+
+#endif
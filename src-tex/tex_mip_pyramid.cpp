@@ -0,0 +1,322 @@
+#include "tex_mip_pyramid.hpp"
+#include "tex_channel_ops.hpp"
+#include <be/gfx/tex/image_format_gl.hpp>
+#include <be/gfx/tex/pixel_access_norm.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+using namespace be;
+using namespace be::gfx::tex;
+
+namespace {
+
+constexpr char pyramid_magic[8] = { 'B', 'E', 'T', 'E', 'X', 'P', 'Y', 'R' };
+constexpr U32 pyramid_version = 1;
+
+///////////////////////////////////////////////////////////////////////////////
+struct PyramidHeader {
+   char magic[8];
+   U32 version;
+   U32 gl_internal_format;
+   U32 tile_size;
+   U32 levels;
+   U64 source_bytes;
+};
+
+static_assert(sizeof(PyramidHeader) == 32, "Unexpected pyramid header padding");
+
+///////////////////////////////////////////////////////////////////////////////
+struct PyramidLevelEntry {
+   U32 width;
+   U32 height;
+   U64 offset;
+};
+
+static_assert(sizeof(PyramidLevelEntry) == 16, "Unexpected pyramid level padding");
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<MipPyramid::Level> make_levels(ivec2 dim, I32 tile_size, std::size_t tile_bytes) {
+   std::vector<MipPyramid::Level> levels;
+   for (;;) {
+      MipPyramid::Level level;
+      level.dim = dim;
+      level.tiles = (dim + tile_size - 1) / tile_size;
+      level.offset = 0;
+      levels.push_back(level);
+      if (dim.x <= tile_size && dim.y <= tile_size) {
+         break;
+      }
+      dim = (dim + 1) / 2;
+   }
+
+   std::size_t offset = sizeof(PyramidHeader) + levels.size() * sizeof(PyramidLevelEntry);
+   for (auto& level : levels) {
+      level.offset = offset;
+      offset += std::size_t(level.tiles.x) * std::size_t(level.tiles.y) * tile_bytes;
+   }
+   return levels;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void fill_source_tile(const ImageView& source, ivec2 origin, ImageView& tile) {
+   ivec2 dim = ivec2(source.dim());
+   I32 size = tile.dim().x;
+
+   if (source.format() == tile.format()) {
+      std::size_t block = tile.format().block_size();
+      I32 width = std::min(size, dim.x - origin.x);
+      for (I32 y = 0; y < size; ++y) {
+         I32 sy = std::min(origin.y + y, dim.y - 1);
+         const UC* src = source.data() + std::size_t(sy) * source.line_span() + std::size_t(origin.x) * block;
+         UC* dest = tile.data() + std::size_t(y) * tile.line_span();
+         std::memcpy(dest, src, std::size_t(width) * block);
+         for (I32 x = width; x < size; ++x) {
+            std::memcpy(dest + std::size_t(x) * block, dest + std::size_t(width - 1) * block, block);
+         }
+      }
+      return;
+   }
+
+   auto get = get_pixel_norm_func<ivec2>(source);
+   auto put = put_pixel_norm_func<ivec2>(tile);
+   for (ivec2 pc(0); pc.y < size; ++pc.y) {
+      for (pc.x = 0; pc.x < size; ++pc.x) {
+         put(tile, pc, get(source, glm::min(origin + pc, dim - 1)));
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename T, typename F>
+void average_channels(const UC* const* src, UC* dest, std::size_t channels, F average) {
+   for (std::size_t c = 0; c < channels; ++c) {
+      T v[4];
+      for (std::size_t i = 0; i < 4; ++i) {
+         std::memcpy(&v[i], src[i] + c * sizeof(T), sizeof(T));
+      }
+      T result = average(v[0], v[1], v[2], v[3]);
+      std::memcpy(dest + c * sizeof(T), &result, sizeof(T));
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// children[j * 2 + i] is child tile (2 tile.x + i, 2 tile.y + j) of the
+// previous level, or the nearest existing one at the edges.
+void downsample_tile(const MipPyramid::Level& prev, const ImageView* children, ivec2 tile, ImageView& dest, const MipPyramid::Level& level) {
+   I32 size = dest.dim().x;
+   std::size_t block = dest.format().block_size();
+   ivec2 origin = tile * size;
+   ivec2 child_origin = origin * 2;
+
+   ChannelLayout layout;
+   bool direct = channel_layout(dest.format(), layout) && layout.type != ChannelType::float16;
+   // sRGB codes are averaged in linear light; alpha is already linear
+   bool srgb = direct && layout.type == ChannelType::unorm8 && dest.format().colorspace() == Colorspace::srgb;
+   std::size_t color_channels = srgb ? std::min<std::size_t>(layout.channels, 3) : 0;
+   auto get = get_pixel_norm_func<ivec2>(children[0]);
+   auto put = put_pixel_norm_func<ivec2>(dest);
+
+   for (ivec2 pc(0); pc.y < size; ++pc.y) {
+      for (pc.x = 0; pc.x < size; ++pc.x) {
+         ivec2 p = glm::min(origin + pc, level.dim - 1) * 2;
+         const UC* src[4];
+         ivec2 src_pc[4];
+         const ImageView* src_view[4];
+         for (I32 i = 0; i < 4; ++i) {
+            ivec2 q = glm::min(p + ivec2(i & 1, i >> 1), prev.dim - 1) - child_origin;
+            const ImageView& child = children[(q.y / size) * 2 + q.x / size];
+            src_pc[i] = ivec2(q.x % size, q.y % size);
+            src_view[i] = &child;
+            src[i] = child.data() + std::size_t(src_pc[i].y) * child.line_span() + std::size_t(src_pc[i].x) * block;
+         }
+
+         UC* out = dest.data() + std::size_t(pc.y) * dest.line_span() + std::size_t(pc.x) * block;
+         if (!direct) {
+            vec4 sum = get(*src_view[0], src_pc[0]) + get(*src_view[1], src_pc[1]) + get(*src_view[2], src_pc[2]) + get(*src_view[3], src_pc[3]);
+            put(dest, pc, sum * 0.25f);
+         } else if (srgb) {
+            average_channels<U8>(src, out, color_channels, [](U8 a, U8 b, U8 c, U8 d) {
+               return linear_to_srgb8((srgb8_to_linear(a) + srgb8_to_linear(b) + srgb8_to_linear(c) + srgb8_to_linear(d)) * 0.25f);
+            });
+            if (color_channels < layout.channels) {
+               out[3] = U8((U32(src[0][3]) + src[1][3] + src[2][3] + src[3][3] + 2) >> 2);
+            }
+         } else if (layout.type == ChannelType::unorm8) {
+            average_channels<U8>(src, out, layout.channels, [](U32 a, U32 b, U32 c, U32 d) { return U8((a + b + c + d + 2) >> 2); });
+         } else if (layout.type == ChannelType::unorm16) {
+            average_channels<U16>(src, out, layout.channels, [](U32 a, U32 b, U32 c, U32 d) { return U16((a + b + c + d + 2) >> 2); });
+         } else {
+            average_channels<F32>(src, out, layout.channels, [](F32 a, F32 b, F32 c, F32 d) { return (a + b + c + d) * 0.25f; });
+         }
+      }
+   }
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+bool MipPyramid::build(TileScheduler& scheduler, const ImageView& source, const ImageFormat& format, I32 tile_size, U64 source_bytes, const Path& path) {
+   std::size_t tile_bytes = std::size_t(tile_size) * std::size_t(tile_size) * format.block_size();
+   std::vector<Level> levels = make_levels(ivec2(source.dim()), tile_size, tile_bytes);
+
+   std::ofstream os(path.string(), std::ios::binary | std::ios::trunc);
+   PyramidHeader header;
+   std::memcpy(header.magic, pyramid_magic, sizeof(pyramid_magic));
+   header.version = pyramid_version;
+   header.gl_internal_format = U32(to_gl_format(format).internal_format);
+   header.tile_size = U32(tile_size);
+   header.levels = U32(levels.size());
+   header.source_bytes = source_bytes;
+   os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+   for (auto& level : levels) {
+      PyramidLevelEntry entry { U32(level.dim.x), U32(level.dim.y), U64(level.offset) };
+      os.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+   }
+
+   // tiles are built a batch at a time so memory use doesn't depend on the
+   // image size; each level reads the previous one back through a mapping
+   const U32 batch = std::max(scheduler.threads(), 1u) * 4;
+   std::vector<UC> buffer(batch * tile_bytes);
+   MappedFile prev_file;
+   for (std::size_t l = 0; l < levels.size() && os; ++l) {
+      const Level& level = levels[l];
+      U32 count = U32(level.tiles.x * level.tiles.y);
+
+      if (l > 0) {
+         os.flush();
+         prev_file.close();
+         if (!os || !prev_file.open(path)) {
+            return false;
+         }
+      }
+
+      for (U32 begin = 0; begin < count; begin += batch) {
+         U32 n = std::min(batch, count - begin);
+         scheduler.run(ivec2(I32(n), 1), ivec2(1), [&](const Tile& task) {
+            U32 index = begin + U32(task.offset.x);
+            ivec2 tile(I32(index) % level.tiles.x, I32(index) / level.tiles.x);
+            ImageView dest(format, ivec3(tile_size, tile_size, 1), buffer.data() + std::size_t(task.offset.x) * tile_bytes, tile_bytes);
+            if (l == 0) {
+               fill_source_tile(source, tile * tile_size, dest);
+               return;
+            }
+
+            const Level& prev = levels[l - 1];
+            ImageView children[4];
+            for (I32 i = 0; i < 4; ++i) {
+               ivec2 child = glm::min(tile * 2 + ivec2(i & 1, i >> 1), prev.tiles - 1);
+               std::size_t offset = prev.offset + (std::size_t(child.y) * std::size_t(prev.tiles.x) + std::size_t(child.x)) * tile_bytes;
+               children[i] = ImageView(format, ivec3(tile_size, tile_size, 1), const_cast<UC*>(prev_file.data() + offset), tile_bytes);
+            }
+            downsample_tile(prev, children, tile, dest, level);
+         });
+         os.write(reinterpret_cast<const char*>(buffer.data()), std::streamsize(std::size_t(n) * tile_bytes));
+      }
+   }
+
+   os.close();
+   return bool(os);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool MipPyramid::open(const Path& path) {
+   close();
+
+   MappedFile file;
+   if (!file.open(path) || file.size() < sizeof(PyramidHeader)) {
+      return false;
+   }
+
+   PyramidHeader header;
+   std::memcpy(&header, file.data(), sizeof(header));
+   if (std::memcmp(header.magic, pyramid_magic, sizeof(pyramid_magic)) != 0 ||
+       header.version != pyramid_version ||
+       header.tile_size == 0 || header.levels == 0 ||
+       file.size() < sizeof(PyramidHeader) + std::size_t(header.levels) * sizeof(PyramidLevelEntry)) {
+      return false;
+   }
+
+   ImageFormat format = canonical_format(header.gl_internal_format);
+   std::size_t tile_bytes = std::size_t(header.tile_size) * std::size_t(header.tile_size) * format.block_size();
+   std::vector<Level> levels;
+   for (U32 i = 0; i < header.levels; ++i) {
+      PyramidLevelEntry entry;
+      std::memcpy(&entry, file.data() + sizeof(PyramidHeader) + i * sizeof(PyramidLevelEntry), sizeof(entry));
+      Level level;
+      level.dim = ivec2(I32(entry.width), I32(entry.height));
+      level.tiles = (level.dim + I32(header.tile_size) - 1) / I32(header.tile_size);
+      level.offset = std::size_t(entry.offset);
+      if (entry.width == 0 || entry.height == 0 ||
+          level.offset + std::size_t(level.tiles.x) * std::size_t(level.tiles.y) * tile_bytes > file.size()) {
+         return false; // truncated, e.g. an interrupted build
+      }
+      levels.push_back(level);
+   }
+
+   file_ = std::move(file);
+   path_ = path;
+   format_ = format;
+   tile_size_ = I32(header.tile_size);
+   source_bytes_ = header.source_bytes;
+   levels_ = std::move(levels);
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void MipPyramid::close() {
+   file_.close();
+   levels_.clear();
+   tile_size_ = 0;
+   source_bytes_ = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+MipPyramid::operator bool() const {
+   return bool(file_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool MipPyramid::stale(const Path& source_path, const ImageFormat& format, I32 tile_size) const {
+   return !file_ || format_ != format || tile_size_ != tile_size ||
+      U64(fs::file_size(source_path)) != source_bytes_ ||
+      fs::last_write_time(path_) < fs::last_write_time(source_path);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const Path& MipPyramid::path() const {
+   return path_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const ImageFormat& MipPyramid::format() const {
+   return format_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+I32 MipPyramid::tile_size() const {
+   return tile_size_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t MipPyramid::tile_bytes() const {
+   return std::size_t(tile_size_) * std::size_t(tile_size_) * format_.block_size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U32 MipPyramid::levels() const {
+   return U32(levels_.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const MipPyramid::Level& MipPyramid::level(U32 index) const {
+   return levels_[index];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ImageView MipPyramid::tile(U32 level, ivec2 tile) const {
+   const Level& l = levels_[level];
+   std::size_t index = std::size_t(tile.y) * std::size_t(l.tiles.x) + std::size_t(tile.x);
+   UC* data = const_cast<UC*>(file_.data() + l.offset + index * tile_bytes());
+   return ImageView(format_, ivec3(tile_size_, tile_size_, 1), data, tile_bytes());
+}
@@ -0,0 +1,67 @@
+#pragma once
+#ifndef TEX_MIP_PYRAMID_HPP_
+#define TEX_MIP_PYRAMID_HPP_
+
+#include "tex_mapped_file.hpp"
+#include "tex_tile_scheduler.hpp"
+#include <be/core/glm.hpp>
+#include <be/core/filesystem.hpp>
+#include <be/gfx/tex/image_view.hpp>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// A mip pyramid of square tiles stored in one file, so that viewing an image
+// much larger than memory only touches the tiles on screen.  Level 0 is the
+// source image; each further level halves the previous one (rounding up)
+// with a 2x2 box filter (in linear light for sRGB formats), until a level
+// fits in a single tile.  Tiles on the
+// right and bottom edges are padded by repeating the last column/row.
+//
+// The file is memory-mapped once built, so tiles are read on demand.
+class MipPyramid final {
+public:
+   struct Level {
+      be::ivec2 dim;
+      be::ivec2 tiles;
+      std::size_t offset; // of the first tile, in bytes from the start of the file
+   };
+
+   static constexpr be::I32 default_tile_size = 256;
+
+   // Writes the pyramid of source, converted to format, to path.  Tiles are
+   // built in parallel, one level at a time, and written in order.
+   // source_bytes is recorded for stale() and should be the size of the
+   // source file.  Returns false if the file can't be written.
+   static bool build(TileScheduler& scheduler, const be::gfx::tex::ImageView& source, const be::gfx::tex::ImageFormat& format,
+                     be::I32 tile_size, be::U64 source_bytes, const be::Path& path);
+
+   // Returns false if the file is missing or isn't a valid pyramid.
+   bool open(const be::Path& path);
+   void close();
+   explicit operator bool() const;
+
+   // True if the pyramid was built with different settings, from a source
+   // with a different size, or before the source was last modified.
+   bool stale(const be::Path& source_path, const be::gfx::tex::ImageFormat& format, be::I32 tile_size) const;
+
+   const be::Path& path() const;
+   const be::gfx::tex::ImageFormat& format() const;
+   be::I32 tile_size() const;
+   std::size_t tile_bytes() const;
+   be::U32 levels() const;
+   const Level& level(be::U32 index) const;
+
+   // Read-only view of one tile, pointing into the mapped file.  Valid
+   // until close().
+   be::gfx::tex::ImageView tile(be::U32 level, be::ivec2 tile) const;
+
+private:
+   MappedFile file_;
+   be::Path path_;
+   be::gfx::tex::ImageFormat format_;
+   be::I32 tile_size_ = 0;
+   be::U64 source_bytes_ = 0;
+   std::vector<Level> levels_;
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "tex_noise.hpp"
+#include <algorithm>
+
+using namespace be;
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+U64 rotl(U64 x, int k) {
+   return (x << k) | (x >> (64 - k));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 splitmix64(U64& x) {
+   U64 z = (x += 0x9e3779b97f4a7c15ull);
+   z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+   z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+   return z ^ (z >> 31);
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+NoiseStream::NoiseStream()
+   : NoiseStream(0) { }
+
+///////////////////////////////////////////////////////////////////////////////
+NoiseStream::NoiseStream(U64 seed) {
+   s_[0] = splitmix64(seed);
+   s_[1] = splitmix64(seed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 NoiseStream::operator()() {
+   const U64 s0 = s_[0];
+   U64 s1 = s_[1];
+   const U64 result = s0 + s1;
+   s1 ^= s0;
+   s_[0] = rotl(s0, 24) ^ s1 ^ (s1 << 16);
+   s_[1] = rotl(s1, 37);
+   return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void NoiseStream::jump() {
+   static const U64 jump_poly[] = { 0xdf900294d8f554a5ull, 0x170865df4b3201fcull };
+   U64 s0 = 0;
+   U64 s1 = 0;
+   for (U64 poly : jump_poly) {
+      for (int b = 0; b < 64; ++b) {
+         if (poly & (U64(1) << b)) {
+            s0 ^= s_[0];
+            s1 ^= s_[1];
+         }
+         (*this)();
+      }
+   }
+   s_[0] = s0;
+   s_[1] = s1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void NoiseStream::fill_unorm(F32* out, std::size_t count) {
+   const std::size_t batch_size = 64;
+   U32 bits[batch_size];
+   while (count > 0) {
+      std::size_t n = std::min(count, batch_size);
+      for (std::size_t i = 0; i < n; i += 2) {
+         U64 r = (*this)();
+         bits[i] = U32(r);
+         bits[i + 1] = U32(r >> 32);
+      }
+      // kept separate from the generator loop so it vectorizes;
+      // the top 24 bits of each half map exactly onto the float mantissa
+      for (std::size_t i = 0; i < n; ++i) {
+         out[i] = F32(bits[i] >> 8) * (1.f / 16777216.f);
+      }
+      out += n;
+      count -= n;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void NoiseEngine::seed(U64 seed) {
+   seed_ = seed;
+   streams_.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void NoiseEngine::prepare(U32 tiles) {
+   if (streams_.size() == tiles) {
+      return;
+   }
+
+   streams_.clear();
+   streams_.reserve(tiles);
+   NoiseStream stream(seed_);
+   for (U32 i = 0; i < tiles; ++i) {
+      streams_.push_back(stream);
+      stream.jump();
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+NoiseStream& NoiseEngine::stream(U32 tile) {
+   return streams_[tile];
+}
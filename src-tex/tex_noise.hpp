@@ -0,0 +1,41 @@
+#pragma once
+#ifndef TEX_NOISE_HPP_
+#define TEX_NOISE_HPP_
+
+#include <be/core/be.hpp>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// xoroshiro128+ (24, 16, 37) with support for jumping ahead 2^64 steps, so
+// that each tile of an image can draw from its own non-overlapping stream.
+class NoiseStream final {
+public:
+   NoiseStream();
+   explicit NoiseStream(be::U64 seed);
+
+   be::U64 operator()();
+   void jump();
+
+   // Fills out with uniformly distributed values in [0, 1).
+   void fill_unorm(be::F32* out, std::size_t count);
+
+private:
+   be::U64 s_[2];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Hands out one stream per tile.  Streams are derived by repeatedly jumping
+// a stream seeded from the engine seed, so tile N always sees the same
+// sequence no matter which thread processes it or in what order.
+class NoiseEngine final {
+public:
+   void seed(be::U64 seed);
+   void prepare(be::U32 tiles);
+   NoiseStream& stream(be::U32 tile);
+
+private:
+   be::U64 seed_ = 0;
+   std::vector<NoiseStream> streams_;
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include "tex_phase_stats.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+using namespace be;
+
+namespace {
+
+constexpr F64 sub_buckets = 16.0;
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t bucket_index(F64 seconds, std::size_t buckets) {
+   F64 ns = seconds * 1e9;
+   if (!(ns > 1.0)) {
+      return 0;
+   }
+   return std::min(std::size_t(std::log2(ns) * sub_buckets), buckets - 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+F64 bucket_value(std::size_t index) {
+   // geometric middle of the bucket
+   return std::exp2((F64(index) + 0.5) / sub_buckets) * 1e-9;
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+const char* phase_name(Phase phase) {
+   switch (phase) {
+      case Phase::setup:    return "setup";
+      case Phase::decode:   return "decode";
+      case Phase::generate: return "generate";
+      case Phase::convert:  return "convert";
+      case Phase::upload:   return "upload";
+      case Phase::swap:     return "swap";
+      default:              return "?";
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+PhaseStats::PhaseStats() {
+   clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PhaseStats::record(Phase phase, F64 seconds) {
+   std::lock_guard<std::mutex> lock(mutex_);
+   Histogram& h = phases_[std::size_t(phase)];
+   ++h.counts[bucket_index(seconds, buckets)];
+   ++h.count;
+   h.total += seconds;
+   h.max = std::max(h.max, seconds);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+PhaseSummary PhaseStats::summary(Phase phase) const {
+   std::lock_guard<std::mutex> lock(mutex_);
+   const Histogram& h = phases_[std::size_t(phase)];
+
+   PhaseSummary result = { h.count, 0, 0, 0, 0, h.max };
+   if (h.count == 0) {
+      return result;
+   }
+   result.mean = h.total / F64(h.count);
+
+   const F64 quantiles[] = { 0.5, 0.95, 0.99 };
+   F64* outputs[] = { &result.p50, &result.p95, &result.p99 };
+   for (std::size_t q = 0; q < 3; ++q) {
+      U64 rank = std::max(U64(1), U64(std::ceil(quantiles[q] * F64(h.count))));
+      U64 seen = 0;
+      for (std::size_t i = 0; i < buckets; ++i) {
+         seen += h.counts[i];
+         if (seen >= rank) {
+            *outputs[q] = std::min(bucket_value(i), h.max);
+            break;
+         }
+      }
+   }
+   return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PhaseStats::clear() {
+   std::lock_guard<std::mutex> lock(mutex_);
+   for (auto& h : phases_) {
+      h.counts.fill(0);
+      h.count = 0;
+      h.total = 0;
+      h.max = 0;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PhaseStats::clear(Phase phase) {
+   std::lock_guard<std::mutex> lock(mutex_);
+   Histogram& h = phases_[std::size_t(phase)];
+   h.counts.fill(0);
+   h.count = 0;
+   h.total = 0;
+   h.max = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PhaseStats::write(const Path& path, const S& label) const {
+   std::ofstream os(path.string(), std::ios::trunc);
+   if (!os) {
+      throw fs::filesystem_error("Could not open stats file", path, std::make_error_code(std::errc::io_error));
+   }
+
+   bool csv = path.extension() == ".csv";
+   if (csv) {
+      os << "label,phase,count,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n";
+   } else {
+      os << "{\n   \"label\": \"" << label << "\",\n   \"phases\": {";
+   }
+
+   bool first = true;
+   for (std::size_t i = 0; i < std::size_t(Phase::count_); ++i) {
+      Phase phase = Phase(i);
+      PhaseSummary s = summary(phase);
+      if (csv) {
+         os << label << ',' << phase_name(phase) << ',' << s.count << ','
+            << s.mean * 1000.0 << ',' << s.p50 * 1000.0 << ',' << s.p95 * 1000.0 << ','
+            << s.p99 * 1000.0 << ',' << s.max * 1000.0 << '\n';
+      } else {
+         os << (first ? "\n" : ",\n")
+            << "      \"" << phase_name(phase) << "\": { \"count\": " << s.count
+            << ", \"mean_ms\": " << s.mean * 1000.0
+            << ", \"p50_ms\": " << s.p50 * 1000.0
+            << ", \"p95_ms\": " << s.p95 * 1000.0
+            << ", \"p99_ms\": " << s.p99 * 1000.0
+            << ", \"max_ms\": " << s.max * 1000.0 << " }";
+      }
+      first = false;
+   }
+
+   if (!csv) {
+      os << "\n   }\n}\n";
+   }
+
+   if (!os) {
+      throw fs::filesystem_error("Could not write stats file", path, std::make_error_code(std::errc::io_error));
+   }
+}
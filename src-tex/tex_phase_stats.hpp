@@ -0,0 +1,86 @@
+#pragma once
+#ifndef TEX_PHASE_STATS_HPP_
+#define TEX_PHASE_STATS_HPP_
+
+#include <be/core/be.hpp>
+#include <be/core/time.hpp>
+#include <be/core/filesystem.hpp>
+#include <array>
+#include <mutex>
+
+///////////////////////////////////////////////////////////////////////////////
+enum class Phase {
+   setup,
+   decode, // image files, on ImagePrefetcher threads
+   generate,
+   convert,
+   upload,
+   swap,
+   count_
+};
+
+///////////////////////////////////////////////////////////////////////////////
+const char* phase_name(Phase phase);
+
+///////////////////////////////////////////////////////////////////////////////
+struct PhaseSummary {
+   be::U64 count;
+   be::F64 mean;
+   be::F64 p50;
+   be::F64 p95;
+   be::F64 p99;
+   be::F64 max;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Per-phase latency histograms with logarithmic buckets (16 per power of
+// two, so percentiles are within about 2.2%).  Memory use doesn't grow with
+// the number of samples.  Safe to record from multiple threads.
+class PhaseStats final {
+public:
+   PhaseStats();
+
+   void record(Phase phase, be::F64 seconds);
+   PhaseSummary summary(Phase phase) const; // in seconds
+   void clear();
+   void clear(Phase phase);
+
+   // Writes CSV if the path ends in .csv, otherwise JSON.
+   void write(const be::Path& path, const be::S& label) const;
+
+private:
+   static constexpr std::size_t buckets = 40 * 16; // 1 ns to ~1100 s
+
+   struct Histogram {
+      std::array<be::U64, buckets> counts;
+      be::U64 count;
+      be::F64 total;
+      be::F64 max;
+   };
+
+   mutable std::mutex mutex_;
+   std::array<Histogram, std::size_t(Phase::count_)> phases_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class PhaseTimer final {
+public:
+   PhaseTimer(PhaseStats& stats, Phase phase)
+      : stats_(stats),
+        phase_(phase),
+        start_(be::ts_now()) { }
+
+   ~PhaseTimer() {
+      stats_.record(phase_, be::tu_to_seconds(be::ts_now() - start_));
+   }
+
+   PhaseTimer(const PhaseTimer&) = delete;
+   PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+   PhaseStats& stats_;
+   Phase phase_;
+   be::TU start_;
+};
+
+#endif
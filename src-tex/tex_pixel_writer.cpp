@@ -0,0 +1,46 @@
+#include "tex_pixel_writer.hpp"
+#include <be/gfx/tex/image_format_gl.hpp>
+#include <be/gfx/bgl.hpp>
+
+using namespace be;
+using namespace be::gfx::gl;
+using namespace be::gfx::tex;
+
+///////////////////////////////////////////////////////////////////////////////
+PixelWriterKind pixel_writer_kind(const ImageFormat& format) {
+   static const ImageFormat r8 = canonical_format(GL_R8);
+   static const ImageFormat rgba8 = canonical_format(GL_RGBA8);
+   static const ImageFormat srgb8_alpha8 = canonical_format(GL_SRGB8_ALPHA8);
+   static const ImageFormat rgba16f = canonical_format(GL_RGBA16F);
+   static const ImageFormat rgba32f = canonical_format(GL_RGBA32F);
+   static const ImageFormat r11g11b10f = canonical_format(GL_R11F_G11F_B10F);
+   static const ImageFormat rgb9e5 = canonical_format(GL_RGB9_E5);
+
+   if (format == rgba8 || format == srgb8_alpha8) {
+      return PixelWriterKind::rgba8;
+   } else if (format == r8) {
+      return PixelWriterKind::r8;
+   } else if (format == rgba16f && float_pack_verified(format)) {
+      return PixelWriterKind::rgba16f;
+   } else if (format == rgba32f) {
+      return PixelWriterKind::rgba32f;
+   } else if (format == r11g11b10f && float_pack_verified(format)) {
+      return PixelWriterKind::r11g11b10f;
+   } else if (format == rgb9e5 && float_pack_verified(format)) {
+      return PixelWriterKind::rgb9e5;
+   }
+   return PixelWriterKind::generic;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const char* pixel_writer_name(PixelWriterKind kind) {
+   switch (kind) {
+      case PixelWriterKind::r8:      return "R8";
+      case PixelWriterKind::rgba8:   return "RGBA8";
+      case PixelWriterKind::rgba16f: return "RGBA16F";
+      case PixelWriterKind::rgba32f: return "RGBA32F";
+      case PixelWriterKind::r11g11b10f: return "R11F_G11F_B10F";
+      case PixelWriterKind::rgb9e5:  return "RGB9_E5";
+      default:                       return "generic";
+   }
+}
@@ -0,0 +1,147 @@
+#pragma once
+#ifndef TEX_PIXEL_WRITER_HPP_
+#define TEX_PIXEL_WRITER_HPP_
+
+#include "tex_image_rows.hpp"
+#include "tex_float_pack.hpp"
+#include <be/core/glm.hpp>
+#include <be/gfx/tex/texture.hpp>
+#include <be/gfx/tex/pixel_access_norm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+enum class PixelWriterKind {
+   generic,
+   r8,
+   rgba8, // also used for SRGB8_ALPHA8; put_pixel_norm doesn't convert colorspaces
+   rgba16f,
+   rgba32f,
+   r11g11b10f, // only when float_pack_verified()
+   rgb9e5      // only when float_pack_verified()
+};
+
+///////////////////////////////////////////////////////////////////////////////
+PixelWriterKind pixel_writer_kind(const be::gfx::tex::ImageFormat& format);
+const char* pixel_writer_name(PixelWriterKind kind);
+
+///////////////////////////////////////////////////////////////////////////////
+inline be::U8 pack_unorm8(be::F32 v) {
+   return be::U8(glm::clamp(v, 0.f, 1.f) * 255.f + 0.5f);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+class GenericPixelWriter final {
+public:
+   explicit GenericPixelWriter(const be::gfx::tex::ImageView& view)
+      : put_(be::gfx::tex::put_pixel_norm_func<be::ivec2>(view)) { }
+
+   void operator()(const ImageRow& row, const be::vec4* values) const {
+      for (be::ivec2 pc(row.x_begin, row.y); pc.x < row.x_end; ++pc.x) {
+         put_(*row.view, pc, *values++);
+      }
+   }
+
+private:
+   decltype(be::gfx::tex::put_pixel_norm_func<be::ivec2>(std::declval<const be::gfx::tex::ImageView&>())) put_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+template <PixelWriterKind Kind>
+class PixelWriter final {
+public:
+   explicit PixelWriter(const be::gfx::tex::ImageView&) { }
+
+   void operator()(const ImageRow& row, const be::vec4* values) const {
+      be::UC* ptr = row.begin();
+      for (be::I32 i = 0, n = row.width(); i < n; ++i) {
+         store_(ptr, values[i]);
+         ptr += block_size_;
+      }
+   }
+
+private:
+   static constexpr std::size_t block_size_ =
+      Kind == PixelWriterKind::r8 ? 1 :
+      Kind == PixelWriterKind::rgba8 ? 4 :
+      Kind == PixelWriterKind::rgba16f ? 8 :
+      Kind == PixelWriterKind::rgba32f ? 16 : 4;
+
+   static void store_(be::UC* ptr, const be::vec4& pixel_norm);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+template <>
+inline void PixelWriter<PixelWriterKind::r8>::store_(be::UC* ptr, const be::vec4& pixel_norm) {
+   ptr[0] = pack_unorm8(pixel_norm.r);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <>
+inline void PixelWriter<PixelWriterKind::rgba8>::store_(be::UC* ptr, const be::vec4& pixel_norm) {
+   ptr[0] = pack_unorm8(pixel_norm.r);
+   ptr[1] = pack_unorm8(pixel_norm.g);
+   ptr[2] = pack_unorm8(pixel_norm.b);
+   ptr[3] = pack_unorm8(pixel_norm.a);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The float formats convert whole rows with the bulk packers.
+template <>
+inline void PixelWriter<PixelWriterKind::rgba16f>::operator()(const ImageRow& row, const be::vec4* values) const {
+   pack_half(glm::value_ptr(values[0]), reinterpret_cast<be::U16*>(row.begin()), std::size_t(row.width()) * 4);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <>
+inline void PixelWriter<PixelWriterKind::r11g11b10f>::operator()(const ImageRow& row, const be::vec4* values) const {
+   pack_r11g11b10f(values, reinterpret_cast<be::U32*>(row.begin()), std::size_t(row.width()));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <>
+inline void PixelWriter<PixelWriterKind::rgb9e5>::operator()(const ImageRow& row, const be::vec4* values) const {
+   pack_rgb9e5(values, reinterpret_cast<be::U32*>(row.begin()), std::size_t(row.width()));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <>
+inline void PixelWriter<PixelWriterKind::rgba32f>::store_(be::UC* ptr, const be::vec4& pixel_norm) {
+   be::F32 values[4] = { pixel_norm.r, pixel_norm.g, pixel_norm.b, pixel_norm.a };
+   std::memcpy(ptr, values, sizeof(values));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Calls func once with the writer best suited to the view's format, so the
+// store loop is inlined into func's instantiation.
+template <typename F>
+void dispatch_pixel_writer(const be::gfx::tex::ImageView& view, bool specialize, F&& func) {
+   switch (specialize ? pixel_writer_kind(view.format()) : PixelWriterKind::generic) {
+      case PixelWriterKind::r8:      func(PixelWriter<PixelWriterKind::r8>(view)); break;
+      case PixelWriterKind::rgba8:   func(PixelWriter<PixelWriterKind::rgba8>(view)); break;
+      case PixelWriterKind::rgba16f: func(PixelWriter<PixelWriterKind::rgba16f>(view)); break;
+      case PixelWriterKind::rgba32f: func(PixelWriter<PixelWriterKind::rgba32f>(view)); break;
+      case PixelWriterKind::r11g11b10f: func(PixelWriter<PixelWriterKind::r11g11b10f>(view)); break;
+      case PixelWriterKind::rgb9e5:  func(PixelWriter<PixelWriterKind::rgb9e5>(view)); break;
+      default:                       func(GenericPixelWriter(view)); break;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// func(const ImageRow&, vec4*) writes the normalized value of each pixel in
+// the row to consecutive elements of the output array.
+template <typename F>
+void generate_rows_parallel(TileScheduler& scheduler, be::gfx::tex::ImageView view, bool specialize, F func) {
+   dispatch_pixel_writer(view, specialize, [&](auto put) {
+      visit_image_rows_parallel(scheduler, view, [&](const ImageRow& row) {
+         thread_local std::vector<be::vec4> values;
+         values.resize(std::size_t(row.width()));
+         func(row, values.data());
+         put(row, values.data());
+      });
+   });
+}
+
+#endif
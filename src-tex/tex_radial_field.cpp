@@ -0,0 +1,85 @@
+#include "tex_radial_field.hpp"
+#include "tex_fast_math.hpp"
+#include <algorithm>
+
+using namespace be;
+
+///////////////////////////////////////////////////////////////////////////////
+void RadialField::invalidate() {
+   planes_ = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void RadialField::prepare(TileScheduler& scheduler, ivec2 dim, U8 planes) {
+   if (dim != dim_) {
+      dim_ = dim;
+      planes_ = 0;
+   }
+
+   U8 missing = planes & ~planes_;
+   if (missing == 0 || dim.x <= 0 || dim.y <= 0) {
+      return;
+   }
+
+   std::size_t size = std::size_t(dim.x) * std::size_t(dim.y);
+   if (missing & plane_distance) {
+      distance_.resize(size);
+   }
+   if (missing & plane_distance2) {
+      distance2_.resize(size);
+   }
+   if (missing & plane_angle) {
+      angle_.resize(size);
+   }
+
+   vec2 center = vec2(dim) / 2.f;
+   scheduler.run(dim, choose_tile_dim(dim, sizeof(F32)), [&](const Tile& tile) {
+      std::size_t n = std::size_t(tile.dim.x);
+      std::vector<F32> dx(n);
+      std::vector<F32> dy(n);
+      std::vector<F32> d2(n);
+      for (std::size_t i = 0; i < n; ++i) {
+         dx[i] = tile.offset.x + i + 0.5f - center.x;
+      }
+
+      for (I32 y = tile.offset.y; y < tile.offset.y + tile.dim.y; ++y) {
+         std::size_t offset = std::size_t(y) * std::size_t(dim.x) + std::size_t(tile.offset.x);
+         F32 row_dy = y + 0.5f - center.y;
+         for (std::size_t i = 0; i < n; ++i) {
+            dy[i] = row_dy;
+            d2[i] = dx[i] * dx[i] + row_dy * row_dy;
+         }
+
+         if (missing & plane_distance2) {
+            std::copy(d2.begin(), d2.end(), distance2_.begin() + offset);
+         }
+         if (missing & plane_distance) {
+            fast_sqrt(d2.data(), distance_.data() + offset, n);
+         }
+         if (missing & plane_angle) {
+            F32* angle = angle_.data() + offset;
+            fast_atan2(dy.data(), dx.data(), angle, n);
+            for (std::size_t i = 0; i < n; ++i) {
+               angle[i] += glm::pi<F32>();
+            }
+         }
+      }
+   });
+
+   planes_ |= missing;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const F32* RadialField::distance(I32 y) const {
+   return distance_.data() + std::size_t(y) * std::size_t(dim_.x);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const F32* RadialField::distance2(I32 y) const {
+   return distance2_.data() + std::size_t(y) * std::size_t(dim_.x);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const F32* RadialField::angle(I32 y) const {
+   return angle_.data() + std::size_t(y) * std::size_t(dim_.x);
+}
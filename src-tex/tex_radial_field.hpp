@@ -0,0 +1,36 @@
+#pragma once
+#ifndef TEX_RADIAL_FIELD_HPP_
+#define TEX_RADIAL_FIELD_HPP_
+
+#include "tex_tile_scheduler.hpp"
+#include <be/core/glm.hpp>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// Per-pixel distance, squared distance and angle from the center of an
+// image.  These only change when the image is resized, so radial generators
+// build them once and only do the time-dependent work each frame.
+class RadialField final {
+public:
+   enum plane : be::U8 {
+      plane_distance = 1,
+      plane_distance2 = 2,
+      plane_angle = 4
+   };
+
+   void invalidate();
+   void prepare(TileScheduler& scheduler, be::ivec2 dim, be::U8 planes);
+
+   const be::F32* distance(be::I32 y) const;
+   const be::F32* distance2(be::I32 y) const;
+   const be::F32* angle(be::I32 y) const; // in [0, 2 pi]
+
+private:
+   be::ivec2 dim_;
+   be::U8 planes_ = 0;
+   std::vector<be::F32> distance_;
+   std::vector<be::F32> distance2_;
+   std::vector<be::F32> angle_;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#include "tex_resize_coalescer.hpp"
+#include <algorithm>
+
+using namespace be;
+
+///////////////////////////////////////////////////////////////////////////////
+ResizeCoalescer::ResizeCoalescer(ivec2 dim, I32 preview_divisor, F64 settle_seconds)
+   : preview_divisor_(std::max(preview_divisor, 1)),
+     settle_seconds_(settle_seconds),
+     rendered_dim_(dim),
+     preview_dim_(0),
+     requested_dim_(dim) { }
+
+///////////////////////////////////////////////////////////////////////////////
+void ResizeCoalescer::resize(ivec2 dim, F64 now) {
+   ++events_;
+   last_event_ = now;
+   requested_dim_ = dim;
+   // a preview on screen still needs refining, even if the size is back
+   pending_ = dim != rendered_dim_ || preview_dim_ != ivec2(0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ResizeCoalescer::Step ResizeCoalescer::poll(F64 now) {
+   if (!pending_) {
+      return Step { Action::none, rendered_dim_ };
+   }
+
+   if (now - last_event_ >= settle_seconds_) {
+      pending_ = false;
+      rendered_dim_ = requested_dim_;
+      preview_dim_ = ivec2(0);
+      ++full_renders_;
+      return Step { Action::full, rendered_dim_ };
+   }
+
+   ivec2 preview = glm::max(requested_dim_ / preview_divisor_, ivec2(1));
+   if (preview_divisor_ > 1 && preview != preview_dim_) {
+      preview_dim_ = preview;
+      ++previews_;
+      return Step { Action::preview, preview };
+   }
+
+   return Step { Action::none, preview_dim_ };
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool ResizeCoalescer::pending() const {
+   return pending_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+F64 ResizeCoalescer::timeout(F64 now) const {
+   if (!pending_) {
+      return -1.0;
+   }
+   return std::max(0.0, settle_seconds_ - (now - last_event_));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ivec2 ResizeCoalescer::dim() const {
+   return requested_dim_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 ResizeCoalescer::events() const {
+   return events_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 ResizeCoalescer::previews() const {
+   return previews_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 ResizeCoalescer::full_renders() const {
+   return full_renders_;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#ifndef TEX_RESIZE_COALESCER_HPP_
+#define TEX_RESIZE_COALESCER_HPP_
+
+#include <be/core/glm.hpp>
+
+///////////////////////////////////////////////////////////////////////////////
+// Turns a stream of window resize events into render requests.  Events only
+// record the latest size; poll() then asks for at most one render: a cheap
+// preview at 1/preview_divisor scale as soon as the size changes, and the
+// full resolution frame once no event has arrived for settle_seconds.
+// Time is passed in by the caller, so sequences can be replayed without a
+// window.
+class ResizeCoalescer final {
+public:
+   enum class Action {
+      none,
+      preview,
+      full
+   };
+
+   struct Step {
+      Action action;
+      be::ivec2 dim;
+   };
+
+   explicit ResizeCoalescer(be::ivec2 dim, be::I32 preview_divisor = 4, be::F64 settle_seconds = 0.15);
+
+   void resize(be::ivec2 dim, be::F64 now);
+   Step poll(be::F64 now);
+
+   // True while a full resolution render is still owed.
+   bool pending() const;
+   // Seconds until poll() should be called again, or a negative value if
+   // nothing is pending.
+   be::F64 timeout(be::F64 now) const;
+   be::ivec2 dim() const;
+
+   be::U64 events() const;
+   be::U64 previews() const;
+   be::U64 full_renders() const;
+
+private:
+   be::I32 preview_divisor_;
+   be::F64 settle_seconds_;
+   be::ivec2 rendered_dim_;
+   be::ivec2 preview_dim_;
+   be::ivec2 requested_dim_;
+   be::F64 last_event_ = 0;
+   bool pending_ = false;
+
+   be::U64 events_ = 0;
+   be::U64 previews_ = 0;
+   be::U64 full_renders_ = 0;
+};
+
+#endif
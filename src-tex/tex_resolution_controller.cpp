@@ -0,0 +1,125 @@
+#include "tex_resolution_controller.hpp"
+#include <algorithm>
+#include <cmath>
+
+using namespace be;
+
+namespace {
+
+constexpr F64 average_weight = 0.25;
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+ResolutionController::ResolutionController(ivec2 full_dim, F64 target_seconds, F32 min_scale, F64 cooldown_seconds, F64 tolerance)
+   : full_dim_(full_dim),
+     target_(target_seconds),
+     min_step_(glm::clamp(I32(std::ceil(min_scale * steps_)), 1, steps_)),
+     cooldown_(cooldown_seconds),
+     tolerance_(tolerance) { }
+
+///////////////////////////////////////////////////////////////////////////////
+void ResolutionController::full_dim(ivec2 dim) {
+   full_dim_ = dim;
+   samples_ = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool ResolutionController::record(F64 seconds, F64 now) {
+   ++frames_;
+   average_ = samples_ == 0 ? seconds : average_ + (seconds - average_) * average_weight;
+   ++samples_;
+
+   if (samples_ < min_samples_) {
+      return false;
+   }
+
+   if (average_ > target_ * (1.0 + tolerance_) && step_ > min_step_) {
+      I32 step = std::min(largest_step_within_(target_), step_ - 1);
+      set_step_(step, now);
+      ++downscales_;
+      return true;
+   }
+
+   if (step_ < steps_ && (!changed_ || now - last_change_ >= cooldown_)) {
+      I32 step = largest_step_within_(target_ * (1.0 - tolerance_));
+      if (step > step_) {
+         set_step_(step, now);
+         ++upscales_;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ivec2 ResolutionController::dim() const {
+   return dim_for_(step_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ivec2 ResolutionController::full_dim() const {
+   return full_dim_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+F32 ResolutionController::scale() const {
+   return F32(step_) / F32(steps_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+F64 ResolutionController::target() const {
+   return target_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+F64 ResolutionController::average() const {
+   return samples_ > 0 ? average_ : 0.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 ResolutionController::frames() const {
+   return frames_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 ResolutionController::downscales() const {
+   return downscales_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 ResolutionController::upscales() const {
+   return upscales_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ivec2 ResolutionController::dim_for_(I32 step) const {
+   return glm::max((full_dim_ * step + steps_ / 2) / steps_, ivec2(1));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+F64 ResolutionController::predict_(I32 step) const {
+   ivec2 current = dim_for_(step_);
+   ivec2 other = dim_for_(step);
+   return average_ * (F64(other.x) * F64(other.y)) / (F64(current.x) * F64(current.y));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// min_step_ if nothing fits.
+I32 ResolutionController::largest_step_within_(F64 budget) const {
+   for (I32 step = steps_; step > min_step_; --step) {
+      if (predict_(step) <= budget) {
+         return step;
+      }
+   }
+   return min_step_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ResolutionController::set_step_(I32 step, F64 now) {
+   step_ = step;
+   samples_ = 0;
+   last_change_ = now;
+   changed_ = true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#ifndef TEX_RESOLUTION_CONTROLLER_HPP_
+#define TEX_RESOLUTION_CONTROLLER_HPP_
+
+#include <be/core/glm.hpp>
+
+///////////////////////////////////////////////////////////////////////////////
+// Picks the render resolution that keeps generation time within a budget,
+// as a fraction of the full (window) resolution in 1/16 steps.  Generation
+// time is assumed proportional to the pixel count, so an exponential average
+// of the measured times predicts the time at any other scale.
+//
+// Hysteresis: the scale drops once the average exceeds the budget by more
+// than tolerance, to the largest step predicted to fit, but only rises to a
+// step predicted to fit with tolerance to spare, and only cooldown_seconds
+// after the last change.  Time is passed in by the caller, so the
+// controller can be driven by a simulated clock.
+class ResolutionController final {
+public:
+   ResolutionController(be::ivec2 full_dim, be::F64 target_seconds, be::F32 min_scale = 0.25f,
+                        be::F64 cooldown_seconds = 0.5, be::F64 tolerance = 0.1);
+
+   // Keeps the current scale.
+   void full_dim(be::ivec2 dim);
+
+   // Records the generation time of a frame rendered at dim().  Returns true
+   // if dim() changed.
+   bool record(be::F64 seconds, be::F64 now);
+
+   be::ivec2 dim() const;
+   be::ivec2 full_dim() const;
+   be::F32 scale() const;
+   be::F64 target() const;
+   be::F64 average() const; // seconds per frame at dim(); 0 until measured
+
+   be::U64 frames() const;
+   be::U64 downscales() const;
+   be::U64 upscales() const;
+
+private:
+   static constexpr be::I32 steps_ = 16;
+   static constexpr be::U32 min_samples_ = 4;
+
+   be::ivec2 dim_for_(be::I32 step) const;
+   be::F64 predict_(be::I32 step) const;
+   be::I32 largest_step_within_(be::F64 budget) const;
+   void set_step_(be::I32 step, be::F64 now);
+
+   be::ivec2 full_dim_;
+   be::F64 target_;
+   be::I32 min_step_;
+   be::F64 cooldown_;
+   be::F64 tolerance_;
+   be::I32 step_ = steps_;
+   be::F64 average_ = 0;
+   be::U32 samples_ = 0; // since the last change
+   be::F64 last_change_ = 0;
+   bool changed_ = false;
+
+   be::U64 frames_ = 0;
+   be::U64 downscales_ = 0;
+   be::U64 upscales_ = 0;
+};
+
+#endif
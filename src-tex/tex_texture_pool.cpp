@@ -0,0 +1,183 @@
+#include "tex_texture_pool.hpp"
+#include <be/core/logging.hpp>
+#include <cstdlib>
+#include <new>
+
+using namespace be;
+using namespace be::gfx::tex;
+
+namespace {
+
+constexpr std::size_t block_alignment = 4096;
+constexpr std::size_t line_alignment = 8;
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t round_up(std::size_t bytes, std::size_t alignment) {
+   return (bytes + alignment - 1) / alignment * alignment;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t size_class(std::size_t bytes) {
+   std::size_t size = block_alignment;
+   while (size < bytes) {
+      size *= 2;
+   }
+   return size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t line_span(const ImageFormat& format, ivec2 dim) {
+   I32 blocks = (dim.x + I32(format.block_dim().x) - 1) / I32(format.block_dim().x);
+   return round_up(std::size_t(blocks) * format.block_size(), line_alignment);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+I32 block_rows(const ImageFormat& format, ivec2 dim) {
+   return (dim.y + I32(format.block_dim().y) - 1) / I32(format.block_dim().y);
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+void ImageBuffer::Free::operator()(UC* data) const {
+#ifdef _MSC_VER
+   _aligned_free(data);
+#else
+   std::free(data);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ImageBuffer::ImageBuffer(const ImageFormat& format, ivec2 dim)
+   : ImageBuffer(round_up(bytes_needed(format, dim), block_alignment)) {
+   reset_view_(format, dim);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ImageBuffer::ImageBuffer(std::size_t capacity)
+   : capacity_(capacity) {
+#ifdef _MSC_VER
+   void* data = _aligned_malloc(capacity, block_alignment);
+#else
+   void* data = std::aligned_alloc(block_alignment, capacity);
+#endif
+   if (!data) {
+      throw std::bad_alloc();
+   }
+   data_.reset(static_cast<UC*>(data));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ImageView ImageBuffer::image() const {
+   return view_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t ImageBuffer::capacity() const {
+   return capacity_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ImageBuffer::operator bool() const {
+   return bool(data_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t ImageBuffer::bytes_needed(const ImageFormat& format, ivec2 dim) {
+   return line_span(format, dim) * std::size_t(block_rows(format, dim));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ImageBuffer::reset_view_(const ImageFormat& format, ivec2 dim) {
+   std::size_t size = bytes_needed(format, dim);
+   view_ = ImageView(format, ivec3(dim, 1), data_.get(), size, line_span(format, dim), size);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TexturePool::TexturePool(std::size_t max_bytes)
+   : max_bytes_(max_bytes) { }
+
+///////////////////////////////////////////////////////////////////////////////
+ImageBuffer TexturePool::acquire(const ImageFormat& format, ivec2 dim) {
+   std::size_t bytes = ImageBuffer::bytes_needed(format, dim);
+   std::size_t max_capacity = size_class(bytes);
+   for (auto it = entries_.rbegin(); it != entries_.rend(); ++it) {
+      if (it->capacity() >= bytes && it->capacity() <= max_capacity) {
+         ImageBuffer buffer = std::move(*it);
+         pooled_bytes_ -= buffer.capacity();
+         entries_.erase(std::next(it).base());
+         buffer.reset_view_(format, dim);
+         ++reuses_;
+
+         be_verbose() << "Reused pooled image buffer"
+            & attr("Width") << dim.x
+            & attr("Height") << dim.y
+            & attr("Capacity (MB)") << F64(buffer.capacity()) / (1024.0 * 1024.0)
+            & attr("Allocations") << allocations_
+            & attr("Reuses") << reuses_
+            & attr("Pooled (MB)") << F64(pooled_bytes_) / (1024.0 * 1024.0)
+            | default_log();
+         return buffer;
+      }
+   }
+
+   ++allocations_;
+   be_verbose() << "Allocating image buffer"
+      & attr("Width") << dim.x
+      & attr("Height") << dim.y
+      & attr("Capacity (MB)") << F64(max_capacity) / (1024.0 * 1024.0)
+      & attr("Allocations") << allocations_
+      & attr("Reuses") << reuses_
+      & attr("Pooled (MB)") << F64(pooled_bytes_) / (1024.0 * 1024.0)
+      | default_log();
+   ImageBuffer buffer(max_capacity);
+   buffer.reset_view_(format, dim);
+   return buffer;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexturePool::release(ImageBuffer&& buffer) {
+   if (!buffer || buffer.capacity() > max_bytes_) {
+      buffer = ImageBuffer();
+      return;
+   }
+
+   pooled_bytes_ += buffer.capacity();
+   entries_.push_back(std::move(buffer));
+
+   std::size_t evict = 0;
+   while (pooled_bytes_ > max_bytes_) {
+      pooled_bytes_ -= entries_[evict].capacity();
+      ++evict;
+   }
+   if (evict > 0) {
+      entries_.erase(entries_.begin(), entries_.begin() + evict);
+      evictions_ += evict;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TexturePool::clear() {
+   entries_.clear();
+   pooled_bytes_ = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t TexturePool::pooled_bytes() const {
+   return pooled_bytes_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 TexturePool::allocations() const {
+   return allocations_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 TexturePool::reuses() const {
+   return reuses_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 TexturePool::evictions() const {
+   return evictions_;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#ifndef TEX_TEXTURE_POOL_HPP_
+#define TEX_TEXTURE_POOL_HPP_
+
+#include <be/core/glm.hpp>
+#include <be/gfx/tex/image_view.hpp>
+#include <memory>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// Page-aligned storage viewed as a single 2D image.  Lines are padded to 8
+// bytes, like make_planar_texture's default alignment.  The block may be
+// larger than the image needs.
+class ImageBuffer final {
+public:
+   ImageBuffer() = default;
+   ImageBuffer(const be::gfx::tex::ImageFormat& format, be::ivec2 dim);
+
+   be::gfx::tex::ImageView image() const;
+   std::size_t capacity() const;
+   explicit operator bool() const;
+
+   static std::size_t bytes_needed(const be::gfx::tex::ImageFormat& format, be::ivec2 dim);
+
+private:
+   friend class TexturePool;
+
+   struct Free {
+      void operator()(be::UC* data) const;
+   };
+
+   explicit ImageBuffer(std::size_t capacity);
+   void reset_view_(const be::gfx::tex::ImageFormat& format, be::ivec2 dim);
+
+   std::unique_ptr<be::UC, Free> data_;
+   std::size_t capacity_ = 0;
+   be::gfx::tex::ImageView view_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Keeps released image buffers around so that reacquiring them (e.g. while
+// dragging a window edge, or when a ring of frames is reallocated) doesn't
+// go back to the allocator.  Blocks are allocated in power-of-two size
+// classes, and a request reuses the most recently released block that has
+// enough bytes without being from a larger class, whatever its previous
+// format and size.  Once more than max_bytes are pooled, the least recently
+// released blocks are freed.  Not thread-safe.
+class TexturePool final {
+public:
+   explicit TexturePool(std::size_t max_bytes = 256 * 1024 * 1024);
+
+   ImageBuffer acquire(const be::gfx::tex::ImageFormat& format, be::ivec2 dim);
+   void release(ImageBuffer&& buffer);
+   void clear();
+
+   std::size_t pooled_bytes() const;
+   be::U64 allocations() const;
+   be::U64 reuses() const;
+   be::U64 evictions() const;
+
+private:
+   std::size_t max_bytes_;
+   std::size_t pooled_bytes_ = 0;
+   std::vector<ImageBuffer> entries_; // oldest first
+   be::U64 allocations_ = 0;
+   be::U64 reuses_ = 0;
+   be::U64 evictions_ = 0;
+};
+
+#endif
@@ -0,0 +1,195 @@
+#include "tex_tile_cache.hpp"
+#include "tex_image_rows.hpp"
+#include <be/gfx/tex/pixel_access_norm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace be;
+using namespace be::gfx::tex;
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+U64 tile_key(U32 level, ivec2 tile) {
+   return (U64(level) << 48) | (U64(U32(tile.y)) << 24) | U64(U32(tile.x));
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+TileCache::TileCache(std::size_t max_bytes)
+   : max_bytes_(max_bytes) { }
+
+///////////////////////////////////////////////////////////////////////////////
+TileCache::TileData TileCache::get(const MipPyramid& pyramid, U32 level, ivec2 tile, bool* hit) {
+   U64 key = tile_key(level, tile);
+   auto it = index_.find(key);
+   if (it != index_.end()) {
+      entries_.splice(entries_.begin(), entries_, it->second);
+      ++hits_;
+      if (hit) {
+         *hit = true;
+      }
+      return it->second->data;
+   }
+
+   ImageView view = pyramid.tile(level, tile);
+   auto data = std::make_shared<std::vector<UC>>(view.data(), view.data() + view.size());
+   entries_.push_front(Entry { key, data });
+   index_[key] = entries_.begin();
+   bytes_ += data->size();
+   ++misses_;
+   if (hit) {
+      *hit = false;
+   }
+   evict_();
+   return data;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TileCache::clear() {
+   entries_.clear();
+   index_.clear();
+   bytes_ = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TileCache::max_bytes(std::size_t max_bytes) {
+   max_bytes_ = max_bytes;
+   evict_();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t TileCache::max_bytes() const {
+   return max_bytes_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t TileCache::bytes() const {
+   return bytes_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t TileCache::tiles() const {
+   return entries_.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 TileCache::hits() const {
+   return hits_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 TileCache::misses() const {
+   return misses_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 TileCache::evictions() const {
+   return evictions_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TileCache::evict_() {
+   // the most recent tile is always kept, even if it alone is over budget
+   while (bytes_ > max_bytes_ && entries_.size() > 1) {
+      Entry& entry = entries_.back();
+      bytes_ -= entry.data->size();
+      index_.erase(entry.key);
+      entries_.pop_back();
+      ++evictions_;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U32 render_tiled_view(TileScheduler& scheduler, TileCache& cache, const MipPyramid& pyramid, vec2 center, F32 zoom, ImageView& dest) {
+   ivec2 dest_dim = ivec2(dest.dim());
+   ivec2 image_dim = pyramid.level(0).dim;
+   if (zoom <= 0.f) {
+      zoom = std::min(F32(dest_dim.x) / F32(image_dim.x), F32(dest_dim.y) / F32(image_dim.y));
+   }
+
+   U32 level = U32(glm::clamp(I32(std::floor(std::log2(1.f / zoom))), 0, I32(pyramid.levels()) - 1));
+   const MipPyramid::Level& info = pyramid.level(level);
+   I32 tile_size = pyramid.tile_size();
+
+   // level texel coordinates of each destination column and row, or -1
+   F32 scale = 1.f / (zoom * F32(1u << level));
+   vec2 origin = center / F32(1u << level) - vec2(dest_dim) * 0.5f * scale;
+   std::vector<I32> columns(std::size_t(dest_dim.x));
+   std::vector<I32> rows(std::size_t(dest_dim.y));
+   auto map_coords = [scale](std::vector<I32>& coords, F32 origin, I32 size) {
+      for (std::size_t i = 0; i < coords.size(); ++i) {
+         F32 c = std::floor(origin + (F32(i) + 0.5f) * scale);
+         coords[i] = c >= 0.f && c < F32(size) ? I32(c) : -1;
+      }
+   };
+   map_coords(columns, origin.x, info.dim.x);
+   map_coords(rows, origin.y, info.dim.y);
+
+   // fetch every visible tile up front; the cache isn't thread-safe
+   ivec2 first(info.dim), last(-1);
+   for (I32 x : columns) {
+      if (x >= 0) {
+         first.x = std::min(first.x, x / tile_size);
+         last.x = std::max(last.x, x / tile_size);
+      }
+   }
+   for (I32 y : rows) {
+      if (y >= 0) {
+         first.y = std::min(first.y, y / tile_size);
+         last.y = std::max(last.y, y / tile_size);
+      }
+   }
+
+   ivec2 span = glm::max(last - first + 1, ivec2(0));
+   std::vector<TileCache::TileData> tiles(std::size_t(span.x) * std::size_t(span.y));
+   for (I32 ty = 0; ty < span.y; ++ty) {
+      for (I32 tx = 0; tx < span.x; ++tx) {
+         tiles[std::size_t(ty) * std::size_t(span.x) + std::size_t(tx)] = cache.get(pyramid, level, first + ivec2(tx, ty));
+      }
+   }
+
+   const ImageFormat& format = pyramid.format();
+   std::size_t block = format.block_size();
+   std::size_t tile_line = std::size_t(tile_size) * block;
+   auto texel = [&](I32 x, I32 y) {
+      ivec2 t = ivec2(x, y) / tile_size - first;
+      const auto& data = *tiles[std::size_t(t.y) * std::size_t(span.x) + std::size_t(t.x)];
+      return data.data() + std::size_t(y % tile_size) * tile_line + std::size_t(x % tile_size) * block;
+   };
+
+   if (dest.format() == format) {
+      visit_image_rows_parallel(scheduler, dest, [&](const ImageRow& row) {
+         I32 y = rows[std::size_t(row.y)];
+         UC* out = row.begin();
+         for (I32 x = row.x_begin; x < row.x_end; ++x, out += block) {
+            I32 sx = columns[std::size_t(x)];
+            if (y < 0 || sx < 0) {
+               std::memset(out, 0, block);
+            } else {
+               std::memcpy(out, texel(sx, y), block);
+            }
+         }
+      });
+   } else {
+      ImageView probe(format, ivec3(1), nullptr, block);
+      auto get = get_pixel_norm_func<ivec2>(probe);
+      auto put = put_pixel_norm_func<ivec2>(dest);
+      visit_image_rows_parallel(scheduler, dest, [&](const ImageRow& row) {
+         I32 y = rows[std::size_t(row.y)];
+         for (ivec2 pc(row.x_begin, row.y); pc.x < row.x_end; ++pc.x) {
+            I32 sx = columns[std::size_t(pc.x)];
+            vec4 value(0.f);
+            if (y >= 0 && sx >= 0) {
+               ImageView pixel(format, ivec3(1), const_cast<UC*>(texel(sx, y)), block);
+               value = get(pixel, ivec2(0));
+            }
+            put(dest, pc, value);
+         }
+      });
+   }
+
+   return level;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#ifndef TEX_TILE_CACHE_HPP_
+#define TEX_TILE_CACHE_HPP_
+
+#include "tex_mip_pyramid.hpp"
+#include <be/core/glm.hpp>
+#include <be/gfx/tex/image_view.hpp>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// Least-recently-used copies of pyramid tiles, bounded by max_bytes.  Copying
+// tiles out of the mapping keeps the pages touched per frame (and the cost
+// of faulting them back in after the OS drops them) independent of how
+// long the viewer has been panning around.
+//
+// Not thread-safe; fetch the tiles a frame needs before composing it.
+class TileCache final {
+public:
+   using TileData = std::shared_ptr<const std::vector<be::UC>>;
+
+   explicit TileCache(std::size_t max_bytes = 0);
+
+   // The returned data stays valid while held, even if it's evicted.
+   TileData get(const MipPyramid& pyramid, be::U32 level, be::ivec2 tile, bool* hit = nullptr);
+
+   // Must be called when switching pyramids.
+   void clear();
+   void max_bytes(std::size_t max_bytes);
+
+   std::size_t max_bytes() const;
+   std::size_t bytes() const;
+   std::size_t tiles() const;
+   be::U64 hits() const;
+   be::U64 misses() const;
+   be::U64 evictions() const;
+
+private:
+   struct Entry {
+      be::U64 key;
+      TileData data;
+   };
+
+   void evict_();
+
+   std::list<Entry> entries_; // most recently used first
+   std::unordered_map<be::U64, std::list<Entry>::iterator> index_;
+   std::size_t max_bytes_;
+   std::size_t bytes_ = 0;
+   be::U64 hits_ = 0;
+   be::U64 misses_ = 0;
+   be::U64 evictions_ = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Fills dest with the part of the pyramid's image around center (in level 0
+// pixels), magnified by zoom, using nearest sampling from the smallest level
+// that still has at least one texel per destination pixel.  zoom <= 0 fits
+// the whole image.  Pixels outside the image are zero.  Returns the level
+// used.
+be::U32 render_tiled_view(TileScheduler& scheduler, TileCache& cache, const MipPyramid& pyramid,
+                          be::vec2 center, be::F32 zoom, be::gfx::tex::ImageView& dest);
+
+#endif
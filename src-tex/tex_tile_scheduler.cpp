@@ -0,0 +1,236 @@
+#include "tex_tile_scheduler.hpp"
+#include <algorithm>
+
+using namespace be;
+
+namespace {
+
+constexpr std::size_t tile_target_bytes = 64 * 1024;
+constexpr I32 min_tile_rows = 64;
+
+///////////////////////////////////////////////////////////////////////////////
+U64 pack_range(U32 begin, U32 end) {
+   return U64(begin) | (U64(end) << 32);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U32 range_begin(U64 range) {
+   return U32(range);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U32 range_end(U64 range) {
+   return U32(range >> 32);
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+ivec2 choose_tile_dim(ivec2 image_dim, std::size_t bytes_per_pixel) {
+   bytes_per_pixel = std::max(bytes_per_pixel, std::size_t(1));
+   ivec2 tile_dim = ivec2(std::max(image_dim.x, 1), 1);
+
+   std::size_t row_bytes = std::size_t(tile_dim.x) * bytes_per_pixel;
+   if (row_bytes > tile_target_bytes) {
+      I32 cols = I32(tile_target_bytes / bytes_per_pixel) & ~63;
+      tile_dim.x = std::max(cols, 64);
+   } else {
+      I32 rows = I32(tile_target_bytes / row_bytes);
+      // keep enough bands around for small images to load-balance
+      rows = std::min(rows, std::max(1, image_dim.y / min_tile_rows));
+      tile_dim.y = std::max(rows, 1);
+   }
+
+   return tile_dim;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U32 count_tiles(ivec2 image_dim, ivec2 tile_dim) {
+   if (image_dim.x <= 0 || image_dim.y <= 0 || tile_dim.x <= 0 || tile_dim.y <= 0) {
+      return 0;
+   }
+   I32 cols = (image_dim.x + tile_dim.x - 1) / tile_dim.x;
+   I32 rows = (image_dim.y + tile_dim.y - 1) / tile_dim.y;
+   return U32(cols * rows);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TileScheduler::TileScheduler(U32 threads)
+   : threads_(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency())),
+     queues_(new Queue[threads_]),
+     remaining_(0),
+     steals_(0) {
+   for (U32 i = 0; i < threads_; ++i) {
+      queues_[i].range.store(0, std::memory_order_relaxed);
+   }
+   workers_.reserve(threads_ - 1);
+   for (U32 i = 1; i < threads_; ++i) {
+      workers_.emplace_back(&TileScheduler::worker_, this, i);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TileScheduler::~TileScheduler() {
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+   }
+   start_cv_.notify_all();
+   for (auto& worker : workers_) {
+      worker.join();
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U32 TileScheduler::threads() const {
+   return threads_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+U64 TileScheduler::steals() const {
+   return steals_.load(std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TileScheduler::run(ivec2 image_dim, ivec2 tile_dim, const std::function<void(const Tile&)>& func) {
+   U32 tiles = count_tiles(image_dim, tile_dim);
+   if (tiles == 0) {
+      return;
+   }
+
+   func_ = &func;
+   image_dim_ = image_dim;
+   tile_dim_ = tile_dim;
+   tiles_per_row_ = (image_dim.x + tile_dim.x - 1) / tile_dim.x;
+
+   for (U32 i = 0; i < threads_; ++i) {
+      U32 begin = U32(U64(tiles) * i / threads_);
+      U32 end = U32(U64(tiles) * (i + 1) / threads_);
+      queues_[i].range.store(pack_range(begin, end), std::memory_order_relaxed);
+   }
+   remaining_.store(tiles, std::memory_order_release);
+   exception_ = nullptr;
+
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      busy_ = U32(workers_.size());
+      ++generation_;
+   }
+   start_cv_.notify_all();
+
+   work_(0);
+
+   std::unique_lock<std::mutex> lock(mutex_);
+   done_cv_.wait(lock, [this]() { return busy_ == 0; });
+   func_ = nullptr;
+
+   if (exception_) {
+      std::exception_ptr e = exception_;
+      exception_ = nullptr;
+      std::rethrow_exception(e);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TileScheduler::worker_(U32 index) {
+   U64 seen_generation = 0;
+   for (;;) {
+      {
+         std::unique_lock<std::mutex> lock(mutex_);
+         start_cv_.wait(lock, [&]() { return stopping_ || generation_ != seen_generation; });
+         if (stopping_) {
+            return;
+         }
+         seen_generation = generation_;
+      }
+
+      work_(index);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--busy_ == 0) {
+         done_cv_.notify_all();
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TileScheduler::work_(U32 index) {
+   U32 tile;
+   while (remaining_.load(std::memory_order_acquire) > 0) {
+      if (pop_(index, tile)) {
+         execute_(tile);
+         continue;
+      }
+
+      bool stolen = false;
+      for (U32 i = 1; i < threads_ && !stolen; ++i) {
+         stolen = steal_(index, (index + i) % threads_, tile);
+      }
+
+      if (stolen) {
+         execute_(tile);
+      } else {
+         // remaining tiles are in flight on other threads
+         std::this_thread::yield();
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool TileScheduler::pop_(U32 queue, U32& tile) {
+   std::atomic<U64>& range = queues_[queue].range;
+   U64 current = range.load(std::memory_order_acquire);
+   for (;;) {
+      U32 begin = range_begin(current);
+      U32 end = range_end(current);
+      if (begin >= end) {
+         return false;
+      }
+      if (range.compare_exchange_weak(current, pack_range(begin + 1, end), std::memory_order_acq_rel)) {
+         tile = begin;
+         return true;
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool TileScheduler::steal_(U32 thief, U32 victim, U32& tile) {
+   std::atomic<U64>& range = queues_[victim].range;
+   U64 current = range.load(std::memory_order_acquire);
+   for (;;) {
+      U32 begin = range_begin(current);
+      U32 end = range_end(current);
+      if (begin >= end) {
+         return false;
+      }
+      U32 count = std::max(1u, (end - begin) / 2);
+      U32 split = end - count;
+      if (range.compare_exchange_weak(current, pack_range(begin, split), std::memory_order_acq_rel)) {
+         // The thief's queue is empty, and nobody modifies an empty range, so
+         // the rest of the stolen work can be published with a plain store.
+         queues_[thief].range.store(pack_range(split + 1, end), std::memory_order_release);
+         steals_.fetch_add(1, std::memory_order_relaxed);
+         tile = split;
+         return true;
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TileScheduler::execute_(U32 index) {
+   Tile tile;
+   tile.index = index;
+   tile.offset = ivec2(I32(index) % tiles_per_row_, I32(index) / tiles_per_row_) * tile_dim_;
+   tile.dim = glm::min(tile_dim_, image_dim_ - tile.offset);
+
+   try {
+      (*func_)(tile);
+   } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!exception_) {
+         exception_ = std::current_exception();
+      }
+   }
+
+   remaining_.fetch_sub(1, std::memory_order_acq_rel);
+}
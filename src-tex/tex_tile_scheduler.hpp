@@ -0,0 +1,78 @@
+#pragma once
+#ifndef TEX_TILE_SCHEDULER_HPP_
+#define TEX_TILE_SCHEDULER_HPP_
+
+#include <be/core/glm.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+struct Tile {
+   be::U32 index;
+   be::ivec2 offset;
+   be::ivec2 dim;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Tiles cover roughly 64 KB of pixel data.  The result never depends on the
+// number of threads, so anything keyed by tile index is reproducible.
+be::ivec2 choose_tile_dim(be::ivec2 image_dim, std::size_t bytes_per_pixel);
+
+///////////////////////////////////////////////////////////////////////////////
+be::U32 count_tiles(be::ivec2 image_dim, be::ivec2 tile_dim);
+
+///////////////////////////////////////////////////////////////////////////////
+// Each thread starts with a contiguous range of tile indices and steals the
+// back half of another thread's range when it runs out.  The calling thread
+// acts as worker 0, so a single-threaded scheduler never spawns threads.
+class TileScheduler final {
+public:
+   explicit TileScheduler(be::U32 threads = 0);
+   ~TileScheduler();
+
+   TileScheduler(const TileScheduler&) = delete;
+   TileScheduler& operator=(const TileScheduler&) = delete;
+
+   be::U32 threads() const;
+   be::U64 steals() const;
+
+   void run(be::ivec2 image_dim, be::ivec2 tile_dim, const std::function<void(const Tile&)>& func);
+
+private:
+   struct alignas(64) Queue {
+      std::atomic<be::U64> range; // low 32 bits: begin, high 32 bits: end
+   };
+
+   void worker_(be::U32 index);
+   void work_(be::U32 index);
+   bool pop_(be::U32 queue, be::U32& tile);
+   bool steal_(be::U32 thief, be::U32 victim, be::U32& tile);
+   void execute_(be::U32 tile);
+
+   be::U32 threads_;
+   std::unique_ptr<Queue[]> queues_;
+   std::vector<std::thread> workers_;
+
+   std::mutex mutex_;
+   std::condition_variable start_cv_;
+   std::condition_variable done_cv_;
+   be::U64 generation_ = 0;
+   be::U32 busy_ = 0;
+   bool stopping_ = false;
+
+   const std::function<void(const Tile&)>* func_ = nullptr;
+   be::ivec2 image_dim_;
+   be::ivec2 tile_dim_;
+   be::I32 tiles_per_row_ = 0;
+   std::atomic<be::U32> remaining_;
+   std::atomic<be::U64> steals_;
+   std::exception_ptr exception_;
+};
+
+#endif